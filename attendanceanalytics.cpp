@@ -0,0 +1,238 @@
+#include "attendanceanalytics.h"
+#include "attendancerepository.h"
+#include "attendancebitmap.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QSettings>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// =========================================
+// Report
+// =========================================
+
+AttendanceCount AttendanceReport::total() const
+{
+    AttendanceCount sum;
+    for (const SubjectAttendance &s : subjectTotals) {
+        sum.held += s.count.held;
+        sum.attended += s.count.attended;
+    }
+    return sum;
+}
+
+int AttendanceReport::studentsBelow() const
+{
+    int below = 0;
+    for (const StudentAttendance &s : students)
+        below += s.below ? 1 : 0;
+    return below;
+}
+
+QString AttendanceReport::summary() const
+{
+    return QString("%1 sessions, %2 students, %3% attended, %4 below %5% (%6 ms)")
+        .arg(sessions)
+        .arg(students.size())
+        .arg(total().percentage(), 0, 'f', 1)
+        .arg(studentsBelow())
+        .arg(query.threshold)
+        .arg(totalMs);
+}
+
+// =========================================
+// Analytics
+// =========================================
+
+AttendanceAnalytics::AttendanceAnalytics(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+double AttendanceAnalytics::configuredThreshold(const QStringList &arguments,
+                                                const QString &configFile)
+{
+    QString threshold;
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &arg = arguments[i];
+        if (arg.startsWith("--attendance-threshold="))
+            threshold = arg.mid(QString("--attendance-threshold=").size());
+        else if (arg == "--attendance-threshold" && i + 1 < arguments.size())
+            threshold = arguments[++i];
+    }
+
+    if (threshold.isEmpty() && QFileInfo::exists(configFile)) {
+        QSettings settings(configFile, QSettings::IniFormat);
+        threshold = settings.value("attendance/threshold").toString();
+    }
+
+    bool ok = false;
+    double value = threshold.toDouble(&ok);
+    if (!ok || value < 0.0 || value > 100.0) {
+        if (!threshold.isEmpty())
+            qWarning().noquote() << "Ignoring attendance threshold" << threshold;
+        return 75.0;
+    }
+    return value;
+}
+
+// The counted students in roll_no order, with their ordinals alongside
+bool AttendanceAnalytics::loadStudents(const AttendanceQuery &query, QVector<int> &ordinals)
+{
+    QString sql = "SELECT o.ordinal, s.roll_no, s.name, s.branch, s.year FROM students s "
+                  "JOIN student_ordinals o ON o.roll_no = s.roll_no WHERE 1=1";
+    if (!query.branch.isEmpty())
+        sql += " AND s.branch = ?";
+    if (query.year > 0)
+        sql += " AND s.year = ?";
+    sql += " ORDER BY s.roll_no";
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    if (!query.branch.isEmpty())
+        q.addBindValue(query.branch);
+    if (query.year > 0)
+        q.addBindValue(query.year);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    while (trace.next()) {
+        StudentAttendance s;
+        s.rollNo = q.value(1).toString();
+        s.name   = q.value(2).toString();
+        s.branch = q.value(3).toString();
+        s.year   = q.value(4).toInt();
+        result.students.append(s);
+        ordinals.append(q.value(0).toInt());
+    }
+    return true;
+}
+
+bool AttendanceAnalytics::run(const AttendanceQuery &query, const QueryCancelToken &token)
+{
+    result = AttendanceReport();
+    result.query = query;
+    error.clear();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<int> ordinals;
+    if (!loadStudents(query, ordinals))
+        return false;
+
+    AttendanceBitmap members;
+    for (int ordinal : ordinals)
+        members.set(ordinal);
+
+    // ---- One pass over the sessions ----
+    QHash<QString, int> subjectIndex;
+    QVector<AttendanceCounter> held, attended;
+    int visited = 0;
+    bool cancelled = false;
+
+    AttendanceRepository repository(db);
+    bool ok = repository.forEachSession(
+        [&](const AttendanceSession &session, const AttendanceBitmap &roster,
+            const AttendanceBitmap &present) {
+            if (++visited % 64 == 0 && token.isCancelled()) {
+                cancelled = true;
+                return false;
+            }
+
+            qint64 h = roster.countAnd(members);
+            if (h == 0)
+                return true;
+
+            int s = subjectIndex.value(session.subject, -1);
+            if (s < 0) {
+                s = result.subjects.size();
+                subjectIndex.insert(session.subject, s);
+                result.subjects << session.subject;
+                result.subjectTotals.append(SubjectAttendance());
+                result.subjectTotals[s].subject = session.subject;
+                held.append(AttendanceCounter());
+                attended.append(AttendanceCounter());
+            }
+
+            SubjectAttendance &totals = result.subjectTotals[s];
+            totals.sessions++;
+            totals.count.held += h;
+            totals.count.attended += present.countAnd(members);
+            held[s].add(roster, members);
+            attended[s].add(present, members);
+            result.sessions++;
+            return true;
+        },
+        query.subject, query.from, query.to);
+    if (cancelled) {
+        error = "Cancelled";
+        return false;
+    }
+    if (!ok) {
+        error = repository.lastError();
+        return false;
+    }
+
+    // ---- Per student, then rolled up per section ----
+    auto below = [&](const AttendanceCount &count) {
+        return count.held > 0 && count.percentage() < query.threshold;
+    };
+
+    QMap<QPair<QString, int>, SectionAttendance> sections;
+    for (int i = 0; i < result.students.size(); i++) {
+        StudentAttendance &student = result.students[i];
+        for (int s = 0; s < result.subjects.size(); s++) {
+            StudentSubjectAttendance row;
+            row.count.held = held[s].value(ordinals[i]);
+            if (row.count.held == 0)
+                continue;
+            row.student = i;
+            row.subject = s;
+            row.count.attended = attended[s].value(ordinals[i]);
+            row.below = below(row.count);
+            if (row.below)
+                result.subjectTotals[s].studentsBelow++;
+            result.studentSubjects.append(row);
+
+            student.count.held += row.count.held;
+            student.count.attended += row.count.attended;
+        }
+        student.below = below(student.count);
+
+        SectionAttendance &section = sections[qMakePair(student.branch, student.year)];
+        section.branch = student.branch;
+        section.year = student.year;
+        section.students++;
+        section.count.held += student.count.held;
+        section.count.attended += student.count.attended;
+        if (student.below)
+            section.studentsBelow++;
+    }
+    for (const SectionAttendance &section : sections)
+        result.sections.append(section);
+
+    result.totalMs = timer.elapsed();
+    return true;
+}
+
+AttendanceReport AttendanceAnalytics::report() const
+{
+    return result;
+}
+
+QString AttendanceAnalytics::lastError() const
+{
+    return error;
+}
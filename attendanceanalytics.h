@@ -0,0 +1,122 @@
+#ifndef ATTENDANCEANALYTICS_H
+#define ATTENDANCEANALYTICS_H
+
+#include "querycanceltoken.h"
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QDate>
+#include <QMetaType>
+
+// What to count. Empty subject / branch and year 0 mean all; an invalid
+// date leaves that end of the range open.
+struct AttendanceQuery
+{
+    QString subject;
+    QString branch;
+    int     year = 0;
+    QDate   from;
+    QDate   to;
+    double  threshold = 75.0;       // percent; below it a student is flagged
+};
+
+struct AttendanceCount
+{
+    qint64 held = 0;
+    qint64 attended = 0;
+
+    double percentage() const { return held > 0 ? attended * 100.0 / held : 0.0; }
+};
+
+// One student over every counted subject
+struct StudentAttendance
+{
+    QString rollNo;
+    QString name;
+    QString branch;
+    int     year = 0;
+    AttendanceCount count;
+    bool    below = false;          // held sessions and under the threshold
+};
+
+// One student in one subject; indexes into AttendanceReport
+struct StudentSubjectAttendance
+{
+    int student = 0;
+    int subject = 0;
+    AttendanceCount count;
+    bool below = false;
+};
+
+struct SubjectAttendance
+{
+    QString subject;
+    int     sessions = 0;           // with at least one counted student
+    AttendanceCount count;          // student-sessions
+    int     studentsBelow = 0;      // in this subject
+};
+
+// A section is a (branch, year) class
+struct SectionAttendance
+{
+    QString branch;
+    int     year = 0;
+    int     students = 0;
+    AttendanceCount count;
+    int     studentsBelow = 0;      // over all subjects
+};
+
+struct AttendanceReport
+{
+    AttendanceQuery query;
+    int     sessions = 0;
+    qint64  totalMs = 0;
+
+    QStringList                       subjects;
+    QVector<StudentAttendance>        students;         // roll_no order
+    QVector<StudentSubjectAttendance> studentSubjects;  // by student, then subject
+    QVector<SubjectAttendance>        subjectTotals;    // same order as subjects
+    QVector<SectionAttendance>        sections;         // branch, year order
+
+    AttendanceCount total() const;
+    int studentsBelow() const;
+    QString summary() const;
+};
+
+Q_DECLARE_METATYPE(AttendanceReport)
+
+// Attendance percentages per student, per student and subject, per subject
+// and per section over a date range, in one ordered pass over the sessions
+// (AttendanceRepository::forEachSession).
+//
+// Per-student counts are kept bit-sliced (AttendanceCounter), so adding a
+// session's roster is a ripple-carry add over whole words rather than a
+// loop over its students. Subject totals are popcounts of roster & counted
+// students, so students deleted since a session was taken drop out of
+// every figure.
+class AttendanceAnalytics
+{
+public:
+    explicit AttendanceAnalytics(const QSqlDatabase &database);
+
+    // --attendance-threshold, else [attendance] threshold in srms.ini, else 75
+    static double configuredThreshold(const QStringList &arguments,
+                                      const QString &configFile = "srms.ini");
+
+    bool run(const AttendanceQuery &query,
+             const QueryCancelToken &token = QueryCancelToken());
+
+    AttendanceReport report() const;
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+    AttendanceReport result;
+
+    bool loadStudents(const AttendanceQuery &query, QVector<int> &ordinals);
+};
+
+#endif // ATTENDANCEANALYTICS_H
@@ -0,0 +1,272 @@
+#include "attendancebitmap.h"
+
+#include <QtEndian>
+
+void AttendanceBitmap::reserveWords(int words)
+{
+    if (words > bits.size())
+        bits.resize(words);
+}
+
+void AttendanceBitmap::set(int ordinal, bool on)
+{
+    if (ordinal < 0)
+        return;
+    int w = ordinal >> 6;
+    quint64 mask = quint64(1) << (ordinal & 63);
+    if (on) {
+        reserveWords(w + 1);
+        bits[w] |= mask;
+    } else if (w < bits.size()) {
+        bits[w] &= ~mask;
+    }
+}
+
+int AttendanceBitmap::count() const
+{
+    int n = 0;
+    for (quint64 word : bits)
+        n += qPopulationCount(word);
+    return n;
+}
+
+bool AttendanceBitmap::isEmpty() const
+{
+    for (quint64 word : bits) {
+        if (word)
+            return false;
+    }
+    return true;
+}
+
+void AttendanceBitmap::unite(const AttendanceBitmap &other)
+{
+    reserveWords(other.bits.size());
+    for (int w = 0; w < other.bits.size(); w++)
+        bits[w] |= other.bits[w];
+}
+
+void AttendanceBitmap::intersect(const AttendanceBitmap &other)
+{
+    if (bits.size() > other.bits.size())
+        bits.resize(other.bits.size());
+    for (int w = 0; w < bits.size(); w++)
+        bits[w] &= other.bits[w];
+}
+
+void AttendanceBitmap::subtract(const AttendanceBitmap &other)
+{
+    int words = qMin(bits.size(), other.bits.size());
+    for (int w = 0; w < words; w++)
+        bits[w] &= ~other.bits[w];
+}
+
+int AttendanceBitmap::countAnd(const AttendanceBitmap &other) const
+{
+    int words = qMin(bits.size(), other.bits.size());
+    const quint64 *a = bits.constData();
+    const quint64 *b = other.bits.constData();
+    int n = 0;
+    for (int w = 0; w < words; w++)
+        n += qPopulationCount(a[w] & b[w]);
+    return n;
+}
+
+QVector<int> AttendanceBitmap::blocks() const
+{
+    QVector<int> list;
+    for (int w = 0; w < bits.size(); w++) {
+        if (!bits[w])
+            continue;
+        int block = w / BlockWords;
+        list.append(block);
+        w = (block + 1) * BlockWords - 1;
+    }
+    return list;
+}
+
+// Byte index (0 .. BlockBits/8 - 1) of a block
+quint8 AttendanceBitmap::byteAt(int block, int index) const
+{
+    int w = block * BlockWords + index / 8;
+    return w < bits.size() ? quint8(bits[w] >> (8 * (index % 8))) : 0;
+}
+
+QByteArray AttendanceBitmap::encodeBlock(int block) const
+{
+    const int first = block * BlockWords;
+    const int last = qMin(first + BlockWords, bits.size());
+
+    int count = 0;
+    int firstByte = -1;
+    int lastByte = -1;
+    for (int w = first; w < last; w++) {
+        quint64 word = bits[w];
+        if (!word)
+            continue;
+        count += qPopulationCount(word);
+        if (firstByte < 0)
+            firstByte = (w - first) * 8 + int(qCountTrailingZeroBits(word)) / 8;
+        lastByte = (w - first) * 8 + (63 - int(qCountLeadingZeroBits(word))) / 8;
+    }
+    if (count == 0)
+        return QByteArray();
+
+    QByteArray data;
+    int span = lastByte - firstByte + 1;
+    if (1 + 2 * count < 3 + span) {
+        data.reserve(1 + 2 * count);
+        data.append('A');
+        for (int w = first; w < last; w++) {
+            quint64 word = bits[w];
+            while (word) {
+                quint16 offset = qToLittleEndian(
+                    quint16((w - first) * 64 + int(qCountTrailingZeroBits(word))));
+                data.append(reinterpret_cast<const char *>(&offset), 2);
+                word &= word - 1;
+            }
+        }
+        return data;
+    }
+
+    data.reserve(3 + span);
+    data.append('B');
+    quint16 start = qToLittleEndian(quint16(firstByte));
+    data.append(reinterpret_cast<const char *>(&start), 2);
+    for (int i = firstByte; i <= lastByte; i++)
+        data.append(char(byteAt(block, i)));
+    return data;
+}
+
+bool AttendanceBitmap::decodeBlock(int block, const QByteArray &data)
+{
+    if (data.isEmpty() || block < 0)
+        return data.isEmpty();
+
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const int size = data.size();
+    const int base = block * BlockBits;
+
+    if (p[0] == 'A') {
+        if ((size - 1) % 2 != 0)
+            return false;
+        int n = (size - 1) / 2;
+        if (n > 0)
+            reserveWords((base + qFromLittleEndian<quint16>(p + 1 + 2 * (n - 1))) / 64 + 1);
+        for (int i = 0; i < n; i++) {
+            int offset = qFromLittleEndian<quint16>(p + 1 + 2 * i);
+            if (offset >= BlockBits)
+                return false;
+            set(base + offset);
+        }
+        return true;
+    }
+
+    if (p[0] == 'B') {
+        if (size < 3)
+            return false;
+        int firstByte = qFromLittleEndian<quint16>(p + 1);
+        int span = size - 3;
+        if (firstByte + span > BlockBits / 8)
+            return false;
+        reserveWords(block * BlockWords + (firstByte + span + 7) / 8);
+        for (int i = 0; i < span; i++) {
+            int index = firstByte + i;
+            bits[block * BlockWords + index / 8] |= quint64(p[3 + i]) << (8 * (index % 8));
+        }
+        return true;
+    }
+    return false;
+}
+
+bool AttendanceBitmap::blockContains(const QByteArray &data, int offset)
+{
+    if (data.isEmpty())
+        return false;
+
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const int size = data.size();
+
+    if (p[0] == 'A') {
+        int lo = 0;
+        int hi = (size - 1) / 2;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            int value = qFromLittleEndian<quint16>(p + 1 + 2 * mid);
+            if (value == offset)
+                return true;
+            if (value < offset)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return false;
+    }
+
+    if (p[0] == 'B' && size >= 3) {
+        int index = offset / 8 - qFromLittleEndian<quint16>(p + 1);
+        return index >= 0 && index < size - 3 && (p[3 + index] >> (offset % 8)) & 1;
+    }
+    return false;
+}
+
+// =========================================
+// Counter
+// =========================================
+
+void AttendanceCounter::add(const AttendanceBitmap &bits)
+{
+    const QVector<quint64> &words = bits.words();
+    carry = words;
+    addCarry(words.size());
+}
+
+void AttendanceCounter::add(const AttendanceBitmap &bits, const AttendanceBitmap &mask)
+{
+    const int words = qMin(bits.words().size(), mask.words().size());
+    carry.resize(words);
+    const quint64 *b = bits.words().constData();
+    const quint64 *m = mask.words().constData();
+    quint64 *c = carry.data();
+    for (int w = 0; w < words; w++)
+        c[w] = b[w] & m[w];
+    addCarry(words);
+}
+
+// Adds carry[0 .. words) to plane 0, the carries out of it to plane 1 and
+// so on; the inner loop has no branches, so the compiler vectorizes it
+void AttendanceCounter::addCarry(int words)
+{
+    if (words > width) {
+        for (QVector<quint64> &plane : planes)
+            plane.resize(words);
+        width = words;
+    }
+
+    quint64 *c = carry.data();
+    for (int p = 0;; p++) {
+        if (p == planes.size())
+            planes.append(QVector<quint64>(width, 0));
+        quint64 *plane = planes[p].data();
+        quint64 any = 0;
+        for (int w = 0; w < words; w++) {
+            quint64 next = plane[w] & c[w];
+            plane[w] ^= c[w];
+            c[w] = next;
+            any |= next;
+        }
+        if (!any)
+            break;
+    }
+}
+
+qint64 AttendanceCounter::value(int ordinal) const
+{
+    int w = ordinal >> 6;
+    if (ordinal < 0 || w >= width)
+        return 0;
+    qint64 v = 0;
+    for (int p = 0; p < planes.size(); p++)
+        v |= qint64((planes[p][w] >> (ordinal & 63)) & 1) << p;
+    return v;
+}
@@ -0,0 +1,103 @@
+#ifndef ATTENDANCEBITMAP_H
+#define ATTENDANCEBITMAP_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtAlgorithms>
+
+// A set of student ordinals (student_ordinals.ordinal), one bit each: the
+// roster of an attendance session or the students present in it.
+//
+// In memory it is a plain word array starting at ordinal 0. On disk it is
+// split into blocks of BlockBits ordinals, one attendance_bits row per
+// block, each block in whichever of two encodings is smaller:
+//   'A'  u16 offsets of the set bits within the block, ascending
+//   'B'  u16 index of the first non-zero byte, then the bytes up to the
+//        last non-zero one, bit 0 of a byte first
+// integers little-endian. A section of 60 students with consecutive
+// ordinals is 11 bytes, scattered ones at most 121.
+class AttendanceBitmap
+{
+public:
+    static const int BlockBits = 4096;
+
+    bool test(int ordinal) const
+    {
+        int w = ordinal >> 6;
+        return ordinal >= 0 && w < bits.size() && (bits[w] >> (ordinal & 63)) & 1;
+    }
+
+    void set(int ordinal, bool on = true);
+
+    int count() const;
+    bool isEmpty() const;
+
+    // this |= other / this &= other / this &= ~other
+    void unite(const AttendanceBitmap &other);
+    void intersect(const AttendanceBitmap &other);
+    void subtract(const AttendanceBitmap &other);
+
+    // Size of this & other, without building it
+    int countAnd(const AttendanceBitmap &other) const;
+
+    // f(ordinal) for every set bit, ascending
+    template <class F>
+    void forEach(F f) const
+    {
+        for (int w = 0; w < bits.size(); w++) {
+            quint64 word = bits[w];
+            while (word) {
+                f(w * 64 + int(qCountTrailingZeroBits(word)));
+                word &= word - 1;
+            }
+        }
+    }
+
+    // Blocks with at least one bit set, ascending
+    QVector<int> blocks() const;
+
+    // Empty for a block without bits
+    QByteArray encodeBlock(int block) const;
+    // ORs a stored block in; false if data is not a valid block
+    bool decodeBlock(int block, const QByteArray &data);
+    // Whether bit offset (0 .. BlockBits-1) is set in a stored block,
+    // without decoding it
+    static bool blockContains(const QByteArray &data, int offset);
+
+    const QVector<quint64> &words() const { return bits; }
+
+private:
+    static const int BlockWords = BlockBits / 64;
+
+    QVector<quint64> bits;      // word w holds ordinals 64w .. 64w + 63
+
+    void reserveWords(int words);
+    quint8 byteAt(int block, int index) const;
+};
+
+// One count per ordinal, bit-sliced: bit p of ordinal i's count is bit
+// i % 64 of plane p's word i / 64. Adding a bitmap adds its words plane by
+// plane with a word-wide carry and stops at the first plane where no word
+// carries, so on average it touches about two planes whatever the number
+// of students.
+class AttendanceCounter
+{
+public:
+    // One more for every ordinal set in bits (and in mask)
+    void add(const AttendanceBitmap &bits);
+    void add(const AttendanceBitmap &bits, const AttendanceBitmap &mask);
+
+    qint64 value(int ordinal) const;
+
+    // Every ordinal below this may have a non-zero count
+    int size() const { return width * 64; }
+
+private:
+    QVector<QVector<quint64>> planes;
+    QVector<quint64> carry;
+    int width = 0;
+
+    void addCarry(int words);
+};
+
+#endif // ATTENDANCEBITMAP_H
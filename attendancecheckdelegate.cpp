@@ -0,0 +1,73 @@
+#include "attendancecheckdelegate.h"
+
+#include <QApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QStyle>
+#include <QStyleOptionButton>
+
+AttendanceCheckDelegate::AttendanceCheckDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+void AttendanceCheckDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option,
+                                    const QModelIndex &index) const
+{
+    QVariant state = index.data(Qt::CheckStateRole);
+    if (!state.isValid()) {
+        QStyledItemDelegate::paint(painter, option, index);
+        return;
+    }
+
+    // Background and selection as usual, without the text / indicator
+    QStyleOptionViewItem opt = option;
+    initStyleOption(&opt, index);
+    opt.features &= ~QStyleOptionViewItem::HasCheckIndicator;
+    opt.text.clear();
+
+    const QWidget *widget = option.widget;
+    QStyle *style = widget ? widget->style() : QApplication::style();
+    style->drawControl(QStyle::CE_ItemViewItem, &opt, painter, widget);
+
+    QStyleOptionButton box;
+    QRect indicator = style->subElementRect(QStyle::SE_CheckBoxIndicator, &box, widget);
+    box.rect = QStyle::alignedRect(option.direction, Qt::AlignCenter,
+                                   indicator.size(), option.rect);
+    box.state = QStyle::State_Enabled
+              | (state.toInt() == Qt::Checked ? QStyle::State_On : QStyle::State_Off);
+    style->drawPrimitive(QStyle::PE_IndicatorCheckBox, &box, painter, widget);
+}
+
+bool AttendanceCheckDelegate::editorEvent(QEvent *event, QAbstractItemModel *model,
+                                          const QStyleOptionViewItem &option,
+                                          const QModelIndex &index)
+{
+    if (!(index.flags() & Qt::ItemIsUserCheckable) || !(index.flags() & Qt::ItemIsEnabled))
+        return false;
+
+    switch (event->type()) {
+    case QEvent::MouseButtonRelease: {
+        QMouseEvent *mouse = static_cast<QMouseEvent *>(event);
+        if (mouse->button() != Qt::LeftButton || !option.rect.contains(mouse->pos()))
+            return false;
+        break;
+    }
+    case QEvent::MouseButtonDblClick:
+        // Swallow it, the release already toggled
+        return true;
+    case QEvent::KeyPress: {
+        QKeyEvent *key = static_cast<QKeyEvent *>(event);
+        if (key->key() != Qt::Key_Space && key->key() != Qt::Key_Select)
+            return false;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    Qt::CheckState state = index.data(Qt::CheckStateRole).toInt() == Qt::Checked
+                               ? Qt::Unchecked : Qt::Checked;
+    return model->setData(index, state, Qt::CheckStateRole);
+}
@@ -0,0 +1,24 @@
+#ifndef ATTENDANCECHECKDELEGATE_H
+#define ATTENDANCECHECKDELEGATE_H
+
+#include <QStyledItemDelegate>
+
+// Paints a checkable cell as a centred check box and toggles it on a click
+// anywhere in the cell or on Space, writing Qt::CheckStateRole back to the
+// model. Nothing is instantiated per row.
+class AttendanceCheckDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+    explicit AttendanceCheckDelegate(QObject *parent = nullptr);
+
+    void paint(QPainter *painter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+
+protected:
+    bool editorEvent(QEvent *event, QAbstractItemModel *model,
+                     const QStyleOptionViewItem &option, const QModelIndex &index) override;
+};
+
+#endif // ATTENDANCECHECKDELEGATE_H
@@ -1,4 +1,9 @@
 #include "attendancedialog.h"
+#include "attendancerepository.h"
+#include "studentrepository.h"
+#include "attendancecheckdelegate.h"
+#include "attendancestatsdialog.h"
+#include "attendanceanalytics.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
@@ -6,18 +11,22 @@
 #include <QLabel>
 #include <QHeaderView>
 #include <QMessageBox>
-#include <QSqlQuery>
-#include <QSqlError>
-#include <QCheckBox>
 #include <QAbstractItemView>
+#include <QElapsedTimer>
+#include <QCoreApplication>
 
-AttendanceDialog::AttendanceDialog(QSqlDatabase &database, QWidget *parent)
-    : QDialog(parent), db(database)
+AttendanceDialog::AttendanceDialog(QSqlDatabase &database, QueryExecutor *queryExecutor, QWidget *parent)
+    : QDialog(parent), db(database), executor(queryExecutor)
 {
     setWindowTitle("📅 Manage Attendance");
     resize(900, 700);
     setupUI();
     loadSubjects();
+    
+    if (executor) {
+        connect(executor, &QueryExecutor::finished, this, &AttendanceDialog::onQueryFinished);
+        connect(executor, &QueryExecutor::failed, this, &AttendanceDialog::onQueryFailed);
+    }
 }
 
 void AttendanceDialog::setupUI() {
@@ -48,6 +57,18 @@ void AttendanceDialog::setupUI() {
     subjectCombo->setEditable(true);
     filterLayout->addWidget(subjectCombo, 1, 1);
     
+    // A session is subject + date + period
+    filterLayout->addWidget(new QLabel("Date:"), 2, 0);
+    dateEdit = new QDateEdit(QDate::currentDate());
+    dateEdit->setCalendarPopup(true);
+    dateEdit->setDisplayFormat("yyyy-MM-dd");
+    filterLayout->addWidget(dateEdit, 2, 1);
+    
+    filterLayout->addWidget(new QLabel("Period:"), 2, 2);
+    periodSpin = new QSpinBox();
+    periodSpin->setRange(1, 12);
+    filterLayout->addWidget(periodSpin, 2, 3);
+    
     loadBtn = new QPushButton("📋 Load Students");
     loadBtn->setStyleSheet("background-color: #3498db; color: white; padding: 10px; font-weight: bold;");
     filterLayout->addWidget(loadBtn, 1, 2, 1, 2);
@@ -69,15 +90,21 @@ void AttendanceDialog::setupUI() {
     mainLayout->addLayout(quickLayout);
     
     // Student table
-    studentTable = new QTableWidget(0, 6);
-    studentTable->setHorizontalHeaderLabels({
-        "Roll No", "Name", "Branch", "Year", "Present", "Status"
-    });
+    rosterModel = new AttendanceRosterModel(this);
+    studentTable = new QTableView();
+    studentTable->setModel(rosterModel);
+    studentTable->setItemDelegateForColumn(AttendanceRosterModel::PresentColumn,
+                                           new AttendanceCheckDelegate(studentTable));
+    studentTable->verticalHeader()->setDefaultSectionSize(24);
     studentTable->horizontalHeader()->setStretchLastSection(true);
     studentTable->setAlternatingRowColors(true);
     studentTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     mainLayout->addWidget(studentTable);
     
+    statusLabel = new QLabel();
+    statusLabel->setStyleSheet("color: gray;");
+    mainLayout->addWidget(statusLabel);
+    
     // Action buttons
     QHBoxLayout *actionLayout = new QHBoxLayout();
     
@@ -114,69 +141,55 @@ void AttendanceDialog::loadSubjects() {
     });
 }
 
-void AttendanceDialog::loadStudents() {
-    QString branch = branchCombo->currentText();
-    QString year = yearCombo->currentText();
-    
-    studentTable->setRowCount(0);
-    
-    QSqlQuery query(db);
-    QString sql = "SELECT roll_no, name, branch, year FROM students WHERE 1=1";
-    
-    if (branch != "All") {
-        sql += " AND branch = '" + branch + "'";
-    }
-    if (year != "All") {
-        sql += " AND year = " + year;
+// Runs task on the query worker, or inline when there is none; the result
+// arrives in onQueryFinished / onQueryFailed either way
+void AttendanceDialog::runQuery(const QString &channel, const QueryExecutor::Task &task) {
+    if (executor) {
+        executor->submit(channel, task);
+        return;
     }
     
-    sql += " ORDER BY roll_no";
-    
-    if (query.exec(sql)) {
-        while (query.next()) {
-            int row = studentTable->rowCount();
-            studentTable->insertRow(row);
-            
-            QString rollNo = query.value(0).toString();
-            QString name = query.value(1).toString();
-            QString studentBranch = query.value(2).toString();
-            QString studentYear = query.value(3).toString();
-            
-            studentTable->setItem(row, 0, new QTableWidgetItem(rollNo));
-            studentTable->setItem(row, 1, new QTableWidgetItem(name));
-            studentTable->setItem(row, 2, new QTableWidgetItem(studentBranch));
-            studentTable->setItem(row, 3, new QTableWidgetItem(studentYear));
-            
-            QCheckBox *checkbox = new QCheckBox();
-            checkbox->setChecked(false);
-            studentTable->setCellWidget(row, 4, checkbox);
-            
-            studentTable->setItem(row, 5, new QTableWidgetItem("Absent"));
-            
-            connect(checkbox, &QCheckBox::stateChanged, [this, row](int state) {
-                QString status = (state == Qt::Checked) ? "Present" : "Absent";
-                if (studentTable->item(row, 5)) {
-                    studentTable->item(row, 5)->setText(status);
-                    QColor color = (state == Qt::Checked) ? QColor(39, 174, 96, 50) : QColor(231, 76, 60, 50);
-                    for (int col = 0; col < 6; col++) {
-                        if (studentTable->item(row, col)) {
-                            studentTable->item(row, col)->setBackground(color);
-                        }
-                    }
-                }
-            });
-        }
-        
-        if (studentTable->rowCount() == 0) {
-            QMessageBox::information(this, "No Students", "No students found for selected filters!");
-        }
+    QString error;
+    QVariant result = task(db, QueryCancelToken(), error);
+    if (error.isEmpty()) {
+        onQueryFinished(0, channel, result);
     } else {
-        QMessageBox::critical(this, "Error", "Failed to load students: " + query.lastError().text());
+        onQueryFailed(0, channel, error);
     }
 }
 
+// The class with whatever is already recorded for the session; students
+// not marked yet show as Not Marked and are saved as Absent
+void AttendanceDialog::loadStudents() {
+    QString branch = branchCombo->currentText() == "All" ? QString() : branchCombo->currentText();
+    int year = yearCombo->currentText() == "All" ? 0 : yearCombo->currentText().toInt();
+    QString subject = subjectCombo->currentText();
+    QDate date = dateEdit->date();
+    int period = periodSpin->value();
+    
+    statusLabel->setText("Loading students...");
+    runQuery("attendance.roster", [subject, date, period, branch, year](QSqlDatabase &db, const QueryCancelToken &, QString &error) {
+        AttendanceRepository repository(db);
+        QVector<AttendanceRecord> records = repository.forClass(subject, date, period, branch, year);
+        error = repository.lastError();
+        return QVariant::fromValue(records);
+    });
+}
+
+QString AttendanceDialog::sessionName() const {
+    return QString("%1, %2, period %3")
+        .arg(subjectCombo->currentText(), dateEdit->date().toString(Qt::ISODate))
+        .arg(periodSpin->value());
+}
+
+void AttendanceDialog::showRosterSize() {
+    statusLabel->setText(QString("%1 students loaded (~%2 bytes per row)")
+                         .arg(rosterModel->rowCount())
+                         .arg(rosterModel->bytesPerRow()));
+}
+
 void AttendanceDialog::markAttendance() {
-    if (studentTable->rowCount() == 0) {
+    if (rosterModel->rowCount() == 0) {
         QMessageBox::warning(this, "No Students", "Please load students first!");
         return;
     }
@@ -187,176 +200,104 @@ void AttendanceDialog::markAttendance() {
         return;
     }
     
-    int savedCount = 0;
-    QSqlQuery query(db);
-    
-    for (int row = 0; row < studentTable->rowCount(); row++) {
-        QString rollNo = studentTable->item(row, 0)->text();
-        QCheckBox *checkbox = qobject_cast<QCheckBox*>(studentTable->cellWidget(row, 4));
-        QString status = checkbox->isChecked() ? "Present" : "Absent";
-        
-        // Check if attendance exists
-        QSqlQuery checkQuery(db);
-        checkQuery.prepare("SELECT attendance_id FROM attendance "
-                          "WHERE roll_no = ? AND subject = ?");
-        checkQuery.addBindValue(rollNo);
-        checkQuery.addBindValue(subject);
+    // The roster already carries each student's ordinal, so the worker
+    // writes the bitmaps without looking anyone up
+    AttendanceBitmap roster, present;
+    if (!rosterModel->bitmaps(roster, present)) {
+        QMessageBox::warning(this, "Not Loaded", "Please load the class attendance first!");
+        return;
+    }
+    int rows = rosterModel->rowCount();
+    QDate date = dateEdit->date();
+    int period = periodSpin->value();
+    QString session = sessionName();
+    
+    // The save button stays disabled until the worker reports back
+    saveBtn->setEnabled(false);
+    statusLabel->setText(QString("Saving attendance for %1 students...").arg(rows));
+    
+    runQuery("attendance.save", [subject, date, period, session, roster, present, rows](QSqlDatabase &db, const QueryCancelToken &, QString &error) {
+        QElapsedTimer timer;
+        timer.start();
         
-        if (checkQuery.exec() && checkQuery.next()) {
-            // Update existing
-            query.prepare("UPDATE attendance SET status = ? "
-                         "WHERE roll_no = ? AND subject = ?");
-            query.addBindValue(status);
-            query.addBindValue(rollNo);
-            query.addBindValue(subject);
-        } else {
-            // Insert new
-            query.prepare("INSERT INTO attendance (roll_no, status, subject) "
-                         "VALUES (?, ?, ?)");
-            query.addBindValue(rollNo);
-            query.addBindValue(status);
-            query.addBindValue(subject);
+        AttendanceRepository repository(db);
+        if (!repository.save(subject, date, period, roster, present)) {
+            error = repository.lastError();
+            return QVariant();
         }
         
-        if (query.exec()) {
-            savedCount++;
-        }
-    }
-    
-    QMessageBox::information(this, "Success",
-                            QString("Attendance saved for %1 students!\nSubject: %2")
-                            .arg(savedCount)
-                            .arg(subject));
+        QVariantMap summary;
+        summary["session"] = session;
+        summary["rows"] = rows;
+        summary["ms"] = timer.elapsed();
+        return QVariant(summary);
+    });
 }
 
-void AttendanceDialog::viewAttendance() {
-    QString branch = branchCombo->currentText();
-    QString year = yearCombo->currentText();
-    QString subject = subjectCombo->currentText();
+void AttendanceDialog::populateAttendance(const QVector<AttendanceRecord> &records) {
+    rosterModel->setAttendance(records);
+    showRosterSize();
     
-    studentTable->setRowCount(0);
-    
-    QSqlQuery query(db);
-    QString sql = "SELECT s.roll_no, s.name, s.branch, s.year, "
-                  "COALESCE(a.status, 'Not Marked') as status "
-                  "FROM students s "
-                  "LEFT JOIN attendance a ON s.roll_no = a.roll_no "
-                  "AND a.subject = ? "
-                  "WHERE 1=1";
-    
-    if (branch != "All") sql += " AND s.branch = '" + branch + "'";
-    if (year != "All") sql += " AND s.year = " + year;
-    sql += " ORDER BY s.roll_no";
-    
-    query.prepare(sql);
-    query.addBindValue(subject);
-    
-    if (query.exec()) {
-        while (query.next()) {
-            int row = studentTable->rowCount();
-            studentTable->insertRow(row);
-            
-            QString rollNo = query.value(0).toString();
-            QString name = query.value(1).toString();
-            QString studentBranch = query.value(2).toString();
-            QString studentYear = query.value(3).toString();
-            QString status = query.value(4).toString();
-            
-            studentTable->setItem(row, 0, new QTableWidgetItem(rollNo));
-            studentTable->setItem(row, 1, new QTableWidgetItem(name));
-            studentTable->setItem(row, 2, new QTableWidgetItem(studentBranch));
-            studentTable->setItem(row, 3, new QTableWidgetItem(studentYear));
-            
-            QCheckBox *checkbox = new QCheckBox();
-            checkbox->setChecked(status == "Present");
-            studentTable->setCellWidget(row, 4, checkbox);
-            
-            studentTable->setItem(row, 5, new QTableWidgetItem(status));
-            
-            QColor color;
-            if (status == "Present") color = QColor(39, 174, 96, 50);
-            else if (status == "Absent") color = QColor(231, 76, 60, 50);
-            else color = QColor(255, 255, 255);
-            
-            for (int col = 0; col < 6; col++) {
-                if (studentTable->item(row, col)) {
-                    studentTable->item(row, col)->setBackground(color);
-                }
-            }
-        }
+    if (rosterModel->rowCount() == 0) {
+        QMessageBox::information(this, "No Students", "No students found for selected filters!");
     }
 }
 
 void AttendanceDialog::markAllPresent() {
-    for (int row = 0; row < studentTable->rowCount(); row++) {
-        QCheckBox *checkbox = qobject_cast<QCheckBox*>(studentTable->cellWidget(row, 4));
-        if (checkbox) {
-            checkbox->setChecked(true);
-        }
-    }
+    rosterModel->setAllStatus(AttendanceRosterModel::Present);
 }
 
 void AttendanceDialog::markAllAbsent() {
-    for (int row = 0; row < studentTable->rowCount(); row++) {
-        QCheckBox *checkbox = qobject_cast<QCheckBox*>(studentTable->cellWidget(row, 4));
-        if (checkbox) {
-            checkbox->setChecked(false);
-        }
-    }
+    rosterModel->setAllStatus(AttendanceRosterModel::Absent);
 }
 
+// Opens on the selected class and subject over every session, then keeps
+// its own filters
 void AttendanceDialog::calculateAttendanceStats() {
-    QString subject = subjectCombo->currentText();
+    QStringList subjects;
+    for (int i = 0; i < subjectCombo->count(); i++) {
+        subjects << subjectCombo->itemText(i);
+    }
     
-    if (subject.isEmpty()) {
-        QMessageBox::warning(this, "No Subject", "Please select a subject!");
+    AttendanceQuery query;
+    query.subject = subjectCombo->currentText();
+    query.branch = branchCombo->currentText() == "All" ? QString() : branchCombo->currentText();
+    query.year = yearCombo->currentText() == "All" ? 0 : yearCombo->currentText().toInt();
+    query.threshold = AttendanceAnalytics::configuredThreshold(QCoreApplication::arguments());
+    
+    AttendanceStatsDialog dialog(db, executor, subjects, query, this);
+    dialog.exec();
+}
+
+void AttendanceDialog::onQueryFinished(quint64, const QString &channel, const QVariant &result) {
+    if (channel == "attendance.roster") {
+        populateAttendance(result.value<QVector<AttendanceRecord>>());
+    } else if (channel == "attendance.save") {
+        QVariantMap summary = result.toMap();
+        saveBtn->setEnabled(true);
+        statusLabel->clear();
+        QMessageBox::information(this, "Success",
+                                QString("Attendance saved for %1 students!\nSession: %2\n"
+                                        "Saved in %3 ms (single transaction)")
+                                .arg(summary["rows"].toInt())
+                                .arg(summary["session"].toString())
+                                .arg(summary["ms"].toLongLong()));
+    }
+}
+
+void AttendanceDialog::onQueryFailed(quint64, const QString &channel, const QString &error) {
+    if (!channel.startsWith("attendance.")) {
         return;
     }
     
-    QSqlQuery query(db);
-    query.prepare("SELECT s.roll_no, s.name, a.status "
-                  "FROM students s "
-                  "LEFT JOIN attendance a ON s.roll_no = a.roll_no AND a.subject = ? "
-                  "ORDER BY s.roll_no");
-    query.addBindValue(subject);
-    
-    QString stats = "📊 Attendance Statistics for " + subject + "\n\n";
-    stats += "Roll No\t\tName\t\t\tStatus\n";
-    stats += "─────────────────────────────────────────────\n";
-    
-    int presentCount = 0, absentCount = 0, notMarkedCount = 0;
-    
-    if (query.exec()) {
-        while (query.next()) {
-            QString rollNo = query.value(0).toString();
-            QString name = query.value(1).toString();
-            QString status = query.value(2).toString();
-            
-            if (status.isEmpty()) {
-                status = "Not Marked";
-                notMarkedCount++;
-            } else if (status == "Present") {
-                presentCount++;
-            } else {
-                absentCount++;
-            }
-            
-            stats += QString("%1\t%2\t\t%3\n")
-                    .arg(rollNo, -12)
-                    .arg(name, -20)
-                    .arg(status);
-        }
+    statusLabel->clear();
+    if (channel == "attendance.save") {
+        saveBtn->setEnabled(true);
+        QMessageBox::critical(this, "Error",
+                              "Failed to save attendance: " + error +
+                              "\nNo changes were saved.");
+        return;
     }
     
-    int total = presentCount + absentCount + notMarkedCount;
-    double presentPercentage = (total > 0) ? (presentCount * 100.0 / total) : 0;
-    
-    stats += "\n─────────────────────────────────────────────\n";
-    stats += QString("Total Students: %1\n").arg(total);
-    stats += QString("Present: %1\n").arg(presentCount);
-    stats += QString("Absent: %1\n").arg(absentCount);
-    stats += QString("Not Marked: %1\n").arg(notMarkedCount);
-    stats += QString("Overall Attendance: %1%").arg(presentPercentage, 0, 'f', 1);
-    
-    QMessageBox::information(this, "Attendance Statistics", stats);
+    QMessageBox::critical(this, "Error", "Database error: " + error);
 }
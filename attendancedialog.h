@@ -3,43 +3,62 @@
 
 #include <QDialog>
 #include <QComboBox>
-#include <QTableWidget>
+#include <QDateEdit>
+#include <QSpinBox>
+#include <QTableView>
 #include <QPushButton>
 #include <QSqlDatabase>
-#include <QCheckBox>
+#include <QLabel>
+
+#include "queryexecutor.h"
+#include "studentrepository.h"
+#include "attendancerepository.h"
+#include "attendancerostermodel.h"
 
 class AttendanceDialog : public QDialog {
     Q_OBJECT
 
 public:
-    explicit AttendanceDialog(QSqlDatabase &database, QWidget *parent = nullptr);
+    // Table-wide reads and the attendance save run on the executor's worker
+    // thread; with no executor they run inline on database.
+    AttendanceDialog(QSqlDatabase &database, QueryExecutor *queryExecutor,
+                     QWidget *parent = nullptr);
 
 private slots:
     void loadStudents();
     void markAttendance();
-    void viewAttendance();
     void markAllPresent();
     void markAllAbsent();
     void calculateAttendanceStats();
+    void onQueryFinished(quint64 ticket, const QString &channel, const QVariant &result);
+    void onQueryFailed(quint64 ticket, const QString &channel, const QString &error);
 
 private:
     QSqlDatabase &db;
+    QueryExecutor *executor;
     
     // UI Components
     QComboBox *branchCombo;
     QComboBox *yearCombo;
     QComboBox *subjectCombo;
-    QTableWidget *studentTable;
+    QDateEdit *dateEdit;
+    QSpinBox *periodSpin;
+    QTableView *studentTable;
+    AttendanceRosterModel *rosterModel;
+    QLabel *statusLabel;
     
     QPushButton *loadBtn;
     QPushButton *saveBtn;
-    QPushButton *viewBtn;
     QPushButton *allPresentBtn;
     QPushButton *allAbsentBtn;
     QPushButton *statsBtn;
     
     void setupUI();
     void loadSubjects();
+    void runQuery(const QString &channel, const QueryExecutor::Task &task);
+    void populateAttendance(const QVector<AttendanceRecord> &records);
+    void showRosterSize();
+    QString sessionName() const;
 };
 
 #endif // ATTENDANCEDIALOG_H
@@ -0,0 +1,231 @@
+#include "attendancereportmodel.h"
+
+#include <QColor>
+#include <QStringList>
+
+#include <algorithm>
+
+namespace {
+
+QStringList headers(AttendanceReportModel::View view)
+{
+    switch (view) {
+    case AttendanceReportModel::StudentView:
+        return {"Roll No", "Name", "Branch", "Year", "Attended", "Held", "Attendance %", "Status"};
+    case AttendanceReportModel::StudentSubjectView:
+        return {"Roll No", "Name", "Branch", "Year", "Subject", "Attended", "Held",
+                "Attendance %", "Status"};
+    case AttendanceReportModel::SubjectView:
+        return {"Subject", "Sessions", "Attended", "Held", "Attendance %", "Students Below"};
+    default:
+        return {"Branch", "Year", "Students", "Attended", "Held", "Attendance %", "Students Below"};
+    }
+}
+
+} // namespace
+
+AttendanceReportModel::AttendanceReportModel(View view, QObject *parent)
+    : QAbstractTableModel(parent),
+      view(view),
+      columns(headers(view)),
+      percentColumn(columns.indexOf("Attendance %")),
+      belowOnly(false),
+      sortColumn(-1),
+      sortOrder(Qt::AscendingOrder)
+{
+}
+
+int AttendanceReportModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int AttendanceReportModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : columns.size();
+}
+
+int AttendanceReportModel::percentageColumn() const
+{
+    return percentColumn;
+}
+
+QVariant AttendanceReportModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return QVariant();
+
+    int source = rows[index.row()];
+
+    if (role == Qt::BackgroundRole)
+        return isBelow(source) ? QVariant(QColor(231, 76, 60, 50)) : QVariant();
+
+    QVariant v = value(source, index.column());
+
+    if (role == Qt::TextAlignmentRole) {
+        if (v.type() == QVariant::String)
+            return QVariant();
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    if (index.column() == percentColumn)
+        return QString::number(v.toDouble(), 'f', 1);
+    return v;
+}
+
+QVariant AttendanceReportModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+    return columns.value(section);
+}
+
+// =========================================
+// Rows
+// =========================================
+
+int AttendanceReportModel::sourceCount() const
+{
+    switch (view) {
+    case StudentView:        return report.students.size();
+    case StudentSubjectView: return report.studentSubjects.size();
+    case SubjectView:        return report.subjectTotals.size();
+    default:                 return report.sections.size();
+    }
+}
+
+bool AttendanceReportModel::isBelow(int source) const
+{
+    switch (view) {
+    case StudentView:        return report.students[source].below;
+    case StudentSubjectView: return report.studentSubjects[source].below;
+    default:                 return false;
+    }
+}
+
+// The raw value behind a cell: numbers stay numbers for sorting
+QVariant AttendanceReportModel::value(int source, int column) const
+{
+    auto status = [&](const AttendanceCount &count, bool below) {
+        if (count.held == 0)
+            return QString("No sessions");
+        return below ? QString("Below %1%").arg(report.query.threshold) : QString("OK");
+    };
+
+    switch (view) {
+    case StudentView: {
+        const StudentAttendance &s = report.students[source];
+        switch (column) {
+        case 0: return s.rollNo;
+        case 1: return s.name;
+        case 2: return s.branch;
+        case 3: return s.year;
+        case 4: return s.count.attended;
+        case 5: return s.count.held;
+        case 6: return s.count.percentage();
+        case 7: return status(s.count, s.below);
+        }
+        break;
+    }
+    case StudentSubjectView: {
+        const StudentSubjectAttendance &r = report.studentSubjects[source];
+        const StudentAttendance &s = report.students[r.student];
+        switch (column) {
+        case 0: return s.rollNo;
+        case 1: return s.name;
+        case 2: return s.branch;
+        case 3: return s.year;
+        case 4: return report.subjects[r.subject];
+        case 5: return r.count.attended;
+        case 6: return r.count.held;
+        case 7: return r.count.percentage();
+        case 8: return status(r.count, r.below);
+        }
+        break;
+    }
+    case SubjectView: {
+        const SubjectAttendance &t = report.subjectTotals[source];
+        switch (column) {
+        case 0: return t.subject;
+        case 1: return t.sessions;
+        case 2: return t.count.attended;
+        case 3: return t.count.held;
+        case 4: return t.count.percentage();
+        case 5: return t.studentsBelow;
+        }
+        break;
+    }
+    case SectionView: {
+        const SectionAttendance &t = report.sections[source];
+        switch (column) {
+        case 0: return t.branch;
+        case 1: return t.year;
+        case 2: return t.students;
+        case 3: return t.count.attended;
+        case 4: return t.count.held;
+        case 5: return t.count.percentage();
+        case 6: return t.studentsBelow;
+        }
+        break;
+    }
+    }
+    return QVariant();
+}
+
+void AttendanceReportModel::setReport(const AttendanceReport &newReport)
+{
+    beginResetModel();
+    report = newReport;
+    rebuild();
+    endResetModel();
+}
+
+void AttendanceReportModel::setBelowOnly(bool on)
+{
+    if (belowOnly == on)
+        return;
+    beginResetModel();
+    belowOnly = on;
+    rebuild();
+    endResetModel();
+}
+
+void AttendanceReportModel::sort(int column, Qt::SortOrder order)
+{
+    beginResetModel();
+    sortColumn = column;
+    sortOrder = order;
+    rebuild();
+    endResetModel();
+}
+
+// Filters, then applies the current sort; stable, so equal rows keep the
+// report's order (roll_no for students)
+void AttendanceReportModel::rebuild()
+{
+    rows.clear();
+    const int count = sourceCount();
+    rows.reserve(count);
+    for (int i = 0; i < count; i++) {
+        if (!belowOnly || isBelow(i))
+            rows.append(i);
+    }
+
+    if (sortColumn < 0 || sortColumn >= columnCount())
+        return;
+
+    const bool ascending = sortOrder == Qt::AscendingOrder;
+    std::stable_sort(rows.begin(), rows.end(), [&](int a, int b) {
+        QVariant x = value(a, sortColumn);
+        QVariant y = value(b, sortColumn);
+        int c;
+        if (x.type() == QVariant::String)
+            c = QString::compare(x.toString(), y.toString(), Qt::CaseInsensitive);
+        else
+            c = x.toDouble() < y.toDouble() ? -1 : (y.toDouble() < x.toDouble() ? 1 : 0);
+        return ascending ? c < 0 : c > 0;
+    });
+}
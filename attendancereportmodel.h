@@ -0,0 +1,59 @@
+#ifndef ATTENDANCEREPORTMODEL_H
+#define ATTENDANCEREPORTMODEL_H
+
+#include "attendanceanalytics.h"
+
+#include <QAbstractTableModel>
+#include <QStringList>
+#include <QVector>
+
+// One table of an AttendanceReport: students, students by subject, subjects
+// or sections. Rows below the threshold are tinted. Sorting reorders an
+// index over the report's rows, numbers as numbers, so sorting a school's
+// worth of students copies nothing.
+class AttendanceReportModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum View {
+        StudentView,
+        StudentSubjectView,
+        SubjectView,
+        SectionView
+    };
+
+    explicit AttendanceReportModel(View view, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    void setReport(const AttendanceReport &report);
+
+    // Student views only: hide the rows at or above the threshold
+    void setBelowOnly(bool on);
+
+    // Column holding the attendance percentage
+    int percentageColumn() const;
+
+private:
+    View view;
+    QStringList columns;        // the view's headers, fixed with it
+    int percentColumn;
+    AttendanceReport report;
+    QVector<int> rows;          // displayed row -> index into the view's vector
+    bool belowOnly;
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+
+    int sourceCount() const;
+    bool isBelow(int source) const;
+    QVariant value(int source, int column) const;
+    void rebuild();
+};
+
+#endif // ATTENDANCEREPORTMODEL_H
@@ -0,0 +1,575 @@
+#include "attendancerepository.h"
+#include "statementcache.h"
+#include "querystats.h"
+#include "studentprofile.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QMap>
+#include <QStringList>
+
+// SQLite's default SQLITE_MAX_VARIABLE_NUMBER before 3.32
+static const int MaxBindValues = 999;
+
+AttendanceRepository::AttendanceRepository(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QVector<AttendanceSummary> AttendanceRepository::summaryForStudent(const QString &rollNo)
+{
+    QVector<AttendanceSummary> summaries;
+
+    int ordinal = ordinalOf(rollNo);
+    if (ordinal < 0)
+        return summaries;
+    const int offset = ordinal % AttendanceBitmap::BlockBits;
+
+    // Only the sessions with a block this student falls in; CROSS JOIN
+    // keeps the planner on the block index
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT s.subject, b.roster, b.present FROM attendance_bits b "
+        "CROSS JOIN attendance_sessions s ON s.session_id = b.session_id "
+        "WHERE b.block = ?");
+    q.addBindValue(ordinal / AttendanceBitmap::BlockBits);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return summaries;
+    }
+
+    QMap<QString, AttendanceSummary> bySubject;
+    while (trace.next()) {
+        if (!AttendanceBitmap::blockContains(q.value(1).toByteArray(), offset))
+            continue;
+        AttendanceSummary &summary = bySubject[q.value(0).toString()];
+        summary.held++;
+        if (AttendanceBitmap::blockContains(q.value(2).toByteArray(), offset))
+            summary.present++;
+    }
+
+    for (auto it = bySubject.begin(); it != bySubject.end(); ++it) {
+        it.value().subject = it.key();
+        summaries.append(it.value());
+    }
+    return summaries;
+}
+
+QVector<AttendanceRecord> AttendanceRepository::forClass(const QString &subject, const QDate &date,
+                                                         int period, const QString &branch, int year)
+{
+    QVector<AttendanceRecord> records;
+
+    AttendanceBitmap roster, present;
+    qint64 session = sessionId(subject, date, period, false);
+    if (session < 0 || (session > 0 && !loadBits(session, roster, present)))
+        return records;
+
+    QString sql = "SELECT s.roll_no, s.name, s.branch, s.year, o.ordinal "
+                  "FROM students s "
+                  "JOIN student_ordinals o ON o.roll_no = s.roll_no "
+                  "WHERE 1=1";
+    if (!branch.isEmpty())
+        sql += " AND s.branch = ?";
+    if (year > 0)
+        sql += " AND s.year = ?";
+    sql += " ORDER BY s.roll_no";
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    if (!branch.isEmpty())
+        q.addBindValue(branch);
+    if (year > 0)
+        q.addBindValue(year);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return records;
+    }
+
+    while (trace.next()) {
+        int ordinal = q.value(4).toInt();
+        AttendanceRecord r;
+        r.rollNo  = q.value(0).toString();
+        r.name    = q.value(1).toString();
+        r.branch  = q.value(2).toString();
+        r.year    = q.value(3).toInt();
+        r.subject = subject;
+        r.status  = !roster.test(ordinal) ? "Not Marked"
+                    : present.test(ordinal) ? "Present" : "Absent";
+        r.ordinal = ordinal;
+        records.append(r);
+    }
+    return records;
+}
+
+bool AttendanceRepository::save(const QString &subject, const QDate &date, int period,
+                                 const QVector<AttendanceRecord> &records)
+{
+    AttendanceBitmap roster, present;
+    for (const AttendanceRecord &r : records) {
+        if (r.ordinal < 0) {
+            error = "Unknown student " + r.rollNo;
+            return false;
+        }
+        roster.set(r.ordinal);
+        present.set(r.ordinal, r.status == "Present");
+    }
+    return save(subject, date, period, roster, present);
+}
+
+// Read-modify-write of the session's blocks in one savepoint: the saved
+// students take their new bits, everyone else keeps theirs
+bool AttendanceRepository::save(const QString &subject, const QDate &date, int period,
+                                 const AttendanceBitmap &roster, const AttendanceBitmap &present)
+{
+    if (roster.isEmpty())
+        return true;
+    if (subject.isEmpty() || !date.isValid()) {
+        error = "A session needs a subject and a date";
+        return false;
+    }
+    if (!begin())
+        return false;
+
+    qint64 session = sessionId(subject, date, period, true);
+    AttendanceBitmap heldBits, presentBits;
+    if (session <= 0 || !loadBits(session, heldBits, presentBits)) {
+        rollback();
+        return false;
+    }
+
+    const AttendanceBitmap oldHeld = heldBits;
+    const AttendanceBitmap oldPresent = presentBits;
+
+    AttendanceBitmap presentInRoster = present;
+    presentInRoster.intersect(roster);
+    heldBits.unite(roster);
+    presentBits.subtract(roster);
+    presentBits.unite(presentInRoster);
+
+    StatementCache &statements = StatementCache::forDatabase(db);
+    QSqlQuery &bits = statements.prepared(
+        "INSERT INTO attendance_bits (session_id, block, roster, present) VALUES (?, ?, ?, ?) "
+        "ON CONFLICT(session_id, block) DO UPDATE SET "
+        " roster = excluded.roster, present = excluded.present");
+    for (int block : roster.blocks()) {
+        bits.addBindValue(session);
+        bits.addBindValue(block);
+        bits.addBindValue(heldBits.encodeBlock(block));
+        // Never NULL, even with nobody present
+        QByteArray presentBlock = presentBits.encodeBlock(block);
+        bits.addBindValue(presentBlock.isNull() ? QByteArray("") : presentBlock);
+        if (!QueryTrace(bits).exec()) {
+            error = bits.lastError().text();
+            rollback();
+            return false;
+        }
+    }
+
+    QSqlQuery &counts = statements.prepared(
+        "UPDATE attendance_sessions SET held = ?, present = ? WHERE session_id = ?");
+    counts.addBindValue(heldBits.count());
+    counts.addBindValue(presentBits.count());
+    counts.addBindValue(session);
+    if (!QueryTrace(counts).exec()) {
+        error = counts.lastError().text();
+        rollback();
+        return false;
+    }
+
+    if (!totalsDeferred && !addTotals(roster, oldHeld, oldPresent, heldBits, presentBits)) {
+        rollback();
+        return false;
+    }
+    if (!commit())
+        return false;
+
+    StudentProfileRepository::attendanceChanged(db, roster);
+    return true;
+}
+
+// Adds the change of each saved student's bits to their row of
+// student_attendance; students whose bits did not change are not written
+bool AttendanceRepository::addTotals(const AttendanceBitmap &roster,
+                                     const AttendanceBitmap &oldHeld, const AttendanceBitmap &oldPresent,
+                                     const AttendanceBitmap &newHeld, const AttendanceBitmap &newPresent)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "INSERT INTO student_attendance (ordinal, held, present) VALUES (?, ?, ?) "
+        "ON CONFLICT(ordinal) DO UPDATE SET"
+        " held = held + excluded.held, present = present + excluded.present");
+
+    bool ok = true;
+    roster.forEach([&](int ordinal) {
+        if (!ok)
+            return;
+        int held = int(newHeld.test(ordinal)) - int(oldHeld.test(ordinal));
+        int attended = int(newPresent.test(ordinal)) - int(oldPresent.test(ordinal));
+        if (held == 0 && attended == 0)
+            return;
+        q.addBindValue(ordinal);
+        q.addBindValue(held);
+        q.addBindValue(attended);
+        if (!QueryTrace(q).exec()) {
+            error = q.lastError().text();
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+void AttendanceRepository::setTotalsDeferred(bool deferred)
+{
+    totalsDeferred = deferred;
+}
+
+// Counts every student's sessions in one pass over the bitmaps and
+// replaces student_attendance with them
+bool AttendanceRepository::rebuildTotals()
+{
+    AttendanceCounter held, attended;
+    bool ok = forEachSession([&](const AttendanceSession &, const AttendanceBitmap &roster,
+                                 const AttendanceBitmap &present) {
+        held.add(roster);
+        attended.add(present, roster);
+        return true;
+    });
+    if (!ok)
+        return false;
+
+    if (!begin())
+        return false;
+
+    QSqlQuery q(db);
+    if (!QueryTrace(q).exec("DELETE FROM student_attendance")) {
+        error = q.lastError().text();
+        rollback();
+        return false;
+    }
+
+    // Multi-row inserts, three values a row
+    const int rowsPerInsert = MaxBindValues / 3;
+    QVector<int> ordinals;
+    for (int ordinal = 0; ordinal < held.size(); ordinal++) {
+        if (held.value(ordinal) > 0)
+            ordinals.append(ordinal);
+    }
+    for (int start = 0; start < ordinals.size(); start += rowsPerInsert) {
+        const int rows = qMin(rowsPerInsert, ordinals.size() - start);
+        QStringList values;
+        for (int i = 0; i < rows; i++)
+            values << "(?, ?, ?)";
+
+        QSqlQuery insert(db);
+        insert.prepare("INSERT INTO student_attendance (ordinal, held, present) VALUES "
+                       + values.join(", "));
+        for (int i = start; i < start + rows; i++) {
+            insert.addBindValue(ordinals[i]);
+            insert.addBindValue(held.value(ordinals[i]));
+            insert.addBindValue(attended.value(ordinals[i]));
+        }
+        if (!QueryTrace(insert).exec()) {
+            error = insert.lastError().text();
+            rollback();
+            return false;
+        }
+    }
+    return commit();
+}
+
+QVector<AttendanceSession> AttendanceRepository::sessions(const QString &subject,
+                                                          const QDate &from, const QDate &to)
+{
+    QVector<AttendanceSession> list;
+
+    QString sql = "SELECT session_id, subject, session_date, period, held, present "
+                  "FROM attendance_sessions WHERE 1=1";
+    if (!subject.isEmpty())
+        sql += " AND subject = ?";
+    if (from.isValid())
+        sql += " AND session_date >= ?";
+    if (to.isValid())
+        sql += " AND session_date <= ?";
+    sql += " ORDER BY subject, session_date, period";
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    if (!subject.isEmpty())
+        q.addBindValue(subject);
+    if (from.isValid())
+        q.addBindValue(from.toString(Qt::ISODate));
+    if (to.isValid())
+        q.addBindValue(to.toString(Qt::ISODate));
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return list;
+    }
+
+    while (trace.next()) {
+        AttendanceSession s;
+        s.sessionId = q.value(0).toLongLong();
+        s.subject   = q.value(1).toString();
+        s.date      = QDate::fromString(q.value(2).toString(), Qt::ISODate);
+        s.period    = q.value(3).toInt();
+        s.held      = q.value(4).toInt();
+        s.present   = q.value(5).toInt();
+        list.append(s);
+    }
+    return list;
+}
+
+bool AttendanceRepository::forEachSession(const SessionVisitor &visit, const QString &subject,
+                                          const QDate &from, const QDate &to)
+{
+    // Sessions in unique-key order and each session's blocks in primary
+    // key order, so a session's rows arrive together
+    QString sql = "SELECT s.session_id, s.subject, s.session_date, s.period, s.held, s.present,"
+                  " b.block, b.roster, b.present "
+                  "FROM attendance_sessions s "
+                  "LEFT JOIN attendance_bits b ON b.session_id = s.session_id "
+                  "WHERE 1=1";
+    if (!subject.isEmpty())
+        sql += " AND s.subject = ?";
+    if (from.isValid())
+        sql += " AND s.session_date >= ?";
+    if (to.isValid())
+        sql += " AND s.session_date <= ?";
+    sql += " ORDER BY s.subject, s.session_date, s.period, b.block";
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare(sql);
+    if (!subject.isEmpty())
+        q.addBindValue(subject);
+    if (from.isValid())
+        q.addBindValue(from.toString(Qt::ISODate));
+    if (to.isValid())
+        q.addBindValue(to.toString(Qt::ISODate));
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    AttendanceSession session;
+    AttendanceBitmap roster, present;
+    while (trace.next()) {
+        qint64 id = q.value(0).toLongLong();
+        if (id != session.sessionId) {
+            if (session.sessionId != 0 && !visit(session, roster, present))
+                return true;
+            session.sessionId = id;
+            session.subject   = q.value(1).toString();
+            session.date      = QDate::fromString(q.value(2).toString(), Qt::ISODate);
+            session.period    = q.value(3).toInt();
+            session.held      = q.value(4).toInt();
+            session.present   = q.value(5).toInt();
+            roster = AttendanceBitmap();
+            present = AttendanceBitmap();
+        }
+        if (q.isNull(6))
+            continue;
+
+        int block = q.value(6).toInt();
+        if (!roster.decodeBlock(block, q.value(7).toByteArray())
+            || !present.decodeBlock(block, q.value(8).toByteArray())) {
+            error = QString("Damaged attendance block %1 of session %2").arg(block).arg(id);
+            return false;
+        }
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError().text();
+        return false;
+    }
+    if (session.sessionId != 0)
+        visit(session, roster, present);
+    return true;
+}
+
+AttendanceBitmap AttendanceRepository::classMembers(const QString &branch, int year)
+{
+    AttendanceBitmap members;
+
+    QString sql = "SELECT o.ordinal FROM students s "
+                  "JOIN student_ordinals o ON o.roll_no = s.roll_no WHERE 1=1";
+    if (!branch.isEmpty())
+        sql += " AND s.branch = ?";
+    if (year > 0)
+        sql += " AND s.year = ?";
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    if (!branch.isEmpty())
+        q.addBindValue(branch);
+    if (year > 0)
+        q.addBindValue(year);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return members;
+    }
+    while (trace.next())
+        members.set(q.value(0).toInt());
+    return members;
+}
+
+QHash<QString, int> AttendanceRepository::ordinals()
+{
+    QHash<QString, int> map;
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    QueryTrace trace(q);
+    if (!trace.exec("SELECT o.roll_no, o.ordinal FROM student_ordinals o "
+                    "JOIN students s ON s.roll_no = o.roll_no")) {
+        error = q.lastError().text();
+        return map;
+    }
+    while (trace.next())
+        map.insert(q.value(0).toString(), q.value(1).toInt());
+    return map;
+}
+
+QVector<QString> AttendanceRepository::rollNosByOrdinal()
+{
+    QVector<QString> rollNos;
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    QueryTrace trace(q);
+    if (!trace.exec("SELECT o.roll_no, o.ordinal FROM student_ordinals o "
+                    "JOIN students s ON s.roll_no = o.roll_no")) {
+        error = q.lastError().text();
+        return rollNos;
+    }
+    while (trace.next()) {
+        int ordinal = q.value(1).toInt();
+        if (ordinal >= rollNos.size())
+            rollNos.resize(ordinal + 1);
+        rollNos[ordinal] = q.value(0).toString();
+    }
+    return rollNos;
+}
+
+QString AttendanceRepository::lastError() const
+{
+    return error;
+}
+
+// =========================================
+// Helpers
+// =========================================
+
+// -1 for an unknown student (error stays empty) or a failed query
+int AttendanceRepository::ordinalOf(const QString &rollNo)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT o.ordinal FROM student_ordinals o "
+        "JOIN students s ON s.roll_no = o.roll_no WHERE o.roll_no = ?");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return -1;
+    }
+    int ordinal = trace.next() ? q.value(0).toInt() : -1;
+    trace.finish();
+    return ordinal;
+}
+
+// 0 when the session does not exist and create is false, -1 on error
+qint64 AttendanceRepository::sessionId(const QString &subject, const QDate &date, int period,
+                                       bool create)
+{
+    StatementCache &statements = StatementCache::forDatabase(db);
+    const QString day = date.toString(Qt::ISODate);
+
+    if (create) {
+        QSqlQuery &insert = statements.prepared(
+            "INSERT INTO attendance_sessions (subject, session_date, period) VALUES (?, ?, ?) "
+            "ON CONFLICT(subject, session_date, period) DO NOTHING");
+        insert.addBindValue(subject);
+        insert.addBindValue(day);
+        insert.addBindValue(period);
+        if (!QueryTrace(insert).exec()) {
+            error = insert.lastError().text();
+            return -1;
+        }
+    }
+
+    QSqlQuery &q = statements.prepared(
+        "SELECT session_id FROM attendance_sessions "
+        "WHERE subject = ? AND session_date = ? AND period = ?");
+    q.addBindValue(subject);
+    q.addBindValue(day);
+    q.addBindValue(period);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return -1;
+    }
+    qint64 id = trace.next() ? q.value(0).toLongLong() : 0;
+    trace.finish();
+    return id;
+}
+
+bool AttendanceRepository::loadBits(qint64 session, AttendanceBitmap &roster,
+                                    AttendanceBitmap &present)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT block, roster, present FROM attendance_bits WHERE session_id = ?");
+    q.addBindValue(session);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    while (trace.next()) {
+        int block = q.value(0).toInt();
+        if (!roster.decodeBlock(block, q.value(1).toByteArray())
+            || !present.decodeBlock(block, q.value(2).toByteArray())) {
+            error = QString("Damaged attendance block %1 of session %2").arg(block).arg(session);
+            trace.finish();
+            return false;
+        }
+    }
+    return true;
+}
+
+// A savepoint rather than BEGIN, like MarksRepository, so importers and
+// the schema migrator can save sessions inside their own transaction
+bool AttendanceRepository::begin()
+{
+    QSqlQuery q(db);
+    if (!QueryTrace(q).exec("SAVEPOINT attendance_write")) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool AttendanceRepository::commit()
+{
+    QSqlQuery q(db);
+    if (!QueryTrace(q).exec("RELEASE attendance_write")) {
+        error = q.lastError().text();
+        rollback();
+        return false;
+    }
+    return true;
+}
+
+void AttendanceRepository::rollback()
+{
+    QSqlQuery q(db);
+    QueryTrace(q).exec("ROLLBACK TO attendance_write");
+    QueryTrace(q).exec("RELEASE attendance_write");
+}
@@ -0,0 +1,134 @@
+#ifndef ATTENDANCEREPOSITORY_H
+#define ATTENDANCEREPOSITORY_H
+
+#include "attendancebitmap.h"
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QDate>
+#include <QMetaType>
+
+#include <functional>
+
+struct AttendanceRecord
+{
+    QString rollNo;
+    QString name;
+    QString branch;
+    int     year = 0;
+    QString subject;
+    QString status;     // "Present", "Absent" or "Not Marked"
+    int     ordinal = -1;   // student_ordinals.ordinal, as forClass() read it
+};
+
+Q_DECLARE_METATYPE(AttendanceRecord)
+
+// One class meeting: a subject on a date in a period. held and present
+// count the students on its roster and those present.
+struct AttendanceSession
+{
+    qint64  sessionId = 0;
+    QString subject;
+    QDate   date;
+    int     period = 1;
+    int     held = 0;
+    int     present = 0;
+};
+
+// Sessions held and attended by one student in one subject
+struct AttendanceSummary
+{
+    QString subject;
+    int     held = 0;
+    int     present = 0;
+
+    double percentage() const { return held > 0 ? present * 100.0 / held : 0.0; }
+};
+
+// Dated attendance. A session is one row of attendance_sessions per
+// (subject, date, period); who was on its roster and who was present are
+// two AttendanceBitmaps over student ordinals, stored per block of 4096
+// ordinals in attendance_bits. Saving a section's roster rewrites the one
+// or two blocks its students fall in, not a row per student.
+//
+// Sessions are shared between sections: saving one section's roster
+// leaves the other students of the session as they were.
+//
+// student_attendance keeps each student's sessions held and attended over
+// all subjects, updated by save() with the change of the saved students'
+// bits; the class dashboards are built on it. Bulk writers defer the
+// updates and call rebuildTotals() once at the end.
+class AttendanceRepository
+{
+public:
+    // Period 0 holds the statuses carried over from the undated table
+    static const int UndatedPeriod = 0;
+
+    explicit AttendanceRepository(const QSqlDatabase &database);
+
+    // Per subject, for the student page
+    QVector<AttendanceSummary> summaryForStudent(const QString &rollNo);
+
+    // Every student of the class with their status in the session. Empty
+    // branch / year 0 means all branches / years.
+    QVector<AttendanceRecord> forClass(const QString &subject, const QDate &date, int period,
+                                       const QString &branch = QString(), int year = 0);
+
+    // Sets the status of every record in the session by its ordinal,
+    // creating the session if needed; nothing is written if any row fails
+    bool save(const QString &subject, const QDate &date, int period,
+              const QVector<AttendanceRecord> &records);
+
+    // Same for bitmaps: the students in roster get present's bit
+    bool save(const QString &subject, const QDate &date, int period,
+              const AttendanceBitmap &roster, const AttendanceBitmap &present);
+
+    // Sessions of subject (empty = all) between from and to inclusive
+    // (invalid = open), in subject, date, period order
+    QVector<AttendanceSession> sessions(const QString &subject = QString(),
+                                        const QDate &from = QDate(), const QDate &to = QDate());
+
+    // One ordered pass over the same sessions with their bitmaps; stops
+    // early when visit returns false
+    using SessionVisitor = std::function<bool(const AttendanceSession &session,
+                                              const AttendanceBitmap &roster,
+                                              const AttendanceBitmap &present)>;
+    bool forEachSession(const SessionVisitor &visit, const QString &subject = QString(),
+                        const QDate &from = QDate(), const QDate &to = QDate());
+
+    // Ordinals of the students of a class; empty branch / year 0 means
+    // all branches / years
+    AttendanceBitmap classMembers(const QString &branch = QString(), int year = 0);
+
+    // While deferred, save() leaves student_attendance alone
+    void setTotalsDeferred(bool deferred);
+    bool rebuildTotals();
+
+    // roll_no -> ordinal of every student
+    QHash<QString, int> ordinals();
+    // Indexed by ordinal; empty where there is no student
+    QVector<QString> rollNosByOrdinal();
+
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+    bool totalsDeferred = false;
+
+    int ordinalOf(const QString &rollNo);
+    qint64 sessionId(const QString &subject, const QDate &date, int period, bool create);
+    bool loadBits(qint64 session, AttendanceBitmap &roster, AttendanceBitmap &present);
+    bool addTotals(const AttendanceBitmap &roster,
+                   const AttendanceBitmap &oldHeld, const AttendanceBitmap &oldPresent,
+                   const AttendanceBitmap &newHeld, const AttendanceBitmap &newPresent);
+
+    bool begin();
+    bool commit();
+    void rollback();
+};
+
+#endif // ATTENDANCEREPOSITORY_H
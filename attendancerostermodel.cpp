@@ -0,0 +1,219 @@
+#include "attendancerostermodel.h"
+
+#include <QColor>
+
+AttendanceRosterModel::AttendanceRosterModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int AttendanceRosterModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int AttendanceRosterModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant AttendanceRosterModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return QVariant();
+
+    const Entry &e = rows[index.row()];
+
+    if (role == Qt::BackgroundRole) {
+        switch (e.status) {
+        case Present: return QColor(39, 174, 96, 50);
+        case Absent:  return QColor(231, 76, 60, 50);
+        default:      return QVariant();
+        }
+    }
+
+    if (role == Qt::CheckStateRole && index.column() == PresentColumn)
+        return e.status == Present ? Qt::Checked : Qt::Unchecked;
+
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    switch (index.column()) {
+    case RollNoColumn: return e.rollNo;
+    case NameColumn:   return e.name;
+    case BranchColumn: return e.branch;
+    case YearColumn:   return int(e.year);
+    case StatusColumn: return statusText(e.status);
+    default:           return QVariant();
+    }
+}
+
+bool AttendanceRosterModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return false;
+    if (role != Qt::CheckStateRole || index.column() != PresentColumn)
+        return false;
+
+    Status status = value.toInt() == Qt::Checked ? Present : Absent;
+    Entry &e = rows[index.row()];
+    if (e.status == status)
+        return true;
+
+    // Status text and background of the whole row change with it
+    e.status = status;
+    emit dataChanged(this->index(index.row(), 0), this->index(index.row(), ColumnCount - 1),
+                     {Qt::DisplayRole, Qt::CheckStateRole, Qt::BackgroundRole});
+    return true;
+}
+
+Qt::ItemFlags AttendanceRosterModel::flags(const QModelIndex &index) const
+{
+    Qt::ItemFlags f = QAbstractTableModel::flags(index);
+    if (index.isValid() && index.column() == PresentColumn)
+        f |= Qt::ItemIsUserCheckable;
+    return f;
+}
+
+QVariant AttendanceRosterModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case RollNoColumn:  return "Roll No";
+    case NameColumn:    return "Name";
+    case BranchColumn:  return "Branch";
+    case YearColumn:    return "Year";
+    case PresentColumn: return "Present";
+    case StatusColumn:  return "Status";
+    default:            return QVariant();
+    }
+}
+
+// =========================================
+// Loading
+// =========================================
+
+void AttendanceRosterModel::setStudents(const QVector<StudentRecord> &students)
+{
+    branches.clear();
+    QVector<Entry> entries;
+    entries.reserve(students.size());
+    for (const StudentRecord &s : students)
+        entries.append({s.rollNo, s.name, intern(s.branch), quint16(s.year), Absent, -1});
+    reset(entries);
+}
+
+void AttendanceRosterModel::setAttendance(const QVector<AttendanceRecord> &records)
+{
+    branches.clear();
+    QVector<Entry> entries;
+    entries.reserve(records.size());
+    for (const AttendanceRecord &r : records)
+        entries.append({r.rollNo, r.name, intern(r.branch), quint16(r.year),
+                        statusFromText(r.status), r.ordinal});
+    reset(entries);
+}
+
+void AttendanceRosterModel::reset(QVector<Entry> &entries)
+{
+    beginResetModel();
+    rows.swap(entries);
+    rows.squeeze();
+    endResetModel();
+}
+
+const QString &AttendanceRosterModel::intern(const QString &branch)
+{
+    // A class has a handful of branches; share one string per branch
+    // instead of keeping a copy per row
+    auto it = branches.find(branch);
+    if (it == branches.end())
+        it = branches.insert(branch, branch);
+    return it.value();
+}
+
+// =========================================
+// Bulk changes and saving
+// =========================================
+
+void AttendanceRosterModel::setAllStatus(Status status)
+{
+    if (rows.isEmpty())
+        return;
+
+    for (Entry &e : rows)
+        e.status = status;
+
+    emit dataChanged(index(0, 0), index(rows.size() - 1, ColumnCount - 1),
+                     {Qt::DisplayRole, Qt::CheckStateRole, Qt::BackgroundRole});
+}
+
+QVector<AttendanceRecord> AttendanceRosterModel::records() const
+{
+    QVector<AttendanceRecord> out;
+    out.reserve(rows.size());
+    for (const Entry &e : rows) {
+        AttendanceRecord r;
+        r.rollNo = e.rollNo;
+        r.status = e.status == Present ? "Present" : "Absent";
+        r.ordinal = e.ordinal;
+        out.append(r);
+    }
+    return out;
+}
+
+bool AttendanceRosterModel::bitmaps(AttendanceBitmap &roster, AttendanceBitmap &present) const
+{
+    roster = AttendanceBitmap();
+    present = AttendanceBitmap();
+    for (const Entry &e : rows) {
+        if (e.ordinal < 0)
+            return false;
+        roster.set(e.ordinal);
+        present.set(e.ordinal, e.status == Present);
+    }
+    return true;
+}
+
+int AttendanceRosterModel::bytesPerRow() const
+{
+    if (rows.isEmpty())
+        return 0;
+
+    // QString payload: array header plus UTF-16 code units and terminator
+    auto stringBytes = [](const QString &s) {
+        return int(sizeof(QArrayData)) + (s.capacity() + 1) * int(sizeof(QChar));
+    };
+
+    qint64 total = qint64(rows.capacity()) * sizeof(Entry);
+    for (const Entry &e : rows)
+        total += stringBytes(e.rollNo) + stringBytes(e.name);
+    for (const QString &branch : branches)
+        total += stringBytes(branch);
+
+    return int(total / rows.size());
+}
+
+// =========================================
+// Status text
+// =========================================
+
+QString AttendanceRosterModel::statusText(Status status)
+{
+    switch (status) {
+    case Present: return "Present";
+    case Absent:  return "Absent";
+    default:      return "Not Marked";
+    }
+}
+
+AttendanceRosterModel::Status AttendanceRosterModel::statusFromText(const QString &text)
+{
+    if (text == "Present")
+        return Present;
+    if (text == "Absent")
+        return Absent;
+    return NotMarked;
+}
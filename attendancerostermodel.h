@@ -0,0 +1,83 @@
+#ifndef ATTENDANCEROSTERMODEL_H
+#define ATTENDANCEROSTERMODEL_H
+
+#include "studentrepository.h"
+#include "attendancerepository.h"
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QVector>
+
+// The attendance roster of one class. The Present column is checkable
+// through Qt::CheckStateRole; Status and the row colour follow from it.
+// Rows are kept compact (no per-row widgets or items), so a section of a
+// few thousand students costs a few hundred KiB.
+class AttendanceRosterModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        RollNoColumn,
+        NameColumn,
+        BranchColumn,
+        YearColumn,
+        PresentColumn,
+        StatusColumn,
+        ColumnCount
+    };
+
+    enum Status : quint8 {
+        NotMarked,
+        Absent,
+        Present
+    };
+
+    explicit AttendanceRosterModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    // A fresh roster, everyone Absent
+    void setStudents(const QVector<StudentRecord> &students);
+    // A roster as already recorded for a subject
+    void setAttendance(const QVector<AttendanceRecord> &records);
+
+    // One dataChanged for the whole range
+    void setAllStatus(Status status);
+
+    // Rows to save; Not Marked is saved as Absent
+    QVector<AttendanceRecord> records() const;
+    // The same as bitmaps for AttendanceRepository::save(); false if a row
+    // has no ordinal (a roster from setStudents())
+    bool bitmaps(AttendanceBitmap &roster, AttendanceBitmap &present) const;
+
+    // Approximate heap + inline bytes per row, strings included
+    int bytesPerRow() const;
+
+private:
+    struct Entry {
+        QString rollNo;
+        QString name;
+        QString branch;     // interned, see intern()
+        quint16 year;
+        Status  status;
+        int     ordinal;    // -1 when not known
+    };
+
+    QVector<Entry> rows;
+    QHash<QString, QString> branches;
+
+    const QString &intern(const QString &branch);
+    void reset(QVector<Entry> &entries);
+
+    static QString statusText(Status status);
+    static Status statusFromText(const QString &text);
+};
+
+#endif // ATTENDANCEROSTERMODEL_H
@@ -0,0 +1,212 @@
+#include "attendancestatsdialog.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QTableView>
+#include <QHeaderView>
+#include <QMessageBox>
+#include <QAbstractItemView>
+
+AttendanceStatsDialog::AttendanceStatsDialog(QSqlDatabase &database, QueryExecutor *queryExecutor,
+                                             const QStringList &subjects,
+                                             const AttendanceQuery &initial, QWidget *parent)
+    : QDialog(parent), db(database), executor(queryExecutor)
+{
+    setWindowTitle("📊 Attendance Statistics");
+    resize(1000, 700);
+    setupUI(subjects, initial);
+
+    if (executor) {
+        connect(executor, &QueryExecutor::finished, this, &AttendanceStatsDialog::onQueryFinished);
+        connect(executor, &QueryExecutor::failed, this, &AttendanceStatsDialog::onQueryFailed);
+    }
+
+    calculate();
+}
+
+void AttendanceStatsDialog::setupUI(const QStringList &subjects, const AttendanceQuery &initial) {
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    // Filters
+    QGroupBox *filterBox = new QGroupBox("Range & Threshold");
+    QGridLayout *filterLayout = new QGridLayout(filterBox);
+
+    filterLayout->addWidget(new QLabel("Subject:"), 0, 0);
+    subjectCombo = new QComboBox();
+    subjectCombo->setEditable(true);
+    subjectCombo->addItem("All");
+    subjectCombo->addItems(subjects);
+    subjectCombo->setCurrentText(initial.subject.isEmpty() ? QString("All") : initial.subject);
+    filterLayout->addWidget(subjectCombo, 0, 1);
+
+    filterLayout->addWidget(new QLabel("Branch:"), 0, 2);
+    branchCombo = new QComboBox();
+    branchCombo->addItems({"All", "CSE", "ECE", "EEE", "MECH", "CIVIL", "IT"});
+    branchCombo->setCurrentText(initial.branch.isEmpty() ? QString("All") : initial.branch);
+    filterLayout->addWidget(branchCombo, 0, 3);
+
+    filterLayout->addWidget(new QLabel("Year:"), 0, 4);
+    yearCombo = new QComboBox();
+    yearCombo->addItems({"All", "1", "2", "3", "4"});
+    yearCombo->setCurrentText(initial.year > 0 ? QString::number(initial.year) : QString("All"));
+    filterLayout->addWidget(yearCombo, 0, 5);
+
+    // Unchecked ends leave the range open
+    fromCheck = new QCheckBox("From:");
+    fromCheck->setChecked(initial.from.isValid());
+    filterLayout->addWidget(fromCheck, 1, 0);
+    fromEdit = new QDateEdit(initial.from.isValid() ? initial.from
+                                                    : QDate::currentDate().addMonths(-6));
+    fromEdit->setCalendarPopup(true);
+    fromEdit->setDisplayFormat("yyyy-MM-dd");
+    fromEdit->setEnabled(fromCheck->isChecked());
+    filterLayout->addWidget(fromEdit, 1, 1);
+
+    toCheck = new QCheckBox("To:");
+    toCheck->setChecked(initial.to.isValid());
+    filterLayout->addWidget(toCheck, 1, 2);
+    toEdit = new QDateEdit(initial.to.isValid() ? initial.to : QDate::currentDate());
+    toEdit->setCalendarPopup(true);
+    toEdit->setDisplayFormat("yyyy-MM-dd");
+    toEdit->setEnabled(toCheck->isChecked());
+    filterLayout->addWidget(toEdit, 1, 3);
+
+    filterLayout->addWidget(new QLabel("Threshold:"), 1, 4);
+    thresholdSpin = new QDoubleSpinBox();
+    thresholdSpin->setRange(0.0, 100.0);
+    thresholdSpin->setDecimals(1);
+    thresholdSpin->setSuffix(" %");
+    thresholdSpin->setValue(initial.threshold);
+    filterLayout->addWidget(thresholdSpin, 1, 5);
+
+    belowOnlyCheck = new QCheckBox("Only students below threshold");
+    filterLayout->addWidget(belowOnlyCheck, 2, 0, 1, 3);
+
+    calculateBtn = new QPushButton("📊 Calculate");
+    calculateBtn->setStyleSheet("background-color: #f39c12; color: white; padding: 8px; font-weight: bold;");
+    filterLayout->addWidget(calculateBtn, 2, 4, 1, 2);
+
+    mainLayout->addWidget(filterBox);
+
+    // One sortable table per breakdown
+    tabs = new QTabWidget();
+    addView(AttendanceReportModel::StudentView, "Students");
+    addView(AttendanceReportModel::StudentSubjectView, "Students by Subject");
+    addView(AttendanceReportModel::SubjectView, "Subjects");
+    addView(AttendanceReportModel::SectionView, "Sections");
+    mainLayout->addWidget(tabs);
+
+    summaryLabel = new QLabel();
+    summaryLabel->setStyleSheet("color: gray;");
+    mainLayout->addWidget(summaryLabel);
+
+    QHBoxLayout *buttons = new QHBoxLayout();
+    buttons->addStretch();
+    QPushButton *closeBtn = new QPushButton("Close");
+    closeBtn->setStyleSheet("background-color: #95a5a6; color: white; padding: 10px;");
+    buttons->addWidget(closeBtn);
+    mainLayout->addLayout(buttons);
+
+    connect(fromCheck, &QCheckBox::toggled, fromEdit, &QWidget::setEnabled);
+    connect(toCheck, &QCheckBox::toggled, toEdit, &QWidget::setEnabled);
+    connect(belowOnlyCheck, &QCheckBox::toggled, this, [this](bool on) {
+        for (AttendanceReportModel *model : models)
+            model->setBelowOnly(on);
+    });
+    connect(calculateBtn, &QPushButton::clicked, this, &AttendanceStatsDialog::calculate);
+    connect(closeBtn, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+// Lowest attendance first until the user picks another column
+void AttendanceStatsDialog::addView(AttendanceReportModel::View view, const QString &title) {
+    AttendanceReportModel *model = new AttendanceReportModel(view, this);
+    models.append(model);
+
+    QTableView *table = new QTableView();
+    table->setModel(model);
+    table->setSortingEnabled(true);
+    table->sortByColumn(model->percentageColumn(), Qt::AscendingOrder);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setAlternatingRowColors(true);
+    table->verticalHeader()->setDefaultSectionSize(24);
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setStretchLastSection(true);
+    tabs->addTab(table, title);
+}
+
+// Same pattern as AttendanceDialog::runQuery; the channel is not under
+// "attendance." so that dialog does not report this one's failures
+void AttendanceStatsDialog::runQuery(const QString &channel, const QueryExecutor::Task &task) {
+    if (executor) {
+        executor->submit(channel, task);
+        return;
+    }
+
+    QString error;
+    QVariant result = task(db, QueryCancelToken(), error);
+    if (error.isEmpty()) {
+        onQueryFinished(0, channel, result);
+    } else {
+        onQueryFailed(0, channel, error);
+    }
+}
+
+void AttendanceStatsDialog::calculate() {
+    AttendanceQuery query;
+    query.subject = subjectCombo->currentText() == "All" ? QString() : subjectCombo->currentText();
+    query.branch = branchCombo->currentText() == "All" ? QString() : branchCombo->currentText();
+    query.year = yearCombo->currentText() == "All" ? 0 : yearCombo->currentText().toInt();
+    if (fromCheck->isChecked())
+        query.from = fromEdit->date();
+    if (toCheck->isChecked())
+        query.to = toEdit->date();
+    query.threshold = thresholdSpin->value();
+
+    calculateBtn->setEnabled(false);
+    summaryLabel->setText("Calculating...");
+    runQuery("analytics.attendance", [query](QSqlDatabase &db, const QueryCancelToken &token, QString &error) {
+        AttendanceAnalytics analytics(db);
+        if (!analytics.run(query, token)) {
+            error = analytics.lastError();
+            return QVariant();
+        }
+        return QVariant::fromValue(analytics.report());
+    });
+}
+
+void AttendanceStatsDialog::showReport(const AttendanceReport &report) {
+    for (AttendanceReportModel *model : models)
+        model->setReport(report);
+
+    AttendanceCount total = report.total();
+    summaryLabel->setText(QString("%1 sessions, %2 students: %3 of %4 attended (%5%). "
+                                  "%6 students below %7%. Calculated in %8 ms.")
+                          .arg(report.sessions)
+                          .arg(report.students.size())
+                          .arg(total.attended)
+                          .arg(total.held)
+                          .arg(total.percentage(), 0, 'f', 1)
+                          .arg(report.studentsBelow())
+                          .arg(report.query.threshold)
+                          .arg(report.totalMs));
+}
+
+void AttendanceStatsDialog::onQueryFinished(quint64, const QString &channel, const QVariant &result) {
+    if (channel != "analytics.attendance") {
+        return;
+    }
+
+    calculateBtn->setEnabled(true);
+    showReport(result.value<AttendanceReport>());
+}
+
+void AttendanceStatsDialog::onQueryFailed(quint64, const QString &channel, const QString &error) {
+    if (channel != "analytics.attendance") {
+        return;
+    }
+
+    calculateBtn->setEnabled(true);
+    summaryLabel->clear();
+    QMessageBox::critical(this, "Error", "Could not calculate attendance: " + error);
+}
@@ -0,0 +1,60 @@
+#ifndef ATTENDANCESTATSDIALOG_H
+#define ATTENDANCESTATSDIALOG_H
+
+#include <QDialog>
+#include <QComboBox>
+#include <QDateEdit>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
+#include <QTabWidget>
+#include <QPushButton>
+#include <QLabel>
+#include <QSqlDatabase>
+
+#include "queryexecutor.h"
+#include "attendanceanalytics.h"
+#include "attendancereportmodel.h"
+
+// Attendance percentages over a date range per student, per student and
+// subject, per subject and per section, each in a sortable table, with the
+// students under the threshold tinted. The numbers come from
+// AttendanceAnalytics on the executor's worker thread (inline without one).
+class AttendanceStatsDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    AttendanceStatsDialog(QSqlDatabase &database, QueryExecutor *queryExecutor,
+                          const QStringList &subjects, const AttendanceQuery &initial,
+                          QWidget *parent = nullptr);
+
+private slots:
+    void calculate();
+    void onQueryFinished(quint64 ticket, const QString &channel, const QVariant &result);
+    void onQueryFailed(quint64 ticket, const QString &channel, const QString &error);
+
+private:
+    QSqlDatabase &db;
+    QueryExecutor *executor;
+
+    QComboBox *subjectCombo;
+    QComboBox *branchCombo;
+    QComboBox *yearCombo;
+    QCheckBox *fromCheck;
+    QDateEdit *fromEdit;
+    QCheckBox *toCheck;
+    QDateEdit *toEdit;
+    QDoubleSpinBox *thresholdSpin;
+    QCheckBox *belowOnlyCheck;
+    QPushButton *calculateBtn;
+    QTabWidget *tabs;
+    QLabel *summaryLabel;
+
+    QVector<AttendanceReportModel *> models;
+
+    void setupUI(const QStringList &subjects, const AttendanceQuery &initial);
+    void addView(AttendanceReportModel::View view, const QString &title);
+    void runQuery(const QString &channel, const QueryExecutor::Task &task);
+    void showReport(const AttendanceReport &report);
+};
+
+#endif // ATTENDANCESTATSDIALOG_H
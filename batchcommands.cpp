@@ -0,0 +1,470 @@
+#include "batchcommands.h"
+#include "connectionprofile.h"
+#include "schemamigrator.h"
+#include "statementcache.h"
+#include "gradingpolicy.h"
+#include "csvimporter.h"
+#include "dataexporter.h"
+#include "cgparecomputejob.h"
+#include "attendanceanalytics.h"
+#include "attendancerepository.h"
+#include "dashboardrepository.h"
+#include "reportbuilder.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFileInfo>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QDate>
+
+// Options followed by a value; everything else starting with -- is a flag
+static const QStringList ValueOptions = {
+    "--db", "--db-profile", "--grading-policy", "--export", "--format", "--output",
+    "--rejected", "--threads", "--subject", "--branch", "--year", "--from", "--to",
+    "--threshold", "--attendance-threshold", "--slow-query-ms", "--exam-type", "--limit", "--by"
+};
+
+BatchCommands::BatchCommands(const QStringList &arguments)
+    : arguments(arguments),
+      out(stdout),
+      err(stderr),
+      connectionName("srms-cli")
+{
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &arg = arguments[i];
+        if (!arg.startsWith("--"))
+            positional << arg;
+        else if (!arg.contains('=') && ValueOptions.contains(arg))
+            i++;
+    }
+}
+
+BatchCommands::~BatchCommands()
+{
+    if (db.isValid()) {
+        StatementCache::release(connectionName);
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(connectionName);
+    }
+}
+
+QString BatchCommands::usage()
+{
+    return "Usage: srms-cli [--db srms.db] [--db-profile name] <command> [arguments]\n"
+           "\n"
+           "Commands:\n"
+           "  import <students|marks|attendance> <file> [--rejected file]\n"
+           "  export <source> [--format csv|jsonl|columnar] [--output file]\n"
+           "         sources: " + DataExporter::sources().join(", ") + "\n"
+           "  recompute-cgpa [--threads n] [--grading-policy name]\n"
+           "  attendance-stats [--subject name] [--branch name] [--year n]\n"
+           "                   [--from yyyy-MM-dd] [--to yyyy-MM-dd]\n"
+           "                   [--threshold percent] [--below]\n"
+           "  report top [--limit n] [--subject name] [--exam-type name]\n"
+           "             [--branch name] [--year n]\n"
+           "  report stats [--by subject|exam_type|branch|year] [same filters]\n"
+           "  rebuild-summaries\n"
+           "  vacuum\n"
+           "  analyze\n"
+           "  integrity-check [--quick]\n"
+           "  migrate\n";
+}
+
+int BatchCommands::run()
+{
+    QString command = positional.value(0);
+
+    if (command == "import")
+        return importData();
+    if (command == "export")
+        return exportData();
+    if (command == "recompute-cgpa")
+        return recomputeCgpa();
+    if (command == "attendance-stats")
+        return attendanceStats();
+    if (command == "report")
+        return report();
+    if (command == "rebuild-summaries")
+        return rebuildSummaries();
+    if (command == "vacuum")
+        return vacuum();
+    if (command == "analyze")
+        return analyze();
+    if (command == "integrity-check")
+        return integrityCheck();
+    if (command == "migrate")
+        return migrate();
+
+    if (command.isEmpty() || command == "help" || hasFlag("--help")) {
+        out << usage();
+        return command.isEmpty() ? 2 : 0;
+    }
+    err << "Unknown command " << command << "\n\n" << usage();
+    return 2;
+}
+
+// =========================================
+// Setup
+// =========================================
+
+// Value of --name=value or --name value, else fallback
+QString BatchCommands::option(const QString &name, const QString &fallback) const
+{
+    for (int i = 1; i < arguments.size(); i++) {
+        if (arguments[i].startsWith(name + "="))
+            return arguments[i].mid(name.size() + 1);
+        if (arguments[i] == name && i + 1 < arguments.size())
+            return arguments[i + 1];
+    }
+    return fallback;
+}
+
+bool BatchCommands::hasFlag(const QString &name) const
+{
+    return arguments.contains(name);
+}
+
+// Same setup as the GUI: profile, migrations, grading policy
+bool BatchCommands::openDatabase()
+{
+    db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(option("--db", "srms.db"));
+    if (!db.open()) {
+        err << "Could not open database: " << db.lastError().text() << "\n";
+        return false;
+    }
+
+    ConnectionProfile profile = ConnectionProfile::load(arguments);
+    QString profileError;
+    if (!profile.apply(db, &profileError))
+        err << "Could not apply database profile " << profile.name << ": " << profileError << "\n";
+
+    SchemaMigrator migrator(db);
+    if (!migrator.migrate()) {
+        err << "Schema migration failed: " << migrator.lastError() << "\n";
+        return false;
+    }
+
+    GradingPolicy::setActive(GradingPolicy::load(arguments));
+    QueryStats::configure(arguments);
+    return true;
+}
+
+// =========================================
+// Import / export
+// =========================================
+
+int BatchCommands::importData()
+{
+    CsvImporter::Kind kind;
+    QString fileName = positional.value(2);
+    if (!CsvImporter::kindFromName(positional.value(1), kind) || fileName.isEmpty()) {
+        err << "Usage: srms-cli import <students|marks|attendance> <file> [--rejected file]\n";
+        return 2;
+    }
+    if (!openDatabase())
+        return 1;
+
+    CsvImporter importer(db, kind);
+    QString rejected = option("--rejected");
+    if (!rejected.isEmpty())
+        importer.setRejectedFile(rejected);
+
+    if (!importer.run(fileName)) {
+        err << "Import failed, nothing was imported: " << importer.lastError() << "\n";
+        return 1;
+    }
+    out << importer.stats().summary() << "\n";
+    return 0;
+}
+
+int BatchCommands::exportData()
+{
+    QString source = positional.size() > 1 ? positional[1] : option("--export");
+    QString output = option("--output");
+    if (source.isEmpty()) {
+        err << "Usage: srms-cli export <source> [--format csv|jsonl|columnar] [--output file]\n";
+        return 2;
+    }
+
+    // The format defaults to the output's suffix, then to CSV
+    DataExporter::Format format = DataExporter::Csv;
+    QString formatName = option("--format");
+    if (formatName.isEmpty())
+        DataExporter::formatFromName(QFileInfo(output).suffix(), format);
+    else if (!DataExporter::formatFromName(formatName, format)) {
+        err << "Unknown export format " << formatName << " (csv, jsonl or columnar)\n";
+        return 2;
+    }
+    if (output.isEmpty())
+        output = source + "." + DataExporter::suffix(format);
+
+    if (!openDatabase())
+        return 1;
+
+    DataExporter exporter(db);
+    if (!exporter.run(source, format, output)) {
+        err << "Export failed: " << exporter.lastError() << "\n";
+        return 1;
+    }
+    out << exporter.stats().summary() << "\n";
+    return 0;
+}
+
+// =========================================
+// CGPA / attendance
+// =========================================
+
+int BatchCommands::recomputeCgpa()
+{
+    if (!openDatabase())
+        return 1;
+
+    CgpaRecomputeJob job(db);
+    QString threads = option("--threads");
+    if (!threads.isEmpty())
+        job.setThreadCount(threads.toInt());
+
+    if (!job.run()) {
+        err << "CGPA recompute failed: " << job.lastError() << "\n";
+        return 1;
+    }
+    out << job.stats().summary() << "\n";
+    return 0;
+}
+
+// Tab-separated, from AttendanceAnalytics: one line per subject and one per
+// section, or one per student with --subject or --below (only the students
+// under the threshold)
+int BatchCommands::attendanceStats()
+{
+    if (!openDatabase())
+        return 1;
+
+    AttendanceQuery query;
+    query.subject = option("--subject");
+    query.branch = option("--branch");
+    query.year = option("--year", "0").toInt();
+    query.from = QDate::fromString(option("--from"), Qt::ISODate);
+    query.to = QDate::fromString(option("--to"), Qt::ISODate);
+    query.threshold = option("--threshold",
+                             QString::number(AttendanceAnalytics::configuredThreshold(arguments)))
+                          .toDouble();
+
+    AttendanceAnalytics analytics(db);
+    if (!analytics.run(query)) {
+        err << "Attendance stats failed: " << analytics.lastError() << "\n";
+        return 1;
+    }
+    const AttendanceReport report = analytics.report();
+
+    auto percent = [](const AttendanceCount &count) {
+        return QString::number(count.percentage(), 'f', 1);
+    };
+
+    if (!query.subject.isEmpty() || hasFlag("--below")) {
+        bool belowOnly = hasFlag("--below");
+        out << "roll_no\tname\tbranch\tyear\tpresent\theld\tpresent_pct\tbelow_threshold\n";
+        for (const StudentAttendance &s : report.students) {
+            if (belowOnly && !s.below)
+                continue;
+            out << s.rollNo << '\t' << s.name << '\t' << s.branch << '\t' << s.year << '\t'
+                << s.count.attended << '\t' << s.count.held << '\t' << percent(s.count) << '\t'
+                << (s.below ? "yes" : "no") << '\n';
+        }
+        out << "\n" << report.summary() << "\n";
+        return 0;
+    }
+
+    out << "subject\tsessions\tpresent\theld\tpresent_pct\tstudents_below\n";
+    for (const SubjectAttendance &t : report.subjectTotals) {
+        out << t.subject << '\t' << t.sessions << '\t' << t.count.attended << '\t'
+            << t.count.held << '\t' << percent(t.count) << '\t' << t.studentsBelow << '\n';
+    }
+
+    out << "\nbranch\tyear\tstudents\tpresent\theld\tpresent_pct\tstudents_below\n";
+    for (const SectionAttendance &t : report.sections) {
+        out << t.branch << '\t' << t.year << '\t' << t.students << '\t' << t.count.attended << '\t'
+            << t.count.held << '\t' << percent(t.count) << '\t' << t.studentsBelow << '\n';
+    }
+
+    out << "\n" << report.summary() << "\n";
+    return 0;
+}
+
+// Tab-separated, from ReportBuilder over the marks snapshot
+int BatchCommands::report()
+{
+    QString kind = positional.value(1);
+    ReportBuilder::GroupBy by = ReportBuilder::BySubject;
+    if ((kind != "top" && kind != "stats")
+        || (kind == "stats" && !ReportBuilder::parseGroupBy(option("--by", "subject"), by))) {
+        err << "Usage: srms-cli report top [--limit n] [filters]\n"
+               "       srms-cli report stats [--by subject|exam_type|branch|year] [filters]\n"
+               "Filters: --subject name --exam-type name --branch name --year n\n";
+        return 2;
+    }
+
+    if (!openDatabase())
+        return 1;
+
+    ReportBuilder builder(db);
+    builder.subject(option("--subject"))
+        .examType(option("--exam-type"))
+        .branch(option("--branch"))
+        .year(option("--year", "0").toInt());
+
+    MarksReport result;
+    bool ok = kind == "top" ? builder.top(option("--limit", "50").toInt(), result)
+                            : builder.stats(by, result);
+    if (!ok) {
+        err << "Report failed: " << builder.lastError() << "\n";
+        return 1;
+    }
+
+    out << result.columns.join('\t') << '\n';
+    for (const QVariantList &row : result.rows) {
+        QStringList cells;
+        for (const QVariant &value : row) {
+            cells << (value.type() == QVariant::Double ? QString::number(value.toDouble(), 'f', 2)
+                                                       : value.toString());
+        }
+        out << cells.join('\t') << '\n';
+    }
+    out << "\n" << result.summary() << "\n";
+    return 0;
+}
+
+// =========================================
+// Maintenance
+// =========================================
+
+// Recounts every student's attendance and the class dashboards from
+// scratch; the write paths keep them current, this is for repairs
+int BatchCommands::rebuildSummaries()
+{
+    if (!openDatabase())
+        return 1;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!db.transaction()) {
+        err << "Could not start a transaction: " << db.lastError().text() << "\n";
+        return 1;
+    }
+    AttendanceRepository attendance(db);
+    DashboardRepository dashboard(db);
+    if (!attendance.rebuildTotals()) {
+        err << "Rebuilding attendance totals failed: " << attendance.lastError() << "\n";
+        db.rollback();
+        return 1;
+    }
+    if (!dashboard.rebuild()) {
+        err << "Rebuilding class summaries failed: " << dashboard.lastError() << "\n";
+        db.rollback();
+        return 1;
+    }
+    if (!db.commit()) {
+        err << "Commit failed: " << db.lastError().text() << "\n";
+        db.rollback();
+        return 1;
+    }
+
+    out << QString("Rebuilt summaries in %1 ms\n").arg(timer.elapsed());
+    return 0;
+}
+
+int BatchCommands::vacuum()
+{
+    if (!openDatabase())
+        return 1;
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 before = QFileInfo(db.databaseName()).size();
+
+    QSqlQuery q(db);
+    if (!q.exec("VACUUM")) {
+        err << "VACUUM failed: " << q.lastError().text() << "\n";
+        return 1;
+    }
+    // Fold the WAL back so the file size below is the real one
+    q.exec("PRAGMA wal_checkpoint(TRUNCATE)");
+
+    out << QString("VACUUM: %1 -> %2 bytes in %3 ms\n")
+               .arg(before)
+               .arg(QFileInfo(db.databaseName()).size())
+               .arg(timer.elapsed());
+    return 0;
+}
+
+int BatchCommands::analyze()
+{
+    if (!openDatabase())
+        return 1;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery q(db);
+    if (!q.exec("ANALYZE") || !q.exec("PRAGMA optimize")) {
+        err << "ANALYZE failed: " << q.lastError().text() << "\n";
+        return 1;
+    }
+
+    // Statistics can change plans; make sure the hot queries still use
+    // their indexes
+    QStringList regressions;
+    SchemaMigrator migrator(db);
+    bool plansOk = migrator.verifyQueryPlans(regressions);
+
+    out << QString("ANALYZE in %1 ms\n").arg(timer.elapsed());
+    if (!plansOk) {
+        err << "Query plan regression:\n  " << regressions.join("\n  ") << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int BatchCommands::integrityCheck()
+{
+    if (!openDatabase())
+        return 1;
+
+    QSqlQuery q(db);
+    if (!q.exec(hasFlag("--quick") ? "PRAGMA quick_check" : "PRAGMA integrity_check")) {
+        err << "Integrity check failed: " << q.lastError().text() << "\n";
+        return 1;
+    }
+
+    QStringList problems;
+    while (q.next()) {
+        QString line = q.value(0).toString();
+        if (line != "ok")
+            problems << line;
+    }
+    if (!problems.isEmpty()) {
+        err << "Integrity check found " << problems.size() << " problem(s):\n  "
+            << problems.join("\n  ") << "\n";
+        return 1;
+    }
+    out << "ok\n";
+    return 0;
+}
+
+// openDatabase already migrates; this reports where the schema stands
+int BatchCommands::migrate()
+{
+    if (!openDatabase())
+        return 1;
+
+    SchemaMigrator migrator(db);
+    out << QString("Schema version %1 of %2\n")
+               .arg(migrator.currentVersion())
+               .arg(migrator.latestVersion());
+    return 0;
+}
@@ -0,0 +1,58 @@
+#ifndef BATCHCOMMANDS_H
+#define BATCHCOMMANDS_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+
+// The subcommands of srms-cli, for nightly jobs on machines without a
+// display. Results go to stdout, errors to stderr; the exit code is 0 on
+// success, 1 when the operation failed and 2 for a usage error.
+//
+//   srms-cli [--db srms.db] [--db-profile name] <command> [arguments]
+//     import <students|marks|attendance> <file> [--rejected file]
+//     export <source> [--format csv|jsonl|columnar] [--output file]
+//     recompute-cgpa [--threads n] [--grading-policy name]
+//     attendance-stats [--subject name] [--branch name] [--year n]
+//                      [--from yyyy-MM-dd] [--to yyyy-MM-dd]
+//                      [--threshold percent] [--below]
+//     vacuum
+//     analyze
+//     integrity-check [--quick]
+//     migrate
+class BatchCommands
+{
+public:
+    explicit BatchCommands(const QStringList &arguments);
+    ~BatchCommands();
+
+    int run();                  // dispatches on the first positional argument
+    int exportData();           // also behind srms --export <source>
+
+    static QString usage();
+
+private:
+    QStringList arguments;
+    QStringList positional;     // arguments that are neither options nor their values
+    QTextStream out;
+    QTextStream err;
+    QSqlDatabase db;
+    QString connectionName;
+
+    QString option(const QString &name, const QString &fallback = QString()) const;
+    bool hasFlag(const QString &name) const;
+    bool openDatabase();
+
+    int importData();
+    int recomputeCgpa();
+    int attendanceStats();
+    int report();
+    int rebuildSummaries();
+    int vacuum();
+    int analyze();
+    int integrityCheck();
+    int migrate();
+};
+
+#endif // BATCHCOMMANDS_H
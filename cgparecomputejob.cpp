@@ -0,0 +1,365 @@
+#include "cgparecomputejob.h"
+#include "gradingkernels.h"
+#include "querystats.h"
+#include "dashboardrepository.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QVariantList>
+#include <QVector>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+
+#include <memory>
+#include <vector>
+
+// =========================================
+// Stats
+// =========================================
+
+double CgpaRecomputeStats::rowsPerSecond() const
+{
+    return totalMs > 0 ? markRows * 1000.0 / totalMs : 0.0;
+}
+
+double CgpaRecomputeStats::studentsPerSecond() const
+{
+    return totalMs > 0 ? students * 1000.0 / totalMs : 0.0;
+}
+
+QString CgpaRecomputeStats::summary() const
+{
+    return QString("%1 marks rows, %2 students in %3 ms "
+                   "(read %4 ms, write %5 ms, %6 chunks on %7 threads, %8 policy): "
+                   "%9 rows/s, %10 students/s")
+        .arg(markRows)
+        .arg(students)
+        .arg(totalMs)
+        .arg(readMs)
+        .arg(writeMs)
+        .arg(chunks)
+        .arg(threads)
+        .arg(policy)
+        .arg(rowsPerSecond(), 0, 'f', 0)
+        .arg(studentsPerSecond(), 0, 'f', 0);
+}
+
+// =========================================
+// Chunks
+// =========================================
+
+namespace {
+
+// The marks of one student in one (subject, exam_type), dictionary-encoded
+struct Group
+{
+    int    subject;
+    int    exam;
+    double sumPct;
+    int    n;
+};
+
+// Consecutive students and their groups; student i owns
+// groups [starts[i], starts[i + 1]), the last one up to groups.size()
+struct Chunk
+{
+    std::shared_ptr<const GradingTables> tables;
+    QVector<QString> rollNos;
+    QVector<int>     starts;
+    QVector<Group>   groups;
+
+    // Filled by the pool
+    QVariantList aggRoll, aggSubject, aggExam, aggSum, aggCount;
+    QVariantList totalRoll, totalSum, totalCount, cgpa;
+};
+
+class ChunkTask : public QRunnable
+{
+public:
+    explicit ChunkTask(Chunk *chunk) : chunk(chunk) {}
+
+    // The policy is resolved once per chunk; the loop below is compiled
+    // separately for each kernel
+    void run() override
+    {
+        const GradingTables &tables = *chunk->tables;
+        Grading::withKernel(tables, [&](auto &kernel) {
+            for (int s = 0; s < chunk->rollNos.size(); s++) {
+                int end = s + 1 < chunk->starts.size() ? chunk->starts[s + 1] : chunk->groups.size();
+                const QString &rollNo = chunk->rollNos[s];
+
+                double sum = 0.0;
+                int count = 0;
+                for (int i = chunk->starts[s]; i < end; i++) {
+                    const Group &g = chunk->groups[i];
+                    kernel.add(g.subject, g.exam, g.sumPct, g.n);
+                    sum += g.sumPct;
+                    count += g.n;
+
+                    chunk->aggRoll << rollNo;
+                    chunk->aggSubject << tables.subjectName(g.subject);
+                    chunk->aggExam << tables.examName(g.exam);
+                    chunk->aggSum << g.sumPct;
+                    chunk->aggCount << g.n;
+                }
+
+                chunk->totalRoll << rollNo;
+                chunk->totalSum << sum;
+                chunk->totalCount << count;
+                chunk->cgpa << kernel.finish();
+            }
+        });
+
+        // Only the results are needed from here on
+        chunk->groups = QVector<Group>();
+    }
+
+private:
+    Chunk *chunk;
+};
+
+} // namespace
+
+// =========================================
+// Job
+// =========================================
+
+CgpaRecomputeJob::CgpaRecomputeJob(const QSqlDatabase &database)
+    : db(database),
+      threadCount(QThread::idealThreadCount()),
+      chunkRows(8192)
+{
+}
+
+void CgpaRecomputeJob::setThreadCount(int count)
+{
+    threadCount = qMax(1, count);
+}
+
+void CgpaRecomputeJob::setChunkRows(int rows)
+{
+    chunkRows = qMax(1, rows);
+}
+
+bool CgpaRecomputeJob::run(const QueryCancelToken &token)
+{
+    GradingPolicy policy = GradingPolicy::active();
+
+    result = CgpaRecomputeStats();
+    result.threads = threadCount;
+    result.policy = policy.name();
+    error.clear();
+
+    QElapsedTimer total;
+    total.start();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    std::vector<std::unique_ptr<Chunk>> chunks;
+
+    // Read and write-back share one transaction. It starts as a reader, so
+    // marks can still be added meanwhile; if one is, SQLite refuses the
+    // upgrade to writer at the end and nothing stale is written.
+    if (!db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+
+    // ---- Read: one ordered pass over marks ----
+    // idx_marks_roll_subject gives the roll_no order, so equal groups arrive
+    // as runs and only each student's rows are sorted. NULL subjects and
+    // exam types key as '' like the migration-3 backfill (marks_agg's
+    // columns are NOT NULL); ordering on the coalesced columns keeps them
+    // in one run with the '' rows.
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    QueryTrace read(q);
+    if (!read.exec("SELECT roll_no, COALESCE(subject, ''), COALESCE(exam_type, ''), marks, max_marks "
+                "FROM marks WHERE roll_no IS NOT NULL AND max_marks > 0 "
+                "ORDER BY 1, 2, 3")) {
+        error = q.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    // Chunks share the tables read-only. A new subject or exam type is
+    // added to a private copy when a dispatched chunk still holds the
+    // current one, which happens only a handful of times per run.
+    std::shared_ptr<GradingTables> tables = std::make_shared<GradingTables>(policy);
+    auto encode = [&](const QString &subject, const QString &examType, int &subjectId, int &examId) {
+        if ((!tables->hasSubject(subject) || !tables->hasExam(examType)) && tables.use_count() > 1)
+            tables = std::make_shared<GradingTables>(*tables);
+        subjectId = tables->subjectId(subject);
+        examId = tables->examId(examType);
+    };
+
+    std::unique_ptr<Chunk> chunk(new Chunk);
+    auto dispatch = [&]() {
+        chunk->tables = tables;
+        chunks.push_back(std::move(chunk));
+        pool.start(new ChunkTask(chunks.back().get()));
+        chunk.reset(new Chunk);
+    };
+
+    // Run detection compares each row with the previous one; only a new
+    // run is looked up in the dictionaries
+    QString lastRoll, lastSubject, lastExam;
+    while (read.next()) {
+        QString rollNo = q.value(0).toString();
+        QString subject = q.value(1).toString();
+        QString examType = q.value(2).toString();
+        double pct = q.value(3).toInt() * 100.0 / q.value(4).toInt();
+        result.markRows++;
+
+        bool newStudent = chunk->rollNos.isEmpty() || rollNo != lastRoll;
+        if (newStudent) {
+            // Cut only on a student boundary
+            if (chunk->groups.size() >= chunkRows) {
+                dispatch();
+                if (token.isCancelled())
+                    break;
+            }
+            chunk->rollNos.append(rollNo);
+            chunk->starts.append(chunk->groups.size());
+            lastRoll = rollNo;
+        }
+
+        if (newStudent || subject != lastSubject || examType != lastExam) {
+            Group g = {0, 0, 0.0, 0};
+            encode(subject, examType, g.subject, g.exam);
+            chunk->groups.append(g);
+            lastSubject = subject;
+            lastExam = examType;
+        }
+        Group &g = chunk->groups.last();
+        g.sumPct += pct;
+        g.n++;
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError().text();
+        pool.waitForDone();
+        db.rollback();
+        return false;
+    }
+    read.finish();
+    if (!chunk->rollNos.isEmpty())
+        dispatch();
+
+    pool.waitForDone();
+    result.readMs = total.elapsed();
+    result.chunks = int(chunks.size());
+
+    if (token.isCancelled()) {
+        error = "Cancelled";
+        db.rollback();
+        return false;
+    }
+
+    // ---- Write back ----
+    QElapsedTimer write;
+    write.start();
+
+    QVariantList aggRoll, aggSubject, aggExam, aggSum, aggCount;
+    QVariantList totalRoll, totalSum, totalCount, cgpa;
+    for (const std::unique_ptr<Chunk> &c : chunks) {
+        aggRoll += c->aggRoll;
+        aggSubject += c->aggSubject;
+        aggExam += c->aggExam;
+        aggSum += c->aggSum;
+        aggCount += c->aggCount;
+        totalRoll += c->totalRoll;
+        totalSum += c->totalSum;
+        totalCount += c->totalCount;
+        cgpa += c->cgpa;
+        result.students += c->rollNos.size();
+    }
+    chunks.clear();
+
+    QSqlQuery w(db);
+    auto fail = [&](const QSqlQuery &failed) {
+        error = failed.lastError().text();
+        db.rollback();
+        return false;
+    };
+
+    if (!QueryTrace(w).exec("DELETE FROM marks_agg"))
+        return fail(w);
+    if (!QueryTrace(w).exec("DELETE FROM cgpa_totals"))
+        return fail(w);
+
+    QSqlQuery agg(db);
+    agg.prepare("INSERT INTO marks_agg (roll_no, subject, exam_type, sum_pct, n) "
+                "VALUES (?, ?, ?, ?, ?)");
+    agg.addBindValue(aggRoll);
+    agg.addBindValue(aggSubject);
+    agg.addBindValue(aggExam);
+    agg.addBindValue(aggSum);
+    agg.addBindValue(aggCount);
+    if (!QueryTrace(agg).execBatch())
+        return fail(agg);
+
+    QSqlQuery totals(db);
+    totals.prepare("INSERT INTO cgpa_totals (roll_no, sum_pct, n) VALUES (?, ?, ?)");
+    totals.addBindValue(totalRoll);
+    totals.addBindValue(totalSum);
+    totals.addBindValue(totalCount);
+    if (!QueryTrace(totals).execBatch())
+        return fail(totals);
+
+    // CGPAs are staged in a temp table and applied with one UPDATE;
+    // students without marks drop to 0
+    if (!QueryTrace(w).exec("CREATE TEMP TABLE IF NOT EXISTS cgpa_recompute ("
+                            " roll_no TEXT PRIMARY KEY, cgpa REAL NOT NULL) WITHOUT ROWID"))
+        return fail(w);
+    if (!QueryTrace(w).exec("DELETE FROM temp.cgpa_recompute"))
+        return fail(w);
+
+    QSqlQuery staged(db);
+    staged.prepare("INSERT INTO temp.cgpa_recompute (roll_no, cgpa) VALUES (?, ?)");
+    staged.addBindValue(totalRoll);
+    staged.addBindValue(cgpa);
+    if (!QueryTrace(staged).execBatch())
+        return fail(staged);
+
+    if (!QueryTrace(w).exec("UPDATE students SET cgpa = COALESCE("
+                            " (SELECT r.cgpa FROM temp.cgpa_recompute r"
+                            "  WHERE r.roll_no = students.roll_no), 0.0)"))
+        return fail(w);
+    if (!QueryTrace(w).exec("DELETE FROM temp.cgpa_recompute"))
+        return fail(w);
+
+    // The aggregates were replaced wholesale, so the class results are too
+    DashboardRepository dashboard(db);
+    if (!dashboard.rebuildResults()) {
+        error = dashboard.lastError();
+        db.rollback();
+        return false;
+    }
+
+    if (!db.commit()) {
+        error = db.lastError().text();
+        db.rollback();
+        return false;
+    }
+    CohortRanking::invalidateAll(db);
+    StudentProfileRepository::invalidateAll(db);
+
+    result.writeMs = write.elapsed();
+    result.totalMs = total.elapsed();
+    return true;
+}
+
+CgpaRecomputeStats CgpaRecomputeJob::stats() const
+{
+    return result;
+}
+
+QString CgpaRecomputeJob::lastError() const
+{
+    return error;
+}
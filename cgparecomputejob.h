@@ -0,0 +1,58 @@
+#ifndef CGPARECOMPUTEJOB_H
+#define CGPARECOMPUTEJOB_H
+
+#include "querycanceltoken.h"
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QMetaType>
+
+struct CgpaRecomputeStats
+{
+    qint64 markRows = 0;
+    int    students = 0;
+    int    chunks = 0;
+    int    threads = 0;
+    QString policy;
+    qint64 readMs = 0;      // streaming marks, aggregation overlaps with it
+    qint64 writeMs = 0;     // write-back, after all chunks are summed
+    qint64 totalMs = 0;
+
+    double rowsPerSecond() const;
+    double studentsPerSecond() const;
+    QString summary() const;
+};
+
+Q_DECLARE_METATYPE(CgpaRecomputeStats)
+
+// Rebuilds marks_agg, cgpa_totals and students.cgpa for every student from
+// the marks table. Marks are streamed once in roll_no order (a walk of
+// idx_marks_roll_subject; SQLite sorts only each student's rows by the
+// coalesced subject and exam type) and cut into chunks that never split a
+// student; a thread pool sums the chunks while the next ones are read.
+// The results are written back in the same transaction as the read,
+// ending in a single set-based UPDATE of students. CGPAs follow the active
+// GradingPolicy through the kernels in gradingkernels.h.
+class CgpaRecomputeJob
+{
+public:
+    explicit CgpaRecomputeJob(const QSqlDatabase &database);
+
+    void setThreadCount(int count);     // default: QThread::idealThreadCount()
+    void setChunkRows(int rows);        // default: 8192
+
+    // All or nothing: a failure or cancellation rolls everything back
+    bool run(const QueryCancelToken &token = QueryCancelToken());
+
+    CgpaRecomputeStats stats() const;
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+    CgpaRecomputeStats result;
+    int threadCount;
+    int chunkRows;
+};
+
+#endif // CGPARECOMPUTEJOB_H
@@ -0,0 +1,289 @@
+#include "cohortranking.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QStringList>
+#include <QMutex>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <functional>
+
+namespace {
+// Keyed by database file, then (subject, exam_type), like MarksSnapshot's
+// registry. Cohorts are immutable once loaded; invalidating one only drops
+// the registry's reference.
+//
+// The registry mutex only guards the lookup. A load holds its entry's own
+// mutex, so callers of other cohorts are not held up behind it, and
+// callers of the same cohort wait for it instead of loading it again. A
+// load still running when its cohort is invalidated fills an entry that
+// is no longer in the registry, so its result is never cached.
+struct CohortEntry
+{
+    QMutex mutex;
+    std::shared_ptr<const CohortRanking::Cohort> cohort;
+};
+
+typedef QHash<CohortRanking::Key, std::shared_ptr<CohortEntry>> CohortCache;
+
+QMutex registryMutex;
+QHash<QString, CohortCache> registry;
+}
+
+// =========================================
+// PercentageSketch
+// =========================================
+
+int PercentageSketch::above(float percentage) const
+{
+    int count = 0;
+    for (int bin = binOf(percentage) + 1; bin < Bins; bin++)
+        count += counts[bin];
+    return count;
+}
+
+int PercentageSketch::below(float percentage) const
+{
+    int count = 0;
+    for (int bin = binOf(percentage) - 1; bin >= 0; bin--)
+        count += counts[bin];
+    return count;
+}
+
+QVector<int> PercentageSketch::histogram(int buckets) const
+{
+    QVector<int> result(qMax(1, buckets), 0);
+    for (int bin = 0; bin < Bins; bin++) {
+        int bucket = qMin(result.size() - 1, bin * result.size() / (Bins - 1));
+        result[bucket] += counts[bin];
+    }
+    return result;
+}
+
+QString CohortStanding::rankText() const
+{
+    if (cohort == 0)
+        return "-";
+    return QString("%1%2 / %3").arg(exactRank ? "" : "~").arg(rank).arg(cohort);
+}
+
+// =========================================
+// CohortRanking
+// =========================================
+
+CohortRanking::CohortRanking(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QString CohortRanking::lastError() const
+{
+    return error;
+}
+
+void CohortRanking::invalidate(const QSqlDatabase &db, const QString &subject,
+                               const QString &examType)
+{
+    QMutexLocker lock(&registryMutex);
+    auto it = registry.find(db.databaseName());
+    if (it != registry.end())
+        it->remove(qMakePair(subject, examType));
+}
+
+void CohortRanking::invalidateAll(const QSqlDatabase &db)
+{
+    QMutexLocker lock(&registryMutex);
+    registry.remove(db.databaseName());
+}
+
+std::shared_ptr<const CohortRanking::Cohort> CohortRanking::cohort(const QString &subject,
+                                                                   const QString &examType)
+{
+    std::shared_ptr<CohortEntry> entry;
+    {
+        QMutexLocker lock(&registryMutex);
+        std::shared_ptr<CohortEntry> &slot = registry[db.databaseName()][qMakePair(subject, examType)];
+        if (!slot)
+            slot = std::make_shared<CohortEntry>();
+        entry = slot;
+    }
+
+    QMutexLocker lock(&entry->mutex);
+    if (!entry->cohort)
+        entry->cohort = load(subject, examType);
+    return entry->cohort;
+}
+
+// One pass over the cohort's index range. Every average goes into the
+// sketch; the averages themselves are kept until there are more than
+// ExactLimit, after which only the TopExact best survive, in a min-heap.
+std::shared_ptr<const CohortRanking::Cohort> CohortRanking::load(const QString &subject,
+                                                                 const QString &examType)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT a.sum_pct / a.n FROM marks_agg a JOIN students s ON s.roll_no = a.roll_no "
+        "WHERE a.subject = ? AND a.exam_type = ? AND a.n > 0");
+    q.addBindValue(subject);
+    q.addBindValue(examType);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return nullptr;
+    }
+
+    std::shared_ptr<Cohort> c = std::make_shared<Cohort>();
+    QVector<float> values;
+    bool exact = true;
+    while (trace.next()) {
+        const float value = float(q.value(0).toDouble());
+        c->sketch.add(value);
+        if (exact) {
+            values.append(value);
+            if (values.size() > ExactLimit) {
+                exact = false;
+                std::partial_sort(values.begin(), values.begin() + TopExact, values.end(),
+                                  std::greater<float>());
+                values.resize(TopExact);
+                std::make_heap(values.begin(), values.end(), std::greater<float>());
+            }
+        } else if (value > values.front()) {
+            std::pop_heap(values.begin(), values.end(), std::greater<float>());
+            values.last() = value;
+            std::push_heap(values.begin(), values.end(), std::greater<float>());
+        }
+    }
+    trace.finish();
+
+    if (exact) {
+        std::sort(values.begin(), values.end());
+        c->sorted = values;
+    } else {
+        std::sort_heap(values.begin(), values.end(), std::greater<float>());
+        c->top = values;
+    }
+    return c;
+}
+
+bool CohortRanking::standing(const QString &rollNo, const QString &subject,
+                             const QString &examType, CohortStanding &out)
+{
+    out = CohortStanding();
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT sum_pct / n FROM marks_agg "
+        "WHERE roll_no = ? AND subject = ? AND exam_type = ? AND n > 0");
+    q.addBindValue(rollNo);
+    q.addBindValue(subject);
+    q.addBindValue(examType);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    if (!trace.next()) {
+        trace.finish();
+        return true;
+    }
+    const float score = float(q.value(0).toDouble());
+    trace.finish();
+
+    std::shared_ptr<const Cohort> c = cohort(subject, examType);
+    if (!c)
+        return false;
+    place(*c, score, out);
+    return true;
+}
+
+bool CohortRanking::forStudent(const QString &rollNo, QHash<Key, CohortStanding> &out)
+{
+    out.clear();
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT subject, exam_type, sum_pct / n FROM marks_agg WHERE roll_no = ? AND n > 0");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    QHash<Key, float> averages;
+    while (trace.next())
+        averages.insert(qMakePair(q.value(0).toString(), q.value(1).toString()),
+                        float(q.value(2).toDouble()));
+    trace.finish();
+
+    return rank(averages, out);
+}
+
+bool CohortRanking::rank(const QHash<Key, float> &averages, QHash<Key, CohortStanding> &out)
+{
+    out.clear();
+    for (auto it = averages.cbegin(); it != averages.cend(); ++it) {
+        std::shared_ptr<const Cohort> c = cohort(it.key().first, it.key().second);
+        if (!c)
+            return false;
+        place(*c, it.value(), out[it.key()]);
+    }
+    return true;
+}
+
+// Exact from the sorted averages or the top; otherwise from the sketch,
+// counting half of the score's bin as above it
+void CohortRanking::place(const Cohort &c, float score, CohortStanding &out)
+{
+    out = CohortStanding();
+    if (c.sketch.size() == 0)
+        return;     // the student was deleted since
+
+    out.cohort = c.sketch.size();
+    if (!c.sorted.isEmpty()) {
+        const auto lower = std::lower_bound(c.sorted.cbegin(), c.sorted.cend(), score);
+        const auto upper = std::upper_bound(lower, c.sorted.cend(), score);
+        const int below = int(lower - c.sorted.cbegin());
+        const int same = int(upper - lower);
+        out.rank = out.cohort - below - same + 1;
+        out.percentile = (below + 0.5 * same) * 100.0 / out.cohort;
+        return;
+    }
+
+    // Averages strictly above one in the top are all in the top
+    if (!c.top.isEmpty() && score >= c.top.last()) {
+        const auto above = std::lower_bound(c.top.cbegin(), c.top.cend(), score,
+                                            std::greater<float>());
+        out.rank = int(above - c.top.cbegin()) + 1;
+    } else {
+        out.rank = c.sketch.above(score) + c.sketch.same(score) / 2 + 1;
+        out.exactRank = false;
+    }
+    out.percentile = (c.sketch.below(score) + 0.5 * c.sketch.same(score)) * 100.0 / out.cohort;
+}
+
+bool CohortRanking::histogram(const QString &subject, const QString &examType, int buckets,
+                              QVector<int> &out)
+{
+    std::shared_ptr<const Cohort> c = cohort(subject, examType);
+    if (!c)
+        return false;
+    out = c->sketch.histogram(buckets);
+    return true;
+}
+
+QString CohortRanking::distribution(const QString &subject, const QString &examType)
+{
+    QVector<int> bands;
+    if (!histogram(subject, examType, 10, bands))
+        return QString();
+
+    QStringList lines;
+    for (int i = 0; i < bands.size(); i++)
+        lines << QString("%1-%2%: %3").arg(i * 10).arg(i * 10 + 10).arg(bands[i]);
+    return QString("%1 (%2), students by average:\n%3")
+        .arg(subject, examType, lines.join("\n"));
+}
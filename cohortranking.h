@@ -0,0 +1,118 @@
+#ifndef COHORTRANKING_H
+#define COHORTRANKING_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+
+#include <memory>
+
+// Counts of percentages in fixed 0.1% bins over 0-100%, filled in one
+// streaming pass. Percentages are bounded, so this is a quantile sketch
+// with a fixed error: any rank or percentile it gives is off by at most
+// the other values in the same bin.
+class PercentageSketch
+{
+public:
+    static const int BinsPerPercent = 10;   // 0.1% wide bins
+    static const int Bins = 100 * BinsPerPercent + 1;
+
+    PercentageSketch() : counts(Bins, 0) {}
+
+    void add(float percentage) { counts[binOf(percentage)]++; total++; }
+
+    int size() const { return total; }
+    // Values in bins above / below percentage's bin, and in it
+    int above(float percentage) const;
+    int below(float percentage) const;
+    int same(float percentage) const { return counts[binOf(percentage)]; }
+
+    // Counts in that many equal-width buckets over 0-100%; 100% falls in
+    // the last one
+    QVector<int> histogram(int buckets) const;
+
+private:
+    QVector<int> counts;
+    int total = 0;
+
+    static int binOf(float percentage)
+    {
+        int bin = int(percentage * BinsPerPercent);
+        return bin < 0 ? 0 : (bin >= Bins ? Bins - 1 : bin);
+    }
+};
+
+// Where one student stands among everyone with marks in the same subject
+// and exam type, by their average percentage there (marks_agg)
+struct CohortStanding
+{
+    int    rank = 0;            // 1 for the best; equal averages share a rank
+    bool   exactRank = true;    // false: from the sketch, see CohortRanking
+    int    cohort = 0;          // students in the cohort; 0 when none
+    double percentile = 0.0;    // share of the cohort below, ties counting half
+
+    QString rankText() const;
+};
+
+// Ranks and percentiles per (subject, exam_type) cohort, cached per
+// database and rebuilt on first use after invalidate().
+//
+// A cohort of up to ExactLimit students keeps its averages sorted, so each
+// lookup is a binary search and exact. Larger cohorts keep only a
+// PercentageSketch and their TopExact best averages (a partial sort), so
+// the leaderboard stays exact while the rest read rank and percentile from
+// the sketch in constant memory.
+//
+// MarksRepository invalidates a cohort when a mark of its key is added or
+// deleted; bulk writes and student deletions invalidate every cohort of
+// the database.
+class CohortRanking
+{
+public:
+    static const int ExactLimit = 20000;
+    static const int TopExact = 100;
+
+    typedef QPair<QString, QString> Key;    // (subject, exam_type)
+
+    explicit CohortRanking(const QSqlDatabase &database);
+
+    // false only on a query error; a student without a mark of the key
+    // gets an empty standing
+    bool standing(const QString &rollNo, const QString &subject, const QString &examType,
+                  CohortStanding &out);
+    // The student's standing in every cohort they have marks in, with one
+    // lookup for their averages
+    bool forStudent(const QString &rollNo, QHash<Key, CohortStanding> &out);
+    // Standings of averages already read (StudentProfile::averages)
+    bool rank(const QHash<Key, float> &averages, QHash<Key, CohortStanding> &out);
+
+    // Students per equal-width band of average percentage
+    bool histogram(const QString &subject, const QString &examType, int buckets,
+                   QVector<int> &out);
+    // The histogram in ten bands as text, for a tooltip; empty on error
+    QString distribution(const QString &subject, const QString &examType);
+
+    static void invalidate(const QSqlDatabase &db, const QString &subject, const QString &examType);
+    static void invalidateAll(const QSqlDatabase &db);
+
+    QString lastError() const;
+
+    struct Cohort
+    {
+        QVector<float> sorted;      // ascending; empty above ExactLimit
+        QVector<float> top;         // descending, the TopExact best
+        PercentageSketch sketch;
+    };
+
+private:
+    QSqlDatabase db;
+    QString error;
+
+    std::shared_ptr<const Cohort> cohort(const QString &subject, const QString &examType);
+    std::shared_ptr<const Cohort> load(const QString &subject, const QString &examType);
+    static void place(const Cohort &c, float score, CohortStanding &out);
+};
+
+#endif // COHORTRANKING_H
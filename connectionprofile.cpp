@@ -0,0 +1,177 @@
+#include "connectionprofile.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSettings>
+#include <QFileInfo>
+#include <QVariant>
+#include <QDebug>
+
+// =========================================
+// Presets
+// =========================================
+
+// WAL with synchronous=NORMAL never corrupts the database, but a power cut
+// may lose the last few commits. Readers never wait for the writer.
+ConnectionProfile ConnectionProfile::throughput()
+{
+    return {"throughput", "WAL", "NORMAL", 64 * 1024, qint64(256) * 1024 * 1024,
+            "MEMORY", 5000};
+}
+
+// Every commit is fsynced before it returns.
+ConnectionProfile ConnectionProfile::durability()
+{
+    return {"durability", "WAL", "FULL", 16 * 1024, 0, "DEFAULT", 10000};
+}
+
+ConnectionProfile ConnectionProfile::fromName(const QString &name, bool *ok)
+{
+    QString key = name.trimmed().toLower();
+    if (ok)
+        *ok = true;
+
+    if (key == "throughput")
+        return throughput();
+    if (key == "durability")
+        return durability();
+
+    if (ok)
+        *ok = false;
+    return throughput();
+}
+
+// =========================================
+// Loading
+// =========================================
+
+ConnectionProfile ConnectionProfile::load(const QStringList &arguments,
+                                          const QString &configFile)
+{
+    QString name;
+    bool fromCommandLine = false;
+
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &arg = arguments[i];
+        if (arg.startsWith("--db-profile=")) {
+            name = arg.mid(QString("--db-profile=").size());
+            fromCommandLine = true;
+        } else if (arg == "--db-profile" && i + 1 < arguments.size()) {
+            name = arguments[++i];
+            fromCommandLine = true;
+        }
+    }
+
+    bool hasConfig = QFileInfo::exists(configFile);
+    QSettings settings(configFile, QSettings::IniFormat);
+    settings.beginGroup("database");
+
+    if (name.isEmpty() && hasConfig)
+        name = settings.value("profile").toString();
+
+    bool ok = true;
+    ConnectionProfile profile = name.isEmpty() ? throughput() : fromName(name, &ok);
+    if (!ok)
+        qWarning() << "Unknown database profile" << name << "- using" << profile.name;
+
+    // Per-pragma overrides from the config file apply on top of the preset
+    if (hasConfig) {
+        profile.journalMode   = settings.value("journal_mode", profile.journalMode).toString();
+        profile.synchronous   = settings.value("synchronous", profile.synchronous).toString();
+        profile.cacheSizeKiB  = settings.value("cache_size_kib", profile.cacheSizeKiB).toInt();
+        profile.mmapSizeBytes = settings.value("mmap_size", profile.mmapSizeBytes).toLongLong();
+        profile.tempStore     = settings.value("temp_store", profile.tempStore).toString();
+        profile.busyTimeoutMs = settings.value("busy_timeout_ms", profile.busyTimeoutMs).toInt();
+    }
+    settings.endGroup();
+
+    qInfo().noquote() << "Database profile:" << profile.describe()
+                      << (fromCommandLine ? "(command line)"
+                                          : hasConfig ? "(" + configFile + ")" : "(default)");
+    return profile;
+}
+
+// =========================================
+// Applying
+// =========================================
+
+// One of the keywords (any case) or, where SQLite also takes them, the
+// small integers below maxNumber
+static bool isAllowed(const QString &value, const QStringList &keywords, int maxNumber = -1)
+{
+    for (const QString &keyword : keywords) {
+        if (value.compare(keyword, Qt::CaseInsensitive) == 0)
+            return true;
+    }
+    bool isNumber = false;
+    int number = value.toInt(&isNumber);
+    return isNumber && number >= 0 && number <= maxNumber;
+}
+
+bool ConnectionProfile::validate(QString *error) const
+{
+    QString bad;
+    if (!isAllowed(journalMode, {"DELETE", "TRUNCATE", "PERSIST", "MEMORY", "WAL", "OFF"}))
+        bad = "journal_mode = " + journalMode;
+    else if (!isAllowed(synchronous, {"OFF", "NORMAL", "FULL", "EXTRA"}, 3))
+        bad = "synchronous = " + synchronous;
+    else if (!isAllowed(tempStore, {"DEFAULT", "FILE", "MEMORY"}, 2))
+        bad = "temp_store = " + tempStore;
+    else if (cacheSizeKiB <= 0)
+        bad = QString("cache_size_kib = %1").arg(cacheSizeKiB);
+    else if (mmapSizeBytes < 0)
+        bad = QString("mmap_size = %1").arg(mmapSizeBytes);
+    else if (busyTimeoutMs < 0)
+        bad = QString("busy_timeout_ms = %1").arg(busyTimeoutMs);
+
+    if (bad.isEmpty())
+        return true;
+    if (error)
+        *error = "Invalid setting " + bad;
+    return false;
+}
+
+bool ConnectionProfile::apply(QSqlDatabase &db, QString *error) const
+{
+    if (!validate(error))
+        return false;
+
+    // busy_timeout first so the journal switch can wait for other readers
+    const QStringList pragmas = {
+        QString("PRAGMA busy_timeout = %1").arg(busyTimeoutMs),
+        QString("PRAGMA journal_mode = %1").arg(journalMode),
+        QString("PRAGMA synchronous = %1").arg(synchronous),
+        QString("PRAGMA cache_size = -%1").arg(cacheSizeKiB),   // negative = KiB
+        QString("PRAGMA mmap_size = %1").arg(mmapSizeBytes),
+        QString("PRAGMA temp_store = %1").arg(tempStore)
+    };
+
+    QSqlQuery q(db);
+    for (const QString &sql : pragmas) {
+        if (!q.exec(sql)) {
+            if (error)
+                *error = sql + ": " + q.lastError().text();
+            return false;
+        }
+
+        // journal_mode reports the mode actually in effect, which differs
+        // from the request e.g. for in-memory databases
+        if (sql.contains("journal_mode") && q.next()) {
+            QString active = q.value(0).toString();
+            if (active.compare(journalMode, Qt::CaseInsensitive) != 0)
+                qWarning() << "journal_mode" << journalMode << "not applied, using" << active;
+        }
+    }
+    return true;
+}
+
+QString ConnectionProfile::describe() const
+{
+    return QString("%1 (journal_mode=%2, synchronous=%3, cache_size=%4 KiB, "
+                   "mmap_size=%5, temp_store=%6, busy_timeout=%7 ms)")
+        .arg(name, journalMode, synchronous)
+        .arg(cacheSizeKiB)
+        .arg(mmapSizeBytes)
+        .arg(tempStore)
+        .arg(busyTimeoutMs);
+}
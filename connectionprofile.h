@@ -0,0 +1,37 @@
+#ifndef CONNECTIONPROFILE_H
+#define CONNECTIONPROFILE_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+
+// SQLite settings applied right after a connection is opened. Two presets
+// ship with the app; "throughput" is the default. The preset comes from
+// --db-profile on the command line, else from [database] profile= in
+// srms.ini, where single pragmas can also be overridden.
+struct ConnectionProfile
+{
+    QString name;
+    QString journalMode;     // WAL, DELETE, ...
+    QString synchronous;     // OFF, NORMAL, FULL, EXTRA
+    int     cacheSizeKiB;
+    qint64  mmapSizeBytes;
+    QString tempStore;       // DEFAULT, FILE, MEMORY
+    int     busyTimeoutMs;
+
+    static ConnectionProfile throughput();
+    static ConnectionProfile durability();
+    static ConnectionProfile fromName(const QString &name, bool *ok = nullptr);
+
+    static ConnectionProfile load(const QStringList &arguments,
+                                  const QString &configFile = "srms.ini");
+
+    // false, with the offending setting, if a value is not one SQLite
+    // accepts; the values are pasted into PRAGMA statements
+    bool validate(QString *error = nullptr) const;
+    // Validates first and sets nothing if that fails
+    bool apply(QSqlDatabase &db, QString *error = nullptr) const;
+    QString describe() const;
+};
+
+#endif // CONNECTIONPROFILE_H
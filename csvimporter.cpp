@@ -0,0 +1,542 @@
+#include "csvimporter.h"
+#include "csvreader.h"
+#include "marksrepository.h"
+#include "attendancerepository.h"
+#include "marksnapshot.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// SQLite's default SQLITE_MAX_VARIABLE_NUMBER before 3.32
+static const int MaxBindValues = 999;
+
+// =========================================
+// Stats
+// =========================================
+
+double CsvImportStats::rowsPerSecond() const
+{
+    return totalMs > 0 ? rows * 1000.0 / totalMs : 0.0;
+}
+
+QString CsvImportStats::summary() const
+{
+    QString text = QString("%1: %2 rows read, %3 imported, %4 rejected in %5 ms "
+                           "(%6 statements, %7 rows/s, %8 MiB)")
+        .arg(kind)
+        .arg(rows)
+        .arg(imported)
+        .arg(rejected)
+        .arg(totalMs)
+        .arg(statements)
+        .arg(rowsPerSecond(), 0, 'f', 0)
+        .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    if (!rejectedFile.isEmpty())
+        text += "\nRejected rows: " + rejectedFile;
+    return text;
+}
+
+// =========================================
+// Setup
+// =========================================
+
+CsvImporter::CsvImporter(const QSqlDatabase &database, Kind kind)
+    : db(database),
+      kind(kind)
+{
+}
+
+QString CsvImporter::kindName(Kind kind)
+{
+    switch (kind) {
+    case Marks:      return "marks";
+    case Attendance: return "attendance";
+    default:         return "students";
+    }
+}
+
+bool CsvImporter::kindFromName(const QString &name, Kind &kind)
+{
+    QString key = name.trimmed().toLower();
+    if (key == "students")
+        kind = Students;
+    else if (key == "marks")
+        kind = Marks;
+    else if (key == "attendance")
+        kind = Attendance;
+    else
+        return false;
+    return true;
+}
+
+void CsvImporter::setProgress(Progress callback)
+{
+    progress = callback;
+}
+
+void CsvImporter::setRejectedFile(const QString &fileName)
+{
+    rejectedFileName = fileName;
+}
+
+// In the order they are bound
+QVector<CsvImporter::Column> CsvImporter::columns() const
+{
+    switch (kind) {
+    case Marks:
+        return {{"roll_no", true}, {"subject", true}, {"marks", true},
+                {"max_marks", true}, {"exam_type", true}};
+    case Attendance:
+        return {{"roll_no", true}, {"subject", true}, {"status", true},
+                {"date", false}, {"period", false}};
+    default:
+        return {{"roll_no", true}, {"name", true}, {"email", false},
+                {"branch", false}, {"year", false}, {"gender", false}};
+    }
+}
+
+static QString columnKey(QString name)
+{
+    return name.remove(' ').remove('_').toLower();
+}
+
+// index[c] is the file column of columns()[c], or -1 when absent
+bool CsvImporter::mapHeader(const CsvReader &reader, QVector<int> &index)
+{
+    const QVector<Column> wanted = columns();
+    index.fill(-1, wanted.size());
+
+    for (int f = 0; f < reader.fieldCount(); f++) {
+        QString key = columnKey(reader.text(f));
+        for (int c = 0; c < wanted.size(); c++) {
+            if (index[c] < 0 && key == columnKey(wanted[c].name))
+                index[c] = f;
+        }
+    }
+
+    QStringList missing;
+    for (int c = 0; c < wanted.size(); c++) {
+        if (wanted[c].required && index[c] < 0)
+            missing << wanted[c].name;
+    }
+    if (!missing.isEmpty()) {
+        error = "Missing column(s) for " + kindName(kind) + ": " + missing.join(", ");
+        return false;
+    }
+    return true;
+}
+
+bool CsvImporter::loadKnownStudents()
+{
+    // Attendance needs each student's ordinal as well
+    if (kind == Attendance) {
+        AttendanceRepository repository(db);
+        studentOrdinals = repository.ordinals();
+        error = repository.lastError();
+        return error.isEmpty();
+    }
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    QueryTrace trace(q);
+    if (!trace.exec("SELECT roll_no FROM students")) {
+        error = q.lastError().text();
+        return false;
+    }
+    while (trace.next())
+        knownStudents.insert(q.value(0).toString());
+    return true;
+}
+
+// =========================================
+// Rows
+// =========================================
+
+// Appends the row's bound values to values, or returns why it is rejected
+QString CsvImporter::validate(const CsvReader &reader, const QVector<int> &index,
+                              QVariantList &values)
+{
+    auto text = [&](int c) { return index[c] >= 0 ? reader.text(index[c]) : QString(); };
+
+    QString rollNo = text(0);
+    if (rollNo.isEmpty())
+        return "empty roll_no";
+
+    switch (kind) {
+    case Marks: {
+        if (!knownStudents.contains(rollNo))
+            return "unknown student " + rollNo;
+        QString subject = text(1);
+        QString examType = text(4);
+        if (subject.isEmpty())
+            return "empty subject";
+        if (examType.isEmpty())
+            return "empty exam_type";
+
+        bool marksOk = false, maxOk = false;
+        int marks = reader.toInt(index[2], &marksOk);
+        int maxMarks = reader.toInt(index[3], &maxOk);
+        if (!marksOk || !maxOk)
+            return "marks and max_marks must be whole numbers";
+        if (maxMarks <= 0)
+            return "max_marks must be positive";
+        if (marks < 0 || marks > maxMarks)
+            return "marks must be between 0 and max_marks";
+
+        values << rollNo << subject << marks << maxMarks << examType;
+        return QString();
+    }
+
+    case Attendance: {
+        int ordinal = studentOrdinals.value(rollNo, -1);
+        if (ordinal < 0)
+            return "unknown student " + rollNo;
+        QString subject = text(1);
+        if (subject.isEmpty())
+            return "empty subject";
+
+        QString status = text(2).toLower();
+        if (status == "present" || status == "p" || status == "1" || status == "yes")
+            status = "Present";
+        else if (status == "absent" || status == "a" || status == "0" || status == "no")
+            status = "Absent";
+        else
+            return "status must be Present or Absent";
+
+        // ISO dates, or day first as Excel writes them here
+        QDate date = importDate;
+        QString day = text(3);
+        if (!day.isEmpty()) {
+            date = QDate::fromString(day, Qt::ISODate);
+            if (!date.isValid())
+                date = QDate::fromString(day, "dd/MM/yyyy");
+            if (!date.isValid())
+                date = QDate::fromString(day, "dd-MM-yyyy");
+            if (!date.isValid())
+                return "date must be yyyy-MM-dd";
+        }
+
+        int period = 1;
+        if (index[4] >= 0 && reader.field(index[4]).size > 0) {
+            bool ok = false;
+            period = reader.toInt(index[4], &ok);
+            if (!ok || period < 0 || period > 12)
+                return "period must be 0 to 12";
+        }
+
+        values << ordinal << subject << (status == "Present") << date << period;
+        return QString();
+    }
+
+    default: {
+        QString name = text(1);
+        if (name.isEmpty())
+            return "empty name";
+
+        // Same choices as the student dialog; an absent column means year 1
+        int year = 1;
+        if (index[4] >= 0) {
+            bool ok = false;
+            year = reader.toInt(index[4], &ok);
+            if (!ok || year < 1 || year > 4)
+                return "year must be 1 to 4";
+        }
+
+        values << rollNo << name << text(2) << text(3) << year << text(5);
+        return QString();
+    }
+    }
+}
+
+QString CsvImporter::insertSql(int rows) const
+{
+    QString sql;
+    int width = 0;
+    switch (kind) {
+    case Marks:
+        sql = "INSERT INTO marks (roll_no, subject, marks, max_marks, exam_type) VALUES ";
+        width = 5;
+        break;
+    default:
+        sql = "INSERT INTO students (roll_no, name, email, branch, year, gender) VALUES ";
+        width = 6;
+        break;
+    }
+
+    QString tuple = "(" + QString("?, ").repeated(width - 1) + "?)";
+    for (int r = 0; r < rows; r++)
+        sql += (r ? ", " : "") + tuple;
+
+    // Same conflict handling as StudentRepository::upsert
+    if (kind == Students)
+        sql += " ON CONFLICT(roll_no) DO UPDATE SET"
+               " name = excluded.name, email = excluded.email,"
+               " branch = excluded.branch, year = excluded.year,"
+               " gender = excluded.gender";
+    return sql;
+}
+
+// Full batches always have the same row count and share one cached
+// statement; the final partial batch is prepared once and dropped
+bool CsvImporter::flush(QVariantList &values, int rows)
+{
+    if (rows == 0)
+        return true;
+
+    if (kind == Attendance) {
+        addAttendance(values);
+        result.imported += rows;
+        values.clear();
+        return true;
+    }
+
+    QSqlQuery partial(db);
+    QSqlQuery *q = &partial;
+    if (rows == MaxBindValues / columns().size())
+        q = &StatementCache::forDatabase(db).prepared(insertSql(rows));
+    else if (!partial.prepare(insertSql(rows))) {
+        error = partial.lastError().text();
+        return false;
+    }
+
+    for (int i = 0; i < values.size(); i++)
+        q->bindValue(i, values[i]);
+
+    if (!QueryTrace(*q).exec()) {
+        error = q->lastError().text();
+        return false;
+    }
+    result.imported += rows;
+    result.statements++;
+    values.clear();
+    return true;
+}
+
+// Values are (ordinal, subject, present, date, period) tuples; a later row
+// for the same student and session wins
+void CsvImporter::addAttendance(const QVariantList &values)
+{
+    for (int i = 0; i + 4 < values.size(); i += 5) {
+        QString subject = values[i + 1].toString();
+        QDate date = values[i + 3].toDate();
+        int period = values[i + 4].toInt();
+        QString key = subject + '|' + date.toString(Qt::ISODate) + '|' + QString::number(period);
+
+        auto it = pendingSessions.find(key);
+        if (it == pendingSessions.end()) {
+            it = pendingSessions.insert(key, PendingSession());
+            it->subject = subject;
+            it->date = date;
+            it->period = period;
+        }
+        int ordinal = values[i].toInt();
+        it->roster.set(ordinal);
+        it->present.set(ordinal, values[i + 2].toBool());
+    }
+}
+
+bool CsvImporter::saveSessions()
+{
+    AttendanceRepository repository(db);
+    for (const PendingSession &session : pendingSessions) {
+        if (!repository.save(session.subject, session.date, session.period,
+                             session.roster, session.present)) {
+            error = repository.lastError();
+            return false;
+        }
+        result.statements++;
+    }
+    pendingSessions.clear();
+    return true;
+}
+
+// =========================================
+// Import
+// =========================================
+
+bool CsvImporter::run(const QString &fileName, const QueryCancelToken &token)
+{
+    result = CsvImportStats();
+    result.kind = kindName(kind);
+    error.clear();
+
+    QElapsedTimer total;
+    total.start();
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = "Could not open " + fileName + ": " + file.errorString();
+        return false;
+    }
+    result.bytes = file.size();
+    if (result.bytes == 0) {
+        error = fileName + " is empty";
+        return false;
+    }
+
+    // Stays valid until the file is closed; pages are read on demand
+    const uchar *mapped = file.map(0, result.bytes);
+    if (!mapped) {
+        error = "Could not map " + fileName + ": " + file.errorString();
+        return false;
+    }
+    CsvReader reader(reinterpret_cast<const char *>(mapped), result.bytes);
+
+    if (!reader.next()) {
+        error = fileName + " has no header";
+        return false;
+    }
+    QVector<int> index;
+    if (!mapHeader(reader, index))
+        return false;
+    QByteArray header(reader.recordData(), reader.recordSize());
+
+    knownStudents.clear();
+    studentOrdinals.clear();
+    pendingSessions.clear();
+    importDate = QDate::currentDate();
+    if (kind != Students && !loadKnownStudents())
+        return false;
+
+    // Rejected rows keep their original bytes, so they can be fixed in the
+    // spreadsheet and imported again. They go to a temporary file that
+    // replaces the old one only once the import has committed; a failed
+    // import leaves the previous file as it was.
+    QString rejectedPath = rejectedFileName;
+    if (rejectedPath.isEmpty()) {
+        QFileInfo info(fileName);
+        rejectedPath = info.dir().filePath(info.completeBaseName() + ".rejected.csv");
+    }
+    QSaveFile rejected(rejectedPath);
+    const char delimiter = reader.delimiter();
+    auto reject = [&](const QString &reason) -> bool {
+        if (!rejected.isOpen()) {
+            if (!rejected.open(QIODevice::WriteOnly)) {
+                error = "Could not write " + rejectedPath + ": " + rejected.errorString();
+                return false;
+            }
+            rejected.write(header + delimiter + "error\r\n");
+        }
+        QByteArray quoted = reason.toUtf8().replace('"', "\"\"");
+        rejected.write(QByteArray(reader.recordData(), reader.recordSize())
+                       + delimiter + '"' + quoted + "\"\r\n");
+        result.rejected++;
+        return true;
+    };
+
+    if (!db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+    auto fail = [&]() {
+        db.rollback();
+        return false;
+    };
+
+    // New marks are the ones above the current highest mark_id
+    // (AUTOINCREMENT never reuses ids)
+    qint64 lastMarkId = 0;
+    if (kind == Marks) {
+        QSqlQuery q(db);
+        QueryTrace trace(q);
+        if (!trace.exec("SELECT COALESCE(MAX(mark_id), 0) FROM marks") || !trace.next()) {
+            error = q.lastError().text();
+            return fail();
+        }
+        lastMarkId = q.value(0).toLongLong();
+    }
+
+    const int width = columns().size();
+    const int rowsPerStatement = MaxBindValues / width;
+    QVariantList values;
+    values.reserve(rowsPerStatement * width);
+    int batched = 0;
+
+    QElapsedTimer sinceReport;
+    sinceReport.start();
+
+    while (reader.next()) {
+        // Blank lines, typically at the end of Excel exports
+        if (reader.fieldCount() == 1 && reader.field(0).size == 0)
+            continue;
+        result.rows++;
+
+        QString reason = validate(reader, index, values);
+        if (!reason.isEmpty()) {
+            if (!reject(QString("line %1: %2").arg(reader.line()).arg(reason)))
+                return fail();
+            continue;
+        }
+
+        if (++batched < rowsPerStatement)
+            continue;
+        if (!flush(values, batched))
+            return fail();
+        batched = 0;
+
+        if (token.isCancelled()) {
+            error = "Cancelled";
+            return fail();
+        }
+        if (progress && sinceReport.elapsed() >= 100) {
+            progress(reader.offset(), result.bytes, result.rows);
+            sinceReport.restart();
+        }
+    }
+    if (!flush(values, batched))
+        return fail();
+
+    if (kind == Attendance && !saveSessions())
+        return fail();
+
+    if (kind == Marks) {
+        MarksRepository marks(db);
+        if (!marks.addTotalsSince(lastMarkId)) {
+            error = marks.lastError();
+            return fail();
+        }
+    }
+
+    if (!db.commit()) {
+        error = db.lastError().text();
+        return fail();
+    }
+    // New students and marks reach the snapshot on its next load
+    MarksSnapshot::invalidate(db);
+    CohortRanking::invalidateAll(db);
+    StudentProfileRepository::invalidateAll(db);
+
+    // The rows are in; a rejects file that cannot be written only loses
+    // the copy of the bad ones
+    if (!rejected.isOpen())
+        QFile::remove(rejectedPath);
+    else if (rejected.commit())
+        result.rejectedFile = rejectedPath;
+    else
+        qWarning().noquote() << "Could not write" << rejectedPath << ":" << rejected.errorString();
+    if (progress)
+        progress(result.bytes, result.bytes, result.rows);
+    result.totalMs = total.elapsed();
+    return true;
+}
+
+CsvImportStats CsvImporter::stats() const
+{
+    return result;
+}
+
+QString CsvImporter::lastError() const
+{
+    return error;
+}
@@ -0,0 +1,122 @@
+#ifndef CSVIMPORTER_H
+#define CSVIMPORTER_H
+
+#include "querycanceltoken.h"
+#include "attendancebitmap.h"
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+#include <QSet>
+#include <QHash>
+#include <QMap>
+#include <QDate>
+#include <QMetaType>
+
+#include <functional>
+
+class CsvReader;
+
+struct CsvImportStats
+{
+    QString kind;
+    qint64  bytes = 0;
+    qint64  rows = 0;           // data records read, without the header
+    qint64  imported = 0;
+    qint64  rejected = 0;
+    int     statements = 0;     // multi-row INSERTs executed, or attendance sessions saved
+    qint64  totalMs = 0;
+    QString rejectedFile;       // empty when nothing was rejected
+
+    double rowsPerSecond() const;
+    QString summary() const;
+};
+
+Q_DECLARE_METATYPE(CsvImportStats)
+
+// Bulk import of students, marks or attendance from a CSV file, Excel
+// exports included. The file is memory-mapped and parsed in place; valid
+// rows are inserted with multi-row INSERTs of up to 999 bound values each,
+// all in one transaction. Rows failing validation do not stop the import:
+// they are copied unchanged to <name>.rejected.csv with the reason in an
+// extra "error" column. That file is replaced only when the import
+// commits.
+//
+// The first record is a header. Columns are matched by name, ignoring
+// case, spaces and underscores, so "Roll No" finds roll_no:
+//   students:   roll_no, name [, email, branch, year, gender]
+//   marks:      roll_no, subject, marks, max_marks, exam_type
+//   attendance: roll_no, subject, status [, date, period]
+// Students are upserted by roll_no; marks are appended and folded into the
+// CGPA totals afterwards. Attendance rows are gathered into session
+// bitmaps per (subject, date, period) and each session is saved once; a
+// missing date means the day of the import, a missing period period 1.
+class CsvImporter
+{
+public:
+    enum Kind {
+        Students,
+        Marks,
+        Attendance
+    };
+
+    // Called from the importing thread, at most every 100 ms
+    using Progress = std::function<void(qint64 bytesDone, qint64 bytesTotal, qint64 rows)>;
+
+    CsvImporter(const QSqlDatabase &database, Kind kind);
+
+    static QString kindName(Kind kind);
+    static bool kindFromName(const QString &name, Kind &kind);
+
+    void setProgress(Progress callback);
+    void setRejectedFile(const QString &fileName);  // default: next to the input
+
+    // All or nothing for the database: a failure or cancellation rolls back
+    bool run(const QString &fileName, const QueryCancelToken &token = QueryCancelToken());
+
+    CsvImportStats stats() const;
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    Kind kind;
+    QString error;
+    CsvImportStats result;
+    Progress progress;
+    QString rejectedFileName;
+
+    struct Column
+    {
+        const char *name;
+        bool        required;
+    };
+    QVector<Column> columns() const;
+
+    bool mapHeader(const CsvReader &reader, QVector<int> &index);
+    QString validate(const CsvReader &reader, const QVector<int> &index, QVariantList &values);
+    QString insertSql(int rows) const;
+    bool flush(QVariantList &values, int rows);
+
+    bool loadKnownStudents();
+    QSet<QString> knownStudents;
+
+    // Attendance, by "subject|date|period"
+    struct PendingSession
+    {
+        QString subject;
+        QDate   date;
+        int     period = 1;
+        AttendanceBitmap roster;
+        AttendanceBitmap present;
+    };
+    QHash<QString, int> studentOrdinals;
+    QMap<QString, PendingSession> pendingSessions;
+    QDate importDate;
+
+    void addAttendance(const QVariantList &values);
+    bool saveSessions();
+};
+
+#endif // CSVIMPORTER_H
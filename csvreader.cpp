@@ -0,0 +1,217 @@
+#include "csvreader.h"
+
+#include <algorithm>
+#include <cstring>
+
+CsvReader::CsvReader(const char *data, qint64 size)
+    : begin(data),
+      end(data + size),
+      pos(data),
+      delim(0),
+      recordBegin(data),
+      recordEnd(data),
+      currentLine(0),
+      nextLine(1)
+{
+    // UTF-8 byte order mark, as written by Excel's "CSV UTF-8"
+    if (end - pos >= 3 && std::memcmp(pos, "\xEF\xBB\xBF", 3) == 0)
+        pos += 3;
+
+    // Excel's delimiter hint: "sep=;" on a line of its own
+    if (end - pos >= 5 && std::memcmp(pos, "sep=", 4) == 0
+        && (end - pos == 5 || pos[5] == '\r' || pos[5] == '\n')) {
+        delim = pos[4];
+        pos += 5;
+        if (pos < end && *pos == '\r')
+            pos++;
+        if (pos < end && *pos == '\n')
+            pos++;
+        nextLine++;
+    }
+}
+
+void CsvReader::setDelimiter(char delimiter)
+{
+    delim = delimiter;
+}
+
+char CsvReader::delimiter() const
+{
+    return delim;
+}
+
+void CsvReader::detectDelimiter()
+{
+    int commas = 0, semicolons = 0, tabs = 0;
+    bool quoted = false;
+    for (const char *p = pos; p < end; p++) {
+        char c = *p;
+        if (c == '"')
+            quoted = !quoted;
+        else if (quoted)
+            continue;
+        else if (c == '\n' || c == '\r')
+            break;
+        else if (c == ',')
+            commas++;
+        else if (c == ';')
+            semicolons++;
+        else if (c == '\t')
+            tabs++;
+    }
+
+    delim = ',';
+    if (semicolons > commas && semicolons >= tabs)
+        delim = ';';
+    else if (tabs > commas && tabs > semicolons)
+        delim = '\t';
+}
+
+bool CsvReader::next()
+{
+    if (pos >= end)
+        return false;
+    if (!delim)
+        detectDelimiter();
+
+    fields.clear();
+    scratch.clear();
+    escaped.clear();
+    recordBegin = pos;
+    currentLine = nextLine;
+
+    const char *p = pos;
+    for (;;) {
+        Field f = {p, 0};
+
+        if (p < end && *p == '"') {
+            const char *start = ++p;
+            const char *close = end;
+            bool hasEscapes = false;
+            while (p < end) {
+                const char *quote = static_cast<const char *>(std::memchr(p, '"', end - p));
+                if (!quote)
+                    quote = end;
+                nextLine += int(std::count(p, quote, '\n'));
+                if (quote + 1 < end && quote[1] == '"') {
+                    hasEscapes = true;
+                    p = quote + 2;
+                    continue;
+                }
+                close = quote;
+                p = quote < end ? quote + 1 : end;
+                break;
+            }
+
+            if (!hasEscapes) {
+                f = {start, int(close - start)};
+            } else {
+                // Offset into scratch for now; scratch may still grow
+                int offset = scratch.size();
+                for (const char *c = start; c < close; c++) {
+                    scratch.append(*c);
+                    if (*c == '"')
+                        c++;
+                }
+                f = {reinterpret_cast<const char *>(quintptr(offset)), scratch.size() - offset};
+                escaped.append(fields.size());
+            }
+
+            // Anything between the closing quote and the delimiter is dropped
+            while (p < end && *p != delim && *p != '\n' && *p != '\r')
+                p++;
+        } else {
+            const char *q = p;
+            while (q < end && *q != delim && *q != '\n' && *q != '\r')
+                q++;
+            f.size = int(q - p);
+            p = q;
+        }
+        fields.append(f);
+
+        if (p < end && *p == delim) {
+            p++;
+            continue;
+        }
+
+        recordEnd = p;
+        if (p < end && *p == '\r')
+            p++;
+        if (p < end && *p == '\n')
+            p++;
+        nextLine++;
+        break;
+    }
+    pos = p;
+
+    for (int i : escaped)
+        fields[i].data = scratch.constData() + quintptr(fields[i].data);
+    return true;
+}
+
+int CsvReader::fieldCount() const
+{
+    return fields.size();
+}
+
+const CsvReader::Field &CsvReader::field(int i) const
+{
+    return fields[i];
+}
+
+QString CsvReader::text(int i) const
+{
+    if (i < 0 || i >= fields.size())
+        return QString();
+    return QString::fromUtf8(fields[i].data, fields[i].size).trimmed();
+}
+
+// Straight from the bytes: no QString, no allocation
+int CsvReader::toInt(int i, bool *ok) const
+{
+    *ok = false;
+    if (i < 0 || i >= fields.size())
+        return 0;
+
+    const char *p = fields[i].data;
+    const char *e = p + fields[i].size;
+    while (p < e && *p == ' ')
+        p++;
+    while (e > p && e[-1] == ' ')
+        e--;
+
+    bool negative = false;
+    if (p < e && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p == e || e - p > 9)
+        return 0;
+
+    int value = 0;
+    for (; p < e; p++) {
+        if (*p < '0' || *p > '9')
+            return 0;
+        value = value * 10 + (*p - '0');
+    }
+    *ok = true;
+    return negative ? -value : value;
+}
+
+const char *CsvReader::recordData() const
+{
+    return recordBegin;
+}
+
+int CsvReader::recordSize() const
+{
+    return int(recordEnd - recordBegin);
+}
+
+qint64 CsvReader::offset() const
+{
+    return pos - begin;
+}
+
+int CsvReader::line() const
+{
+    return currentLine;
+}
@@ -0,0 +1,61 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+// RFC 4180 records over a buffer the caller keeps alive, usually a file
+// mapped with QFile::map. Fields point straight into the buffer; only
+// quoted fields containing "" are unescaped, into a per-record scratch
+// buffer. Handles what Excel writes: a UTF-8 BOM, CRLF, quoted line
+// breaks, a "sep=;" first line and ';' or tab instead of ','.
+class CsvReader
+{
+public:
+    struct Field
+    {
+        const char *data;
+        int         size;
+    };
+
+    CsvReader(const char *data, qint64 size);
+
+    // Guessed from the first line when not set: the most frequent of
+    // ',', ';' and tab outside quotes
+    void setDelimiter(char delimiter);
+    char delimiter() const;
+
+    // Advances to the next record; false at the end of the buffer
+    bool next();
+
+    int fieldCount() const;
+    const Field &field(int i) const;
+    QString text(int i) const;                  // UTF-8, trimmed
+    int toInt(int i, bool *ok) const;
+
+    // The record as it appears in the buffer, without its line break
+    const char *recordData() const;
+    int recordSize() const;
+
+    qint64 offset() const;      // bytes consumed so far
+    int line() const;           // first line of the current record, from 1
+
+private:
+    const char *begin;
+    const char *end;
+    const char *pos;
+    char delim;
+
+    QVector<Field> fields;
+    QByteArray scratch;
+    QVector<int> escaped;       // fields whose data is an offset in scratch
+    const char *recordBegin;
+    const char *recordEnd;
+    int currentLine;
+    int nextLine;
+
+    void detectDelimiter();
+};
+
+#endif // CSVREADER_H
@@ -0,0 +1,238 @@
+#include "dashboardrepository.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QHash>
+#include <QPair>
+
+namespace {
+
+// Results of the marks_agg rows a (joined to students s) selected by the
+// WHERE clause that follows, as a signed delta per class and subject
+QString resultsDelta()
+{
+    return QString("INSERT INTO class_subject_summary (branch, year, subject, results, passed, pct_sum) "
+                   "SELECT COALESCE(s.branch, ''), COALESCE(s.year, 0), a.subject,"
+                   " ? * COUNT(*), ? * SUM(a.sum_pct >= %1 * a.n), ? * SUM(a.sum_pct / a.n) "
+                   "FROM marks_agg a JOIN students s ON s.roll_no = a.roll_no ")
+        .arg(DashboardRepository::PassPercentage);
+}
+
+const char *const ResultsUpsert =
+    " GROUP BY 1, 2, 3 "
+    "ON CONFLICT(branch, year, subject) DO UPDATE SET"
+    " results = results + excluded.results, passed = passed + excluded.passed,"
+    " pct_sum = pct_sum + excluded.pct_sum";
+
+} // namespace
+
+DashboardRepository::DashboardRepository(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QVector<ClassSummary> DashboardRepository::classes()
+{
+    QVector<ClassSummary> classes;
+    QHash<QPair<QString, int>, int> index;
+
+    StatementCache &statements = StatementCache::forDatabase(db);
+    QSqlQuery &q = statements.prepared(
+        "SELECT branch, year, students, graded, cgpa_sum FROM class_summary "
+        "WHERE students > 0 ORDER BY branch, year");
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return classes;
+    }
+    while (trace.next()) {
+        ClassSummary c;
+        c.branch   = q.value(0).toString();
+        c.year     = q.value(1).toInt();
+        c.students = q.value(2).toInt();
+        c.graded   = q.value(3).toInt();
+        c.cgpaSum  = q.value(4).toDouble();
+        c.attendanceBands.fill(0, AttendanceBands);
+        index.insert(qMakePair(c.branch, c.year), classes.size());
+        classes.append(c);
+    }
+    trace.finish();
+
+    QSqlQuery &bands = statements.prepared(
+        "SELECT branch, year, band, students, held, present FROM class_attendance_summary "
+        "WHERE students > 0");
+    QueryTrace bandTrace(bands);
+    if (!bandTrace.exec()) {
+        error = bands.lastError().text();
+        return classes;
+    }
+    while (bandTrace.next()) {
+        int i = index.value(qMakePair(bands.value(0).toString(), bands.value(1).toInt()), -1);
+        int band = bands.value(2).toInt();
+        if (i < 0 || band < 0 || band >= AttendanceBands)
+            continue;
+        ClassSummary &c = classes[i];
+        c.attendanceBands[band] += bands.value(3).toInt();
+        c.held += bands.value(4).toLongLong();
+        c.present += bands.value(5).toLongLong();
+    }
+    return classes;
+}
+
+QVector<SubjectResults> DashboardRepository::subjects(const QString &branch, int year)
+{
+    QVector<SubjectResults> subjects;
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT subject, results, passed, pct_sum FROM class_subject_summary "
+        "WHERE branch = ? AND year = ? AND results > 0 ORDER BY subject");
+    q.addBindValue(branch);
+    q.addBindValue(year);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return subjects;
+    }
+    while (trace.next()) {
+        SubjectResults s;
+        s.subject       = q.value(0).toString();
+        s.results       = q.value(1).toInt();
+        s.passed        = q.value(2).toInt();
+        s.percentageSum = q.value(3).toDouble();
+        subjects.append(s);
+    }
+    return subjects;
+}
+
+// =========================================
+// Maintenance
+// =========================================
+
+bool DashboardRepository::addResults(int sign, const QString &rollNo, const QString &subject,
+                                     const QString &examType)
+{
+    static const QString sql = resultsDelta()
+        + "WHERE a.roll_no = ? AND a.subject = ? AND a.exam_type = ? AND a.n > 0" + ResultsUpsert;
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    q.addBindValue(sign);
+    q.addBindValue(sign);
+    q.addBindValue(sign);
+    q.addBindValue(rollNo);
+    q.addBindValue(subject);
+    q.addBindValue(examType);
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// The same keys MarksRepository::addTotalsSince folds in; mark_id is the
+// rowid, so the IN list only reads the new rows
+bool DashboardRepository::addResultsSince(int sign, qint64 afterMarkId)
+{
+    static const QString sql = resultsDelta()
+        + "WHERE a.n > 0 AND (a.roll_no, a.subject, a.exam_type) IN"
+          " (SELECT roll_no, COALESCE(subject, ''), COALESCE(exam_type, '') FROM marks"
+          "  WHERE mark_id > ? AND max_marks > 0)"
+        + ResultsUpsert;
+
+    QSqlQuery q(db);
+    q.prepare(sql);
+    q.addBindValue(sign);
+    q.addBindValue(sign);
+    q.addBindValue(sign);
+    q.addBindValue(afterMarkId);
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool DashboardRepository::rebuildResults()
+{
+    if (!begin())
+        return false;
+
+    if (!exec("DELETE FROM class_subject_summary")
+        || !exec(QString("INSERT INTO class_subject_summary (branch, year, subject, results, passed, pct_sum) "
+                         "SELECT COALESCE(s.branch, ''), COALESCE(s.year, 0), a.subject,"
+                         " COUNT(*), SUM(a.sum_pct >= %1 * a.n), SUM(a.sum_pct / a.n) "
+                         "FROM marks_agg a JOIN students s ON s.roll_no = a.roll_no "
+                         "WHERE a.n > 0 GROUP BY 1, 2, 3")
+                     .arg(PassPercentage))) {
+        rollback();
+        return false;
+    }
+    return commit();
+}
+
+bool DashboardRepository::rebuild()
+{
+    if (!begin())
+        return false;
+
+    if (!exec("DELETE FROM class_summary")
+        || !exec("INSERT INTO class_summary (branch, year, students, graded, cgpa_sum) "
+                 "SELECT COALESCE(branch, ''), COALESCE(year, 0), COUNT(*),"
+                 " SUM(COALESCE(cgpa, 0) > 0), TOTAL(CASE WHEN cgpa > 0 THEN cgpa END) "
+                 "FROM students GROUP BY 1, 2")
+        || !rebuildResults()
+        || !exec("DELETE FROM class_attendance_summary")
+        || !exec(QString("INSERT INTO class_attendance_summary (branch, year, band, students, held, present) "
+                         "SELECT COALESCE(s.branch, ''), COALESCE(s.year, 0),"
+                         " MIN(%1, a.present * %2 / a.held), COUNT(*), SUM(a.held), SUM(a.present) "
+                         "FROM student_attendance a "
+                         "JOIN student_ordinals o ON o.ordinal = a.ordinal "
+                         "JOIN students s ON s.roll_no = o.roll_no "
+                         "WHERE a.held > 0 GROUP BY 1, 2, 3")
+                     .arg(AttendanceBands - 1)
+                     .arg(AttendanceBands))) {
+        rollback();
+        return false;
+    }
+    return commit();
+}
+
+bool DashboardRepository::exec(const QString &sql)
+{
+    QSqlQuery q(db);
+    if (!QueryTrace(q).exec(sql)) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Savepoints, so the write paths that call in here keep one transaction
+bool DashboardRepository::begin()
+{
+    return exec("SAVEPOINT dashboard_write");
+}
+
+bool DashboardRepository::commit()
+{
+    if (!exec("RELEASE dashboard_write")) {
+        rollback();
+        return false;
+    }
+    return true;
+}
+
+void DashboardRepository::rollback()
+{
+    QSqlQuery q(db);
+    QueryTrace(q).exec("ROLLBACK TO dashboard_write");
+    QueryTrace(q).exec("RELEASE dashboard_write");
+}
+
+QString DashboardRepository::lastError() const
+{
+    return error;
+}
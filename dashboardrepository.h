@@ -0,0 +1,88 @@
+#ifndef DASHBOARDREPOSITORY_H
+#define DASHBOARDREPOSITORY_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+
+// One class: a (branch, year) pair. Students without a branch or year are
+// grouped under "" / 0.
+struct ClassSummary
+{
+    QString branch;
+    int     year = 0;
+    int     students = 0;
+    int     graded = 0;             // with a CGPA above 0
+    double  cgpaSum = 0.0;
+    qint64  held = 0;               // sessions, summed over the students
+    qint64  present = 0;
+    QVector<int> attendanceBands;   // students per band, see DashboardRepository
+
+    double averageCgpa() const { return graded > 0 ? cgpaSum / graded : 0.0; }
+    double attendancePercentage() const { return held > 0 ? present * 100.0 / held : 0.0; }
+};
+
+// A class's results in one subject. A result is one student's average in
+// one (subject, exam_type), i.e. a row of marks_agg.
+struct SubjectResults
+{
+    QString subject;
+    int     results = 0;
+    int     passed = 0;
+    double  percentageSum = 0.0;
+
+    double passRate() const { return results > 0 ? passed * 100.0 / results : 0.0; }
+    double averagePercentage() const { return results > 0 ? percentageSum / results : 0.0; }
+};
+
+// Per-class summaries kept current as the data changes, so the dashboard
+// reads a few dozen rows instead of scanning marks:
+//
+//   class_summary             students, graded students, CGPA sum
+//   class_subject_summary     per subject: results, passed, percentage sum
+//   class_attendance_summary  students per AttendanceBands-wide band of
+//                             attendance, with their sessions held/attended
+//
+// Triggers on students (added, removed, moved between classes, CGPA
+// changed) and on student_attendance (per-student session totals kept by
+// AttendanceRepository) maintain them row by row. Results follow marks_agg
+// through MarksRepository's write paths: addResults() with -1 before an
+// aggregate changes and +1 after, set-wise for bulk inserts. Bulk rebuilds
+// of the aggregates call rebuildResults(); rebuild() recomputes everything
+// and also clears floating-point drift in the sums.
+class DashboardRepository
+{
+public:
+    static const int PassPercentage = 40;
+    static const int AttendanceBands = 10;     // 0-10%, 10-20%, ... 90-100%
+
+    explicit DashboardRepository(const QSqlDatabase &database);
+
+    // Every class with students, in branch, year order
+    QVector<ClassSummary> classes();
+    // Subjects with results in a class, by name
+    QVector<SubjectResults> subjects(const QString &branch, int year);
+
+    // sign (+1 / -1) times the results of the marks_agg rows of one
+    // (roll_no, subject, exam_type), or of every one with marks after
+    // afterMarkId
+    bool addResults(int sign, const QString &rollNo, const QString &subject,
+                    const QString &examType);
+    bool addResultsSince(int sign, qint64 afterMarkId);
+
+    bool rebuildResults();
+    bool rebuild();
+
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+
+    bool exec(const QString &sql);
+    bool begin();
+    bool commit();
+    void rollback();
+};
+
+#endif // DASHBOARDREPOSITORY_H
@@ -0,0 +1,714 @@
+#include "dataexporter.h"
+#include "querystats.h"
+#include "attendancerepository.h"
+
+#include <QSaveFile>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QVector>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QtEndian>
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <functional>
+
+// =========================================
+// Stats
+// =========================================
+
+double DataExportStats::rowsPerSecond() const
+{
+    return totalMs > 0 ? rows * 1000.0 / totalMs : 0.0;
+}
+
+QString DataExportStats::summary() const
+{
+    return QString("%1 as %2: %3 rows, %4 MiB in %5 ms (%6 rows/s) to %7")
+        .arg(source, format)
+        .arg(rows)
+        .arg(bytes / (1024.0 * 1024.0), 0, 'f', 1)
+        .arg(totalMs)
+        .arg(rowsPerSecond(), 0, 'f', 0)
+        .arg(fileName);
+}
+
+// =========================================
+// Sources
+// =========================================
+
+namespace {
+
+enum class ColumnType {
+    Text,
+    Integer,
+    Real
+};
+
+struct Column
+{
+    const char *name;
+    ColumnType  type;
+};
+
+using Row = QVector<QVariant>;
+using RowSink = std::function<bool(const Row &row)>;
+
+// Sources that are not a single query hand their rows to sink, and stop
+// when it returns false
+using Generator = bool (*)(const QSqlDatabase &db, const RowSink &sink, QString &error);
+
+struct Source
+{
+    const char     *name;
+    const char     *sql;            // nullptr for generated sources
+    QVector<Column> columns;
+    Generator       generate;
+};
+
+// One row per student per session, session by session as
+// AttendanceRepository::forEachSession visits them, students by ordinal
+bool exportAttendance(const QSqlDatabase &db, const RowSink &sink, QString &error)
+{
+    AttendanceRepository repository(db);
+    const QVector<QString> rollNos = repository.rollNosByOrdinal();
+    if (!repository.lastError().isEmpty()) {
+        error = repository.lastError();
+        return false;
+    }
+
+    const QVariant present("Present");
+    const QVariant absent("Absent");
+    Row row(5);
+    bool stopped = false;
+    bool ok = repository.forEachSession(
+        [&](const AttendanceSession &session, const AttendanceBitmap &roster,
+            const AttendanceBitmap &presentBits) {
+            row[1] = session.subject;
+            row[2] = session.date.toString(Qt::ISODate);
+            row[3] = session.period;
+            roster.forEach([&](int ordinal) {
+                if (stopped || ordinal >= rollNos.size() || rollNos[ordinal].isEmpty())
+                    return;
+                row[0] = rollNos[ordinal];
+                row[4] = presentBits.test(ordinal) ? present : absent;
+                stopped = !sink(row);
+            });
+            return !stopped;
+        });
+    if (!ok)
+        error = repository.lastError();
+    return ok;
+}
+
+// Sessions held and attended by each student over every session, counted
+// per ordinal in one pass, then joined to the students in roll_no order
+bool exportAttendanceSummary(const QSqlDatabase &db, const RowSink &sink, QString &error)
+{
+    AttendanceRepository repository(db);
+    QVector<int> held, present;
+    bool ok = repository.forEachSession(
+        [&](const AttendanceSession &, const AttendanceBitmap &roster,
+            const AttendanceBitmap &presentBits) {
+            if (roster.words().size() * 64 > held.size()) {
+                held.resize(roster.words().size() * 64);
+                present.resize(held.size());
+            }
+            roster.forEach([&](int ordinal) {
+                held[ordinal]++;
+                if (presentBits.test(ordinal))
+                    present[ordinal]++;
+            });
+            return true;
+        });
+    if (!ok) {
+        error = repository.lastError();
+        return false;
+    }
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    QueryTrace trace(q);
+    if (!trace.exec("SELECT s.roll_no, s.name, s.branch, s.year, o.ordinal FROM students s "
+                    "LEFT JOIN student_ordinals o ON o.roll_no = s.roll_no ORDER BY s.roll_no")) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    Row row(7);
+    while (trace.next()) {
+        int ordinal = q.isNull(4) ? -1 : q.value(4).toInt();
+        int h = ordinal >= 0 ? held.value(ordinal) : 0;
+        int p = ordinal >= 0 ? present.value(ordinal) : 0;
+        for (int c = 0; c < 4; c++)
+            row[c] = q.value(c);
+        row[4] = h;
+        row[5] = p;
+        row[6] = h > 0 ? QVariant(std::round(p * 1000.0 / h) / 10.0) : QVariant(QVariant::Double);
+        if (!sink(row))
+            return true;
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Each ORDER BY follows an index, so no source needs a sort
+const QVector<Source> &allSources()
+{
+    static const QVector<Source> list = {
+        {"students",
+         "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students ORDER BY roll_no",
+         {{"roll_no", ColumnType::Text}, {"name", ColumnType::Text}, {"email", ColumnType::Text},
+          {"branch", ColumnType::Text}, {"year", ColumnType::Integer},
+          {"gender", ColumnType::Text}, {"cgpa", ColumnType::Real}}},
+
+        {"marks",
+         "SELECT mark_id, roll_no, subject, marks, max_marks, exam_type FROM marks ORDER BY mark_id",
+         {{"mark_id", ColumnType::Integer}, {"roll_no", ColumnType::Text},
+          {"subject", ColumnType::Text}, {"marks", ColumnType::Integer},
+          {"max_marks", ColumnType::Integer}, {"exam_type", ColumnType::Text}}},
+
+        {"attendance", nullptr,
+         {{"roll_no", ColumnType::Text}, {"subject", ColumnType::Text},
+          {"date", ColumnType::Text}, {"period", ColumnType::Integer},
+          {"status", ColumnType::Text}},
+         exportAttendance},
+
+        {"results",
+         "SELECT s.roll_no, s.name, s.branch, s.year, m.subject, m.exam_type, m.marks, m.max_marks,"
+         " ROUND(m.marks * 100.0 / m.max_marks, 2), s.cgpa "
+         "FROM students s JOIN marks m ON m.roll_no = s.roll_no "
+         "ORDER BY s.roll_no, m.subject, m.exam_type",
+         {{"roll_no", ColumnType::Text}, {"name", ColumnType::Text}, {"branch", ColumnType::Text},
+          {"year", ColumnType::Integer}, {"subject", ColumnType::Text},
+          {"exam_type", ColumnType::Text}, {"marks", ColumnType::Integer},
+          {"max_marks", ColumnType::Integer}, {"percentage", ColumnType::Real},
+          {"cgpa", ColumnType::Real}}},
+
+        {"attendance_summary", nullptr,
+         {{"roll_no", ColumnType::Text}, {"name", ColumnType::Text}, {"branch", ColumnType::Text},
+          {"year", ColumnType::Integer}, {"sessions", ColumnType::Integer},
+          {"present", ColumnType::Integer}, {"present_pct", ColumnType::Real}},
+         exportAttendanceSummary}
+    };
+    return list;
+}
+
+// =========================================
+// Output
+// =========================================
+
+// Collects small appends and hands them to the file in 1 MiB writes
+class Output
+{
+public:
+    explicit Output(QSaveFile &file) : file(file), flushed(0), failed(false)
+    {
+        buffer.reserve(Capacity);
+    }
+
+    void append(const char *data, int size)
+    {
+        if (buffer.size() + size > Capacity)
+            flush();
+        buffer.append(data, size);
+    }
+
+    void append(const QByteArray &data) { append(data.constData(), data.size()); }
+    void append(char c) { append(&c, 1); }
+
+    bool flush()
+    {
+        if (!buffer.isEmpty() && !failed) {
+            failed = file.write(buffer) != buffer.size();
+            flushed += buffer.size();
+        }
+        buffer.clear();
+        return !failed;
+    }
+
+    qint64 position() const { return flushed + buffer.size(); }
+    bool ok() const { return !failed; }
+
+private:
+    static const int Capacity = 1 << 20;
+
+    QSaveFile &file;
+    QByteArray buffer;
+    qint64 flushed;
+    bool failed;
+};
+
+class Writer
+{
+public:
+    Writer(Output &out, const QVector<Column> &columns) : out(out), columns(columns) {}
+    virtual ~Writer() {}
+
+    virtual void begin() {}
+    virtual void row(const Row &values) = 0;
+    virtual void finish() {}
+
+protected:
+    Output &out;
+    const QVector<Column> &columns;
+};
+
+// ---- CSV ----
+
+class CsvWriter : public Writer
+{
+public:
+    using Writer::Writer;
+
+    void begin() override
+    {
+        out.append("\xEF\xBB\xBF", 3);
+        for (int c = 0; c < columns.size(); c++) {
+            if (c)
+                out.append(',');
+            out.append(columns[c].name, int(std::strlen(columns[c].name)));
+        }
+        out.append("\r\n", 2);
+    }
+
+    void row(const Row &values) override
+    {
+        for (int c = 0; c < columns.size(); c++) {
+            if (c)
+                out.append(',');
+            if (values[c].isNull())
+                continue;
+
+            const QVariant &value = values[c];
+            switch (columns[c].type) {
+            case ColumnType::Integer:
+                out.append(QByteArray::number(value.toLongLong()));
+                break;
+            case ColumnType::Real:
+                out.append(QByteArray::number(value.toDouble(), 'g', 15));
+                break;
+            default:
+                field(value.toString().toUtf8());
+                break;
+            }
+        }
+        out.append("\r\n", 2);
+    }
+
+private:
+    void field(const QByteArray &text)
+    {
+        bool quote = false;
+        for (char ch : text) {
+            if (ch == ',' || ch == '"' || ch == '\r' || ch == '\n') {
+                quote = true;
+                break;
+            }
+        }
+        if (!quote) {
+            out.append(text);
+            return;
+        }
+
+        out.append('"');
+        for (char ch : text) {
+            if (ch == '"')
+                out.append('"');
+            out.append(ch);
+        }
+        out.append('"');
+    }
+};
+
+// ---- JSON Lines ----
+
+class JsonLinesWriter : public Writer
+{
+public:
+    JsonLinesWriter(Output &out, const QVector<Column> &columns) : Writer(out, columns)
+    {
+        // "{"roll_no":", ","name":", ... precomputed once
+        for (int c = 0; c < columns.size(); c++)
+            keys << QByteArray(c ? ",\"" : "{\"") + columns[c].name + "\":";
+    }
+
+    void row(const Row &values) override
+    {
+        for (int c = 0; c < columns.size(); c++) {
+            out.append(keys[c]);
+            if (values[c].isNull()) {
+                out.append("null", 4);
+                continue;
+            }
+
+            const QVariant &value = values[c];
+            switch (columns[c].type) {
+            case ColumnType::Integer:
+                out.append(QByteArray::number(value.toLongLong()));
+                break;
+            case ColumnType::Real: {
+                double v = value.toDouble();
+                if (std::isfinite(v))
+                    out.append(QByteArray::number(v, 'g', 15));
+                else
+                    out.append("null", 4);
+                break;
+            }
+            default:
+                string(value.toString().toUtf8());
+                break;
+            }
+        }
+        out.append("}\n", 2);
+    }
+
+private:
+    QVector<QByteArray> keys;
+
+    void string(const QByteArray &text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out.append('"');
+        for (char ch : text) {
+            unsigned char u = static_cast<unsigned char>(ch);
+            if (ch == '"' || ch == '\\') {
+                out.append('\\');
+                out.append(ch);
+            } else if (u < 0x20) {
+                const char escaped[] = {'\\', 'u', '0', '0', hex[u >> 4], hex[u & 0xF]};
+                out.append(escaped, 6);
+            } else {
+                out.append(ch);
+            }
+        }
+        out.append('"');
+    }
+};
+
+// ---- Columnar ----
+
+template <class T>
+void appendLittleEndian(QByteArray &buffer, T value)
+{
+    T le = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char *>(&le), sizeof(le));
+}
+
+// Layout, all integers little-endian:
+//   "SRMSCOL1"
+//   row group*: per column, u32 chunk size then the chunk:
+//       validity bitmap, 1 bit per row (set = not null), LSB first
+//       Integer: i64 per row | Real: f64 per row |
+//       Text: u32 offsets, rows + 1 of them, then the UTF-8 bytes
+//   footer: u32 column count, per column u8 type (0 text, 1 integer,
+//       2 real), u32 name size, name; u32 row group count, per group u64
+//       file offset and u32 rows; u64 total rows
+//   u32 footer size, "SRMSCOL1"
+// A reader seeks to the end, reads the footer and can then load single
+// columns of single row groups.
+class ColumnarWriter : public Writer
+{
+public:
+    ColumnarWriter(Output &out, const QVector<Column> &columns)
+        : Writer(out, columns), chunks(columns.size()), groupRows(0), totalRows(0)
+    {
+        startGroup();
+    }
+
+    void begin() override
+    {
+        out.append(Magic, 8);
+    }
+
+    void row(const Row &values) override
+    {
+        for (int c = 0; c < columns.size(); c++) {
+            Chunk &chunk = chunks[c];
+            bool null = values[c].isNull();
+            if (groupRows % 8 == 0)
+                chunk.validity.append('\0');
+            if (!null)
+                chunk.validity.data()[groupRows / 8] |= char(1 << (groupRows % 8));
+
+            switch (columns[c].type) {
+            case ColumnType::Integer:
+                appendLittleEndian<qint64>(chunk.values, null ? 0 : values[c].toLongLong());
+                break;
+            case ColumnType::Real: {
+                double v = null ? 0.0 : values[c].toDouble();
+                quint64 bits;
+                std::memcpy(&bits, &v, sizeof(bits));
+                appendLittleEndian<quint64>(chunk.values, bits);
+                break;
+            }
+            default:
+                if (!null)
+                    chunk.text.append(values[c].toString().toUtf8());
+                appendLittleEndian<quint32>(chunk.values, quint32(chunk.text.size()));
+                break;
+            }
+        }
+
+        if (++groupRows == RowGroupRows)
+            writeGroup();
+    }
+
+    void finish() override
+    {
+        if (groupRows > 0)
+            writeGroup();
+
+        QByteArray footer;
+        appendLittleEndian<quint32>(footer, quint32(columns.size()));
+        for (const Column &column : columns) {
+            footer.append(char(column.type == ColumnType::Integer ? 1
+                               : column.type == ColumnType::Real ? 2 : 0));
+            appendLittleEndian<quint32>(footer, quint32(std::strlen(column.name)));
+            footer.append(column.name);
+        }
+        appendLittleEndian<quint32>(footer, quint32(groups.size()));
+        for (const Group &g : groups) {
+            appendLittleEndian<quint64>(footer, quint64(g.offset));
+            appendLittleEndian<quint32>(footer, g.rows);
+        }
+        appendLittleEndian<quint64>(footer, quint64(totalRows));
+
+        QByteArray tail;
+        appendLittleEndian<quint32>(tail, quint32(footer.size()));
+        tail.append(Magic, 8);
+
+        out.append(footer);
+        out.append(tail);
+    }
+
+private:
+    static constexpr const char *Magic = "SRMSCOL1";
+    static const int RowGroupRows = 65536;
+
+    struct Chunk
+    {
+        QByteArray validity;
+        QByteArray values;
+        QByteArray text;
+    };
+    struct Group
+    {
+        qint64  offset;
+        quint32 rows;
+    };
+
+    QVector<Chunk> chunks;
+    QVector<Group> groups;
+    int groupRows;
+    qint64 totalRows;
+
+    void startGroup()
+    {
+        for (int c = 0; c < columns.size(); c++) {
+            chunks[c].validity.clear();
+            chunks[c].values.clear();
+            chunks[c].text.clear();
+            if (columns[c].type == ColumnType::Text)
+                appendLittleEndian<quint32>(chunks[c].values, 0);
+        }
+        groupRows = 0;
+    }
+
+    void writeGroup()
+    {
+        groups.append({out.position(), quint32(groupRows)});
+        totalRows += groupRows;
+
+        for (const Chunk &chunk : chunks) {
+            QByteArray size;
+            appendLittleEndian<quint32>(size, quint32(chunk.validity.size() + chunk.values.size()
+                                                      + chunk.text.size()));
+            out.append(size);
+            out.append(chunk.validity);
+            out.append(chunk.values);
+            out.append(chunk.text);
+        }
+        startGroup();
+    }
+};
+
+} // namespace
+
+// =========================================
+// Exporter
+// =========================================
+
+DataExporter::DataExporter(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QStringList DataExporter::sources()
+{
+    QStringList names;
+    for (const Source &s : allSources())
+        names << s.name;
+    return names;
+}
+
+QString DataExporter::formatName(Format format)
+{
+    switch (format) {
+    case JsonLines: return "jsonl";
+    case Columnar:  return "columnar";
+    default:        return "csv";
+    }
+}
+
+bool DataExporter::formatFromName(const QString &name, Format &format)
+{
+    QString key = name.trimmed().toLower();
+    if (key == "csv")
+        format = Csv;
+    else if (key == "jsonl" || key == "json")
+        format = JsonLines;
+    else if (key == "columnar" || key == "col")
+        format = Columnar;
+    else
+        return false;
+    return true;
+}
+
+QString DataExporter::suffix(Format format)
+{
+    switch (format) {
+    case JsonLines: return "jsonl";
+    case Columnar:  return "col";
+    default:        return "csv";
+    }
+}
+
+void DataExporter::setProgress(Progress callback)
+{
+    progress = callback;
+}
+
+bool DataExporter::run(const QString &source, Format format, const QString &fileName,
+                       const QueryCancelToken &token)
+{
+    result = DataExportStats();
+    result.source = source;
+    result.format = formatName(format);
+    result.fileName = fileName;
+    error.clear();
+
+    QElapsedTimer total;
+    total.start();
+
+    const Source *found = nullptr;
+    for (const Source &s : allSources()) {
+        if (source == s.name)
+            found = &s;
+    }
+    if (!found) {
+        error = "Unknown export source " + source + " (one of: " + sources().join(", ") + ")";
+        return false;
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        error = "Could not write " + fileName + ": " + file.errorString();
+        return false;
+    }
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    QueryTrace trace(q);
+    if (found->sql && !trace.exec(found->sql)) {
+        error = q.lastError().text();
+        file.cancelWriting();
+        return false;
+    }
+
+    Output out(file);
+    std::unique_ptr<Writer> writer;
+    switch (format) {
+    case JsonLines:
+        writer.reset(new JsonLinesWriter(out, found->columns));
+        break;
+    case Columnar:
+        writer.reset(new ColumnarWriter(out, found->columns));
+        break;
+    default:
+        writer.reset(new CsvWriter(out, found->columns));
+        break;
+    }
+
+    QElapsedTimer sinceReport;
+    sinceReport.start();
+
+    // false stops the source; error says whether that was a failure
+    auto sink = [&](const Row &row) {
+        writer->row(row);
+        result.rows++;
+
+        if (result.rows % 4096 != 0)
+            return true;
+        if (!out.ok())
+            return false;
+        if (token.isCancelled()) {
+            error = "Cancelled";
+            return false;
+        }
+        if (progress && sinceReport.elapsed() >= 100) {
+            progress(result.rows);
+            sinceReport.restart();
+        }
+        return true;
+    };
+
+    writer->begin();
+    if (found->sql) {
+        Row row(found->columns.size());
+        while (trace.next()) {
+            for (int c = 0; c < row.size(); c++)
+                row[c] = q.value(c);
+            if (!sink(row))
+                break;
+        }
+        if (error.isEmpty() && q.lastError().isValid())
+            error = q.lastError().text();
+    } else {
+        QString failure;
+        if (!found->generate(db, sink, failure) && error.isEmpty())
+            error = failure;
+    }
+    if (!error.isEmpty()) {
+        file.cancelWriting();
+        return false;
+    }
+    writer->finish();
+
+    result.bytes = out.position();
+    if (!out.flush() || !file.commit()) {
+        error = "Could not write " + fileName + ": " + file.errorString();
+        return false;
+    }
+
+    if (progress)
+        progress(result.rows);
+    result.totalMs = total.elapsed();
+    return true;
+}
+
+DataExportStats DataExporter::stats() const
+{
+    return result;
+}
+
+QString DataExporter::lastError() const
+{
+    return error;
+}
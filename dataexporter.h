@@ -0,0 +1,82 @@
+#ifndef DATAEXPORTER_H
+#define DATAEXPORTER_H
+
+#include "querycanceltoken.h"
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QMetaType>
+
+#include <functional>
+
+struct DataExportStats
+{
+    QString source;
+    QString format;
+    QString fileName;
+    qint64  rows = 0;
+    qint64  bytes = 0;
+    qint64  totalMs = 0;
+
+    double rowsPerSecond() const;
+    QString summary() const;
+};
+
+Q_DECLARE_METATYPE(DataExportStats)
+
+// Streams a table or a report view to a file. Rows come from a forward-only
+// query and go through a 1 MiB buffer straight to disk, so memory does not
+// grow with the table; the columnar format additionally holds one row group.
+// Output is written to a temporary file that replaces the target only when
+// the export completes (QSaveFile).
+//
+// Sources: the tables students and marks, and the reports
+//   attendance          one row per student per session: roll_no, subject,
+//                       date, period, status, expanded from the bitmaps
+//   results             one row per mark with the student's details and CGPA
+//   attendance_summary  one row per student: sessions, present, present_pct
+//
+// Formats:
+//   csv        RFC 4180, UTF-8 with BOM, CRLF: opens directly in Excel and
+//              reads back with CsvImporter
+//   jsonl      one JSON object per line
+//   columnar   row groups of 64k rows stored column by column, with a footer
+//              holding the schema and the row group offsets (Parquet's layout,
+//              without its encodings); see writeColumnar in the .cpp
+class DataExporter
+{
+public:
+    enum Format {
+        Csv,
+        JsonLines,
+        Columnar
+    };
+
+    // Called from the exporting thread, at most every 100 ms
+    using Progress = std::function<void(qint64 rows)>;
+
+    explicit DataExporter(const QSqlDatabase &database);
+
+    static QStringList sources();
+    static QString formatName(Format format);
+    static bool formatFromName(const QString &name, Format &format);
+    static QString suffix(Format format);
+
+    void setProgress(Progress callback);
+
+    // The target file is left untouched on failure or cancellation
+    bool run(const QString &source, Format format, const QString &fileName,
+             const QueryCancelToken &token = QueryCancelToken());
+
+    DataExportStats stats() const;
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+    DataExportStats result;
+    Progress progress;
+};
+
+#endif // DATAEXPORTER_H
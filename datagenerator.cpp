@@ -0,0 +1,286 @@
+#include "datagenerator.h"
+#include "userrepository.h"
+#include "marksrepository.h"
+#include "attendancerepository.h"
+#include "marksnapshot.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
+#include "attendancebitmap.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QVariantList>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// SQLite's default SQLITE_MAX_VARIABLE_NUMBER before 3.32
+static const int MaxBindValues = 999;
+
+namespace {
+
+// splitmix64: tiny, fast and identical everywhere
+class Random
+{
+public:
+    explicit Random(quint64 seed) : state(seed) {}
+
+    quint64 next()
+    {
+        quint64 z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    int below(int bound) { return int(next() % quint64(bound)); }
+
+private:
+    quint64 state;
+};
+
+const char *const FirstNames[] = {
+    "Aarav", "Aditi", "Akash", "Ananya", "Arjun", "Bhavana", "Deepak", "Divya",
+    "Ganesh", "Harini", "Ishaan", "Kavya", "Koushik", "Lakshmi", "Manoj", "Meera",
+    "Nikhil", "Pooja", "Rahul", "Sanjana", "Suresh", "Tanvi", "Varun", "Yamini"
+};
+
+const char *const LastNames[] = {
+    "Challa", "Reddy", "Sharma", "Iyer", "Naidu", "Patel", "Rao", "Gupta",
+    "Menon", "Kumar", "Varma", "Pillai", "Das", "Joshi", "Nair", "Bose"
+};
+
+} // namespace
+
+DataGenerator::DataGenerator(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QString DataGenerator::rollNo(int index)
+{
+    return QString("AP%1").arg(index + 1, 8, 10, QChar('0'));
+}
+
+QString DataGenerator::username(int index)
+{
+    return QString("s%1").arg(index + 1);
+}
+
+QString DataGenerator::password()
+{
+    return "student123";
+}
+
+QStringList DataGenerator::subjects()
+{
+    return {"Data Structures", "DBMS", "Operating Systems", "Computer Networks",
+            "Discrete Mathematics", "Software Engineering"};
+}
+
+QStringList DataGenerator::examTypes()
+{
+    return {"Mid-Term", "End-Term", "Assignment", "Quiz", "Project"};
+}
+
+QStringList DataGenerator::branches()
+{
+    return {"CSE", "ECE", "EEE", "MECH", "CIVIL"};
+}
+
+// Writes the buffered rows of one table as multi-row INSERTs of full
+// size, keeping the remainder for later; last also writes the remainder
+bool DataGenerator::insertRows(const QString &table, const QString &columns, int width,
+                               QVariantList &values, bool last)
+{
+    const int rowsPerStatement = MaxBindValues / width;
+    const QString tuple = "(" + QString("?, ").repeated(width - 1) + "?)";
+
+    int offset = 0;
+    for (;;) {
+        int rows = qMin(rowsPerStatement, (values.size() - offset) / width);
+        if (rows == 0 || (rows < rowsPerStatement && !last))
+            break;
+
+        QString sql = "INSERT INTO " + table + " (" + columns + ") VALUES ";
+        for (int r = 0; r < rows; r++)
+            sql += (r ? ", " : "") + tuple;
+
+        QSqlQuery partial(db);
+        QSqlQuery *q = &partial;
+        if (rows == rowsPerStatement)
+            q = &StatementCache::forDatabase(db).prepared(sql);
+        else if (!partial.prepare(sql)) {
+            error = partial.lastError().text();
+            return false;
+        }
+
+        for (int i = 0; i < rows * width; i++)
+            q->bindValue(i, values[offset + i]);
+        if (!QueryTrace(*q).exec()) {
+            error = table + ": " + q->lastError().text();
+            return false;
+        }
+        offset += rows * width;
+    }
+
+    values.erase(values.begin(), values.begin() + offset);
+    return true;
+}
+
+bool DataGenerator::generate(const Config &config)
+{
+    result = Stats();
+    error.clear();
+
+    QElapsedTimer total;
+    total.start();
+
+    if (!db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+    auto fail = [&]() {
+        db.rollback();
+        return false;
+    };
+
+    qint64 lastMarkId = 0;
+    {
+        QSqlQuery q(db);
+        QueryTrace trace(q);
+        if (!trace.exec("SELECT COALESCE(MAX(mark_id), 0) FROM marks") || !trace.next()) {
+            error = q.lastError().text();
+            return fail();
+        }
+        lastMarkId = q.value(0).toLongLong();
+    }
+
+    const QStringList subjectList = subjects();
+    const QStringList examList = examTypes();
+    const QStringList branchList = branches();
+    const int firstNames = int(sizeof(FirstNames) / sizeof(FirstNames[0]));
+    const int lastNames = int(sizeof(LastNames) / sizeof(LastNames[0]));
+
+    // Every generated student shares one password
+    const QString passwordHash = UserRepository::hashPassword(password());
+
+    Random random(config.seed);
+    QVariantList students, users, marks;
+    QVector<int> presentPercents;
+    presentPercents.reserve(config.students);
+
+    for (int i = 0; i < config.students; i++) {
+        QString roll = rollNo(i);
+        QString name = QString("%1 %2").arg(FirstNames[random.below(firstNames)],
+                                            LastNames[random.below(lastNames)]);
+        QString email = username(i) + "@example.edu";
+
+        students << roll << name << email << branchList[random.below(branchList.size())]
+                 << 1 + random.below(4) << (random.below(2) ? "Female" : "Male");
+        users << roll << username(i) << passwordHash << "STUDENT" << email;
+        result.students++;
+
+        // Marks scatter +-15 around the student's ability
+        int ability = 45 + random.below(45);
+        for (int k = 0; k < config.marksPerStudent; k++) {
+            int score = qBound(0, ability + random.below(31) - 15, 100);
+            marks << roll << subjectList[k % subjectList.size()] << score << 100
+                  << examList[(k / subjectList.size()) % examList.size()];
+            result.marks++;
+        }
+
+        // Better students attend more: 60-95% of sessions
+        presentPercents << 60 + (ability - 45) * 35 / 45;
+
+        if (!insertRows("students", "roll_no, name, email, branch, year, gender", 6, students, false)
+            || !insertRows("users", "user_id, username, password, role, email", 5, users, false)
+            || !insertRows("marks", "roll_no, subject, marks, max_marks, exam_type", 5, marks, false))
+            return fail();
+    }
+
+    if (!insertRows("students", "roll_no, name, email, branch, year, gender", 6, students, true)
+        || !insertRows("users", "user_id, username, password, role, email", 5, users, true)
+        || !insertRows("marks", "roll_no, subject, marks, max_marks, exam_type", 5, marks, true))
+        return fail();
+
+    MarksRepository repository(db);
+    if (!repository.addTotalsSince(lastMarkId)) {
+        error = repository.lastError();
+        return fail();
+    }
+
+    // The insert trigger gave every new student an ordinal
+    AttendanceRepository attendance(db);
+    attendance.setTotalsDeferred(true);
+    QVector<int> ordinals(config.students);
+    {
+        const QHash<QString, int> known = attendance.ordinals();
+        if (!attendance.lastError().isEmpty()) {
+            error = attendance.lastError();
+            return fail();
+        }
+        for (int i = 0; i < config.students; i++)
+            ordinals[i] = known.value(rollNo(i), -1);
+    }
+
+    AttendanceBitmap roster;
+    for (int i = 0; i < config.students; i++) {
+        if (ordinals[i] >= 0)
+            roster.set(ordinals[i]);
+    }
+
+    // One session a day per subject, period 1, every generated student
+    // on the roll
+    for (int d = 0; d < config.attendanceDays && !roster.isEmpty(); d++) {
+        QDate date = config.firstDay.addDays(d);
+        for (const QString &subject : subjectList) {
+            AttendanceBitmap present;
+            for (int i = 0; i < config.students; i++) {
+                if (ordinals[i] >= 0 && random.below(100) < presentPercents[i])
+                    present.set(ordinals[i]);
+            }
+            if (!attendance.save(subject, date, 1, roster, present)) {
+                error = attendance.lastError();
+                return fail();
+            }
+            result.sessions++;
+            result.attendance += roster.count();
+        }
+    }
+    if (!attendance.rebuildTotals()) {
+        error = attendance.lastError();
+        return fail();
+    }
+
+    if (!db.commit()) {
+        error = db.lastError().text();
+        return fail();
+    }
+    MarksSnapshot::invalidate(db);
+    CohortRanking::invalidateAll(db);
+    StudentProfileRepository::invalidateAll(db);
+
+    result.totalMs = total.elapsed();
+    qInfo().noquote() << QString("Generated %1 students, %2 marks, %3 attendance sessions"
+                                 " (%4 statuses) in %5 ms")
+                             .arg(result.students)
+                             .arg(result.marks)
+                             .arg(result.sessions)
+                             .arg(result.attendance)
+                             .arg(result.totalMs);
+    return true;
+}
+
+DataGenerator::Stats DataGenerator::stats() const
+{
+    return result;
+}
+
+QString DataGenerator::lastError() const
+{
+    return error;
+}
@@ -0,0 +1,65 @@
+#ifndef DATAGENERATOR_H
+#define DATAGENERATOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QDate>
+
+// Fills a database with synthetic students, accounts, marks and attendance
+// for benchmarks and load tests. The same config always produces the same
+// rows, on every platform: values come from a fixed 64-bit generator, not
+// from <random> distributions, whose output is implementation-defined.
+//
+// Students get roll_no AP00000001, AP00000002, ... and logins s1, s2, ...
+// with password student123. Marks cycle through subjects() x examTypes()
+// around a per-student ability.
+// Attendance holds one session a day per subject for attendanceDays days
+// from firstDay, with every generated student on the roll.
+class DataGenerator
+{
+public:
+    struct Config
+    {
+        int     students = 1000;
+        int     marksPerStudent = 10;
+        int     attendanceDays = 30;
+        QDate   firstDay = QDate(2025, 7, 1);
+        quint64 seed = 42;
+    };
+
+    struct Stats
+    {
+        qint64 students = 0;
+        qint64 marks = 0;
+        qint64 sessions = 0;
+        qint64 attendance = 0;      // student statuses over all sessions
+        qint64 totalMs = 0;
+    };
+
+    explicit DataGenerator(const QSqlDatabase &database);
+
+    // Appends to whatever the database holds; use an empty database
+    bool generate(const Config &config);
+
+    static QString rollNo(int index);
+    static QString username(int index);
+    static QString password();
+    static QStringList subjects();
+    static QStringList examTypes();
+    static QStringList branches();
+
+    Stats stats() const;
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+    Stats result;
+
+    bool insertRows(const QString &table, const QString &columns, int width,
+                    QVariantList &values, bool last);
+};
+
+#endif // DATAGENERATOR_H
@@ -0,0 +1,98 @@
+#include "diagnosticsdialog.h"
+#include "querystats.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QHeaderView>
+#include <QAbstractItemView>
+
+DiagnosticsDialog::DiagnosticsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Query Diagnostics");
+    resize(1000, 600);
+    setupUI();
+    refresh();
+}
+
+void DiagnosticsDialog::setupUI() {
+    QVBoxLayout *mainLayout = new QVBoxLayout(this);
+
+    summaryLabel = new QLabel;
+    summaryLabel->setStyleSheet("color: gray;");
+    mainLayout->addWidget(summaryLabel);
+
+    statsTable = new QTableWidget;
+    statsTable->setColumnCount(10);
+    statsTable->setHorizontalHeaderLabels({"Query", "Calls", "p50 ms", "p90 ms", "p99 ms",
+                                           "Max ms", "Rows/call", "Binds/call", "Slow", "Total ms"});
+    statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    statsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    statsTable->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
+    statsTable->verticalHeader()->hide();
+    statsTable->setWordWrap(false);
+    mainLayout->addWidget(statsTable);
+
+    QHBoxLayout *buttons = new QHBoxLayout;
+    QPushButton *refreshBtn = new QPushButton("Refresh");
+    QPushButton *resetBtn = new QPushButton("Reset");
+    QPushButton *closeBtn = new QPushButton("Close");
+    buttons->addWidget(refreshBtn);
+    buttons->addWidget(resetBtn);
+    buttons->addStretch();
+    buttons->addWidget(closeBtn);
+    mainLayout->addLayout(buttons);
+
+    connect(refreshBtn, &QPushButton::clicked, this, &DiagnosticsDialog::refresh);
+    connect(resetBtn, &QPushButton::clicked, this, &DiagnosticsDialog::resetStats);
+    connect(closeBtn, &QPushButton::clicked, this, &QDialog::accept);
+}
+
+void DiagnosticsDialog::refresh() {
+    const QVector<QueryStats::Summary> summaries = QueryStats::snapshot();
+
+    auto number = [](double value, int decimals) {
+        QTableWidgetItem *item = new QTableWidgetItem(QString::number(value, 'f', decimals));
+        item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        return item;
+    };
+
+    statsTable->setSortingEnabled(false);
+    statsTable->setRowCount(summaries.size());
+    quint64 calls = 0;
+    for (int row = 0; row < summaries.size(); row++) {
+        const QueryStats::Summary &s = summaries[row];
+        double perCall = s.calls ? 1.0 / s.calls : 0.0;
+        calls += s.calls;
+
+        QTableWidgetItem *query = new QTableWidgetItem(s.fingerprint);
+        query->setToolTip(s.fingerprint);
+        statsTable->setItem(row, 0, query);
+        statsTable->setItem(row, 1, number(s.calls, 0));
+        statsTable->setItem(row, 2, number(s.p50Ms, 3));
+        statsTable->setItem(row, 3, number(s.p90Ms, 3));
+        statsTable->setItem(row, 4, number(s.p99Ms, 3));
+        statsTable->setItem(row, 5, number(s.maxMs, 3));
+        statsTable->setItem(row, 6, number(s.rows * perCall, 1));
+        statsTable->setItem(row, 7, number(s.binds * perCall, 1));
+        statsTable->setItem(row, 8, number(s.slow, 0));
+        statsTable->setItem(row, 9, number(s.totalMs, 1));
+    }
+
+    double threshold = QueryStats::slowQueryThresholdMs();
+    QString slowLog = threshold < 0
+                          ? QString("Slow-query log off")
+                          : QString("Slow queries: %1 ms and over, logged to %2")
+                                .arg(threshold)
+                                .arg(QueryStats::slowQueryLog().isEmpty() ? "the console"
+                                                                          : QueryStats::slowQueryLog());
+    summaryLabel->setText(QString("%1 distinct queries, %2 calls. %3")
+                              .arg(summaries.size())
+                              .arg(calls)
+                              .arg(slowLog));
+}
+
+void DiagnosticsDialog::resetStats() {
+    QueryStats::reset();
+    refresh();
+}
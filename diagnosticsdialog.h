@@ -0,0 +1,27 @@
+#ifndef DIAGNOSTICSDIALOG_H
+#define DIAGNOSTICSDIALOG_H
+
+#include <QDialog>
+#include <QTableWidget>
+#include <QLabel>
+
+// Per-query latency percentiles collected by QueryStats since startup or
+// the last reset, most total time first
+class DiagnosticsDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    explicit DiagnosticsDialog(QWidget *parent = nullptr);
+
+private slots:
+    void refresh();
+    void resetStats();
+
+private:
+    QTableWidget *statsTable;
+    QLabel *summaryLabel;
+
+    void setupUI();
+};
+
+#endif // DIAGNOSTICSDIALOG_H
@@ -0,0 +1,188 @@
+#ifndef GRADINGKERNELS_H
+#define GRADINGKERNELS_H
+
+#include "gradingpolicy.h"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <utility>
+
+// Exam types and subjects dictionary-encoded to small ids, with the
+// policy's weight and credits for each id in dense arrays. Encoding happens
+// once where a row is read; the kernels below only index arrays.
+class GradingTables
+{
+public:
+    explicit GradingTables(const GradingPolicy &policy) : gradingPolicy(policy) {}
+
+    int examId(const QString &examType)
+    {
+        auto it = examIds.constFind(examType);
+        if (it != examIds.cend())
+            return it.value();
+        examNames.append(examType);
+        examWeights.append(gradingPolicy.examWeight(examType));
+        return examIds.insert(examType, examNames.size() - 1).value();
+    }
+
+    int subjectId(const QString &subject)
+    {
+        auto it = subjectIds.constFind(subject);
+        if (it != subjectIds.cend())
+            return it.value();
+        subjectNames.append(subject);
+        subjectCredits.append(gradingPolicy.credits(subject));
+        return subjectIds.insert(subject, subjectNames.size() - 1).value();
+    }
+
+    bool hasExam(const QString &examType) const { return examIds.contains(examType); }
+    bool hasSubject(const QString &subject) const { return subjectIds.contains(subject); }
+
+    double examWeight(int exam) const { return examWeights[exam]; }
+    double credits(int subject) const { return subjectCredits[subject]; }
+    double gradePoint(double percentage) const { return gradingPolicy.gradePoint(percentage); }
+
+    const QString &examName(int exam) const { return examNames[exam]; }
+    const QString &subjectName(int subject) const { return subjectNames[subject]; }
+
+    const GradingPolicy &policy() const { return gradingPolicy; }
+
+private:
+    GradingPolicy gradingPolicy;
+    QHash<QString, int> examIds;
+    QHash<QString, int> subjectIds;
+    QVector<QString> examNames;
+    QVector<QString> subjectNames;
+    QVector<double> examWeights;
+    QVector<double> subjectCredits;
+};
+
+namespace Grading {
+
+// Mark-level policies: every mark counts, weighted by its exam type
+struct Average
+{
+    static double markWeight(const GradingTables &, int) { return 1.0; }
+};
+
+struct ExamWeighted
+{
+    static double markWeight(const GradingTables &tables, int exam) { return tables.examWeight(exam); }
+};
+
+// Subject-level policies: the mean percentage of each subject becomes
+// points, weighted by the subject's credits
+struct CreditWeighted
+{
+    static double points(const GradingTables &, double percentage) { return percentage / 10.0; }
+};
+
+struct Banded
+{
+    static double points(const GradingTables &tables, double percentage) { return tables.gradePoint(percentage); }
+};
+
+// Kernels take one student's marks as (subject, exam) groups: a sum of
+// percentages and the number of marks in it. finish() returns the CGPA and
+// starts the next student. Groups of one subject must arrive together, as
+// they do in (roll_no, subject, exam_type) order.
+template <class Policy>
+class MarkKernel
+{
+public:
+    explicit MarkKernel(const GradingTables &tables) : tables(tables) {}
+
+    void add(int, int exam, double sumPct, int n)
+    {
+        double w = Policy::markWeight(tables, exam);
+        weighted += w * sumPct;
+        weight += w * n;
+    }
+
+    double finish()
+    {
+        double cgpa = weight > 0 ? weighted / weight / 10.0 : 0.0;
+        weighted = weight = 0.0;
+        return cgpa;
+    }
+
+private:
+    const GradingTables &tables;
+    double weighted = 0.0;
+    double weight = 0.0;
+};
+
+template <class Policy>
+class SubjectKernel
+{
+public:
+    explicit SubjectKernel(const GradingTables &tables) : tables(tables) {}
+
+    void add(int subject, int, double sumPct, int n)
+    {
+        if (subject != current)
+            closeSubject();
+        current = subject;
+        subjectSum += sumPct;
+        subjectCount += n;
+    }
+
+    double finish()
+    {
+        closeSubject();
+        double cgpa = credits > 0 ? points / credits : 0.0;
+        points = credits = 0.0;
+        return cgpa;
+    }
+
+private:
+    const GradingTables &tables;
+    int current = -1;
+    double subjectSum = 0.0;
+    int subjectCount = 0;
+    double points = 0.0;
+    double credits = 0.0;
+
+    void closeSubject()
+    {
+        if (current >= 0 && subjectCount > 0) {
+            double c = tables.credits(current);
+            points += c * Policy::points(tables, subjectSum / subjectCount);
+            credits += c;
+        }
+        current = -1;
+        subjectSum = 0.0;
+        subjectCount = 0;
+    }
+};
+
+// Picks the kernel for the policy once and runs body(kernel) with it, so
+// everything inside body is compiled per policy
+template <class Body>
+auto withKernel(const GradingTables &tables, Body body) -> decltype(body(std::declval<MarkKernel<Average> &>()))
+{
+    switch (tables.policy().kind) {
+    case GradingPolicy::ExamWeighted: {
+        MarkKernel<ExamWeighted> kernel(tables);
+        return body(kernel);
+    }
+    case GradingPolicy::CreditWeighted: {
+        SubjectKernel<CreditWeighted> kernel(tables);
+        return body(kernel);
+    }
+    case GradingPolicy::Banded: {
+        SubjectKernel<Banded> kernel(tables);
+        return body(kernel);
+    }
+    default: {
+        MarkKernel<Average> kernel(tables);
+        return body(kernel);
+    }
+    }
+}
+
+} // namespace Grading
+
+#endif // GRADINGKERNELS_H
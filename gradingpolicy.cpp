@@ -0,0 +1,181 @@
+#include "gradingpolicy.h"
+
+#include <QSettings>
+#include <QFileInfo>
+#include <QVariant>
+#include <QReadWriteLock>
+#include <QDebug>
+
+#include <algorithm>
+
+// =========================================
+// Presets
+// =========================================
+
+GradingPolicy GradingPolicy::fromName(const QString &name, bool *ok)
+{
+    QString key = name.trimmed().toLower();
+    if (ok)
+        *ok = true;
+
+    GradingPolicy policy;
+    if (key == "average") {
+        policy.kind = Average;
+    } else if (key == "exam_weighted") {
+        // The exam types offered by the marks dialog
+        policy.kind = ExamWeighted;
+        policy.examWeights = {{"Mid-Term", 0.3}, {"End-Term", 0.5}, {"Assignment", 0.1},
+                              {"Quiz", 0.05}, {"Project", 0.05}};
+    } else if (key == "credit_weighted") {
+        policy.kind = CreditWeighted;
+    } else if (key == "banded") {
+        policy.kind = Banded;
+        policy.bands = {{90, 10}, {80, 9}, {70, 8}, {60, 7}, {50, 6},
+                        {45, 5}, {40, 4}, {0, 0}};
+    } else if (ok) {
+        *ok = false;
+    }
+    return policy;
+}
+
+QString GradingPolicy::name() const
+{
+    switch (kind) {
+    case ExamWeighted:   return "exam_weighted";
+    case CreditWeighted: return "credit_weighted";
+    case Banded:         return "banded";
+    default:             return "average";
+    }
+}
+
+QString GradingPolicy::describe() const
+{
+    QString text = name();
+    if (kind == ExamWeighted)
+        text += QString(" (%1 exam weights, default %2)").arg(examWeights.size()).arg(defaultExamWeight);
+    if (kind == CreditWeighted || kind == Banded)
+        text += QString(" (%1 subject credits, default %2)").arg(subjectCredits.size()).arg(defaultCredits);
+    if (kind == Banded)
+        text += QString(" (%1 bands)").arg(bands.size());
+    return text;
+}
+
+// =========================================
+// Lookups
+// =========================================
+
+double GradingPolicy::examWeight(const QString &examType) const
+{
+    return examWeights.value(examType, defaultExamWeight);
+}
+
+double GradingPolicy::credits(const QString &subject) const
+{
+    return subjectCredits.value(subject, defaultCredits);
+}
+
+double GradingPolicy::gradePoint(double percentage) const
+{
+    for (const Band &band : bands) {
+        if (percentage >= band.minPercentage)
+            return band.gradePoint;
+    }
+    return 0.0;
+}
+
+// =========================================
+// Loading
+// =========================================
+
+// "Name:value, Name:value" (QSettings may already have split it at commas)
+static QHash<QString, double> parsePairs(const QVariant &value)
+{
+    QHash<QString, double> pairs;
+    for (const QString &item : value.toStringList().join(',').split(',')) {
+        if (item.trimmed().isEmpty())
+            continue;
+        int colon = item.lastIndexOf(':');
+        bool ok = false;
+        double number = colon > 0 ? item.mid(colon + 1).trimmed().toDouble(&ok) : 0.0;
+        if (ok)
+            pairs.insert(item.left(colon).trimmed(), number);
+        else
+            qWarning() << "Ignoring grading entry" << item.trimmed();
+    }
+    return pairs;
+}
+
+GradingPolicy GradingPolicy::load(const QStringList &arguments, const QString &configFile)
+{
+    QString name;
+    bool fromCommandLine = false;
+
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &arg = arguments[i];
+        if (arg.startsWith("--grading-policy=")) {
+            name = arg.mid(QString("--grading-policy=").size());
+            fromCommandLine = true;
+        } else if (arg == "--grading-policy" && i + 1 < arguments.size()) {
+            name = arguments[++i];
+            fromCommandLine = true;
+        }
+    }
+
+    bool hasConfig = QFileInfo::exists(configFile);
+    QSettings settings(configFile, QSettings::IniFormat);
+    settings.beginGroup("grading");
+
+    if (name.isEmpty() && hasConfig)
+        name = settings.value("policy").toString();
+
+    bool ok = true;
+    GradingPolicy policy = name.isEmpty() ? GradingPolicy() : fromName(name, &ok);
+    if (!ok)
+        qWarning() << "Unknown grading policy" << name << "- using" << policy.name();
+
+    // Tables from the config file replace the preset ones
+    if (hasConfig) {
+        if (settings.contains("exam_weights"))
+            policy.examWeights = parsePairs(settings.value("exam_weights"));
+        if (settings.contains("credits"))
+            policy.subjectCredits = parsePairs(settings.value("credits"));
+        policy.defaultExamWeight = settings.value("default_exam_weight", policy.defaultExamWeight).toDouble();
+        policy.defaultCredits = settings.value("default_credits", policy.defaultCredits).toDouble();
+
+        if (settings.contains("bands")) {
+            QHash<QString, double> pairs = parsePairs(settings.value("bands"));
+            policy.bands.clear();
+            for (auto it = pairs.cbegin(); it != pairs.cend(); ++it)
+                policy.bands.append({it.key().toDouble(), it.value()});
+        }
+    }
+    settings.endGroup();
+
+    std::sort(policy.bands.begin(), policy.bands.end(), [](const Band &a, const Band &b) {
+        return a.minPercentage > b.minPercentage;
+    });
+
+    qInfo().noquote() << "Grading policy:" << policy.describe()
+                      << (fromCommandLine ? "(command line)"
+                                          : hasConfig ? "(" + configFile + ")" : "(default)");
+    return policy;
+}
+
+// =========================================
+// Active policy
+// =========================================
+
+static QReadWriteLock activeLock;
+static GradingPolicy activePolicy;
+
+void GradingPolicy::setActive(const GradingPolicy &policy)
+{
+    QWriteLocker locker(&activeLock);
+    activePolicy = policy;
+}
+
+GradingPolicy GradingPolicy::active()
+{
+    QReadLocker locker(&activeLock);
+    return activePolicy;
+}
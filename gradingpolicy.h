@@ -0,0 +1,58 @@
+#ifndef GRADINGPOLICY_H
+#define GRADINGPOLICY_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// How marks turn into a CGPA on the 10-point scale. Four policies:
+//
+//   average          mean of all mark percentages / 10 (the original rule)
+//   exam_weighted    the same mean, each mark weighted by its exam type
+//   credit_weighted  mean percentage per subject / 10, weighted by credits
+//   banded           mean percentage per subject mapped to grade points
+//                    through bands, weighted by credits
+//
+// The policy comes from --grading-policy on the command line, else from
+// [grading] in srms.ini, which also holds weights, credits and bands.
+// The arithmetic lives in gradingkernels.h.
+struct GradingPolicy
+{
+    enum Kind {
+        Average,
+        ExamWeighted,
+        CreditWeighted,
+        Banded
+    };
+
+    struct Band {
+        double minPercentage;
+        double gradePoint;
+    };
+
+    Kind                    kind = Average;
+    QHash<QString, double>  examWeights;            // by exam_type
+    double                  defaultExamWeight = 1.0;
+    QHash<QString, double>  subjectCredits;         // by subject
+    double                  defaultCredits = 1.0;
+    QVector<Band>           bands;                  // highest minPercentage first
+
+    QString name() const;
+    QString describe() const;
+
+    double examWeight(const QString &examType) const;
+    double credits(const QString &subject) const;
+    double gradePoint(double percentage) const;
+
+    static GradingPolicy fromName(const QString &name, bool *ok = nullptr);
+    static GradingPolicy load(const QStringList &arguments,
+                              const QString &configFile = "srms.ini");
+
+    // The policy used by MarksRepository and the bulk recompute; set once
+    // at startup, readable from any thread
+    static void setActive(const GradingPolicy &policy);
+    static GradingPolicy active();
+};
+
+#endif // GRADINGPOLICY_H
@@ -1,8 +1,18 @@
 #include <QApplication>
+#include <QCoreApplication>
 #include "srmswindow.h"
+#include "batchcommands.h"
 
 int main(int argc, char *argv[])
 {
+    // Headless paths must not create a QApplication: it needs a display
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--export") == 0 || qstrncmp(argv[i], "--export=", 9) == 0) {
+            QCoreApplication app(argc, argv);
+            return BatchCommands(app.arguments()).exportData();
+        }
+    }
+
     QApplication a(argc, argv);
 
     SRMSWindow w;
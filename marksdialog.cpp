@@ -1,4 +1,7 @@
 #include "marksdialog.h"
+#include "marksrepository.h"
+#include "studentrepository.h"
+#include "cohortranking.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QFormLayout>
@@ -6,9 +9,8 @@
 #include <QLabel>
 #include <QHeaderView>
 #include <QMessageBox>
-#include <QSqlQuery>
-#include <QSqlError>
 #include <QAbstractItemView>
+#include <QDebug>
 
 MarksDialog::MarksDialog(QSqlDatabase &database, QWidget *parent)
     : QDialog(parent), db(database)
@@ -78,9 +80,9 @@ void MarksDialog::setupUI() {
     mainLayout->addWidget(addBox);
     
     // Marks table
-    marksTable = new QTableWidget(0, 6);
+    marksTable = new QTableWidget(0, 8);
     marksTable->setHorizontalHeaderLabels({
-        "ID", "Subject", "Marks", "Max Marks", "Percentage", "Exam Type"
+        "ID", "Subject", "Marks", "Max Marks", "Percentage", "Exam Type", "Class Rank", "Percentile"
     });
     marksTable->horizontalHeader()->setStretchLastSection(true);
     marksTable->setSelectionBehavior(QAbstractItemView::SelectRows);
@@ -95,7 +97,7 @@ void MarksDialog::setupUI() {
     deleteBtn->setStyleSheet("background-color: #e74c3c; color: white; padding: 8px;");
     actionLayout->addWidget(deleteBtn);
     
-    calculateBtn = new QPushButton("🧮 Calculate CGPA");
+    calculateBtn = new QPushButton("🧮 Show CGPA");
     calculateBtn->setStyleSheet("background-color: #f39c12; color: white; padding: 8px;");
     actionLayout->addWidget(calculateBtn);
     
@@ -117,13 +119,8 @@ void MarksDialog::setupUI() {
 void MarksDialog::loadStudentList() {
     studentCombo->clear();
     
-    QSqlQuery query(db);
-    query.exec("SELECT roll_no, name FROM students ORDER BY roll_no");
-    
-    while (query.next()) {
-        QString rollNo = query.value(0).toString();
-        QString name = query.value(1).toString();
-        studentCombo->addItem(rollNo + " - " + name, rollNo);
+    for (const StudentRecord &student : StudentRepository(db).byClass()) {
+        studentCombo->addItem(student.rollNo + " - " + student.name, student.rollNo);
     }
 }
 
@@ -136,30 +133,37 @@ void MarksDialog::loadStudentMarks() {
     QString rollNo = studentCombo->currentData().toString();
     marksTable->setRowCount(0);
     
-    QSqlQuery query(db);
-    query.prepare("SELECT mark_id, subject, marks, max_marks, exam_type FROM marks WHERE roll_no = ?");
-    query.addBindValue(rollNo);
-    
-    if (query.exec()) {
-        while (query.next()) {
-            int row = marksTable->rowCount();
-            marksTable->insertRow(row);
-            
-            int markId = query.value(0).toInt();
-            QString subject = query.value(1).toString();
-            int marks = query.value(2).toInt();
-            int maxMarks = query.value(3).toInt();
-            QString examType = query.value(4).toString();
-            
-            double percentage = (marks * 100.0) / maxMarks;
-            
-            marksTable->setItem(row, 0, new QTableWidgetItem(QString::number(markId)));
-            marksTable->setItem(row, 1, new QTableWidgetItem(subject));
-            marksTable->setItem(row, 2, new QTableWidgetItem(QString::number(marks)));
-            marksTable->setItem(row, 3, new QTableWidgetItem(QString::number(maxMarks)));
-            marksTable->setItem(row, 4, new QTableWidgetItem(QString::number(percentage, 'f', 1) + "%"));
-            marksTable->setItem(row, 5, new QTableWidgetItem(examType));
-        }
+    // Rank of the student's average per subject and exam type among all
+    // students with marks there
+    CohortRanking ranking(db);
+    QHash<CohortRanking::Key, CohortStanding> standings;
+    QHash<CohortRanking::Key, QString> distributions;
+    if (!ranking.forStudent(rollNo, standings))
+        qWarning() << "Class ranks unavailable:" << ranking.lastError();
+    
+    for (const MarkRecord &mark : MarksRepository(db).forStudent(rollNo)) {
+        int row = marksTable->rowCount();
+        marksTable->insertRow(row);
+        
+        marksTable->setItem(row, 0, new QTableWidgetItem(QString::number(mark.markId)));
+        marksTable->setItem(row, 1, new QTableWidgetItem(mark.subject));
+        marksTable->setItem(row, 2, new QTableWidgetItem(QString::number(mark.marks)));
+        marksTable->setItem(row, 3, new QTableWidgetItem(QString::number(mark.maxMarks)));
+        marksTable->setItem(row, 4, new QTableWidgetItem(QString::number(mark.percentage(), 'f', 1) + "%"));
+        marksTable->setItem(row, 5, new QTableWidgetItem(mark.examType));
+        
+        const CohortRanking::Key key(mark.subject, mark.examType);
+        const CohortStanding standing = standings.value(key);
+        if (standing.cohort > 0 && !distributions.contains(key))
+            distributions.insert(key, ranking.distribution(mark.subject, mark.examType));
+        
+        QTableWidgetItem *rankItem = new QTableWidgetItem(standing.rankText());
+        QTableWidgetItem *percentileItem = new QTableWidgetItem(
+            standing.cohort > 0 ? QString::number(standing.percentile, 'f', 1) : "-");
+        rankItem->setToolTip(distributions.value(key));
+        percentileItem->setToolTip(distributions.value(key));
+        marksTable->setItem(row, 6, rankItem);
+        marksTable->setItem(row, 7, percentileItem);
     }
     
     if (marksTable->rowCount() == 0) {
@@ -179,27 +183,22 @@ void MarksDialog::addMarks() {
         return;
     }
     
-    QString rollNo = studentCombo->currentData().toString();
-    int marks = marksSpin->value();
-    int maxMarks = maxMarksSpin->value();
-    QString examType = examTypeCombo->currentText();
-    
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO marks (roll_no, subject, marks, max_marks, exam_type) "
-                  "VALUES (?, ?, ?, ?, ?)");
-    query.addBindValue(rollNo);
-    query.addBindValue(subject);
-    query.addBindValue(marks);
-    query.addBindValue(maxMarks);
-    query.addBindValue(examType);
-    
-    if (query.exec()) {
+    MarkRecord mark;
+    mark.rollNo = studentCombo->currentData().toString();
+    mark.subject = subject;
+    mark.marks = marksSpin->value();
+    mark.maxMarks = maxMarksSpin->value();
+    mark.examType = examTypeCombo->currentText();
+    
+    MarksRepository repository(db);
+    if (repository.add(mark)) {
+        noteUpdated(mark.rollNo);
         QMessageBox::information(this, "Success", "Marks added successfully!");
         subjectEdit->clear();
         marksSpin->setValue(0);
         loadStudentMarks();
     } else {
-        QMessageBox::critical(this, "Error", "Failed to add marks: " + query.lastError().text());
+        QMessageBox::critical(this, "Error", "Failed to add marks: " + repository.lastError());
     }
 }
 
@@ -217,15 +216,13 @@ void MarksDialog::deleteMarks() {
                                      QMessageBox::Yes | QMessageBox::No);
     
     if (reply == QMessageBox::Yes) {
-        QSqlQuery query(db);
-        query.prepare("DELETE FROM marks WHERE mark_id = ?");
-        query.addBindValue(markId);
-        
-        if (query.exec()) {
+        MarksRepository repository(db);
+        if (repository.remove(markId)) {
+            noteUpdated(studentCombo->currentData().toString());
             QMessageBox::information(this, "Success", "Marks deleted!");
             loadStudentMarks();
         } else {
-            QMessageBox::critical(this, "Error", "Failed to delete: " + query.lastError().text());
+            QMessageBox::critical(this, "Error", "Failed to delete: " + repository.lastError());
         }
     }
 }
@@ -236,41 +233,22 @@ void MarksDialog::calculateCGPA() {
         return;
     }
     
+    // Kept current by every add / delete, this is a single-row read
     QString rollNo = studentCombo->currentData().toString();
-    double cgpa = calculateStudentCGPA(rollNo);
-    
-    QSqlQuery updateQuery(db);
-    updateQuery.prepare("UPDATE students SET cgpa = ? WHERE roll_no = ?");
-    updateQuery.addBindValue(cgpa);
-    updateQuery.addBindValue(rollNo);
-    updateQuery.exec();
+    double cgpa = MarksRepository(db).cgpa(rollNo);
     
-    QMessageBox::information(this, "CGPA Calculated",
-                            QString("Student CGPA: %1 / 10.0\n\nCGPA updated in student records!").arg(cgpa, 0, 'f', 2));
+    QMessageBox::information(this, "CGPA",
+                            QString("Student CGPA: %1 / 10.0\n\nStudent records are updated with every marks change.").arg(cgpa, 0, 'f', 2));
 }
 
-double MarksDialog::calculateStudentCGPA(const QString &rollNo) {
-    QSqlQuery query(db);
-    query.prepare("SELECT marks, max_marks FROM marks WHERE roll_no = ?");
-    query.addBindValue(rollNo);
-    
-    double totalPercentage = 0;
-    int count = 0;
-    
-    if (query.exec()) {
-        while (query.next()) {
-            int marks = query.value(0).toInt();
-            int maxMarks = query.value(1).toInt();
-            double percentage = (marks * 100.0) / maxMarks;
-            totalPercentage += percentage;
-            count++;
-        }
+QStringList MarksDialog::updatedStudents() const {
+    return updatedRollNos;
+}
+
+void MarksDialog::noteUpdated(const QString &rollNo) {
+    if (!updatedRollNos.contains(rollNo)) {
+        updatedRollNos.append(rollNo);
     }
-    
-    if (count == 0) return 0.0;
-    
-    double avgPercentage = totalPercentage / count;
-    return avgPercentage / 10.0;
 }
 
 void MarksDialog::refreshTable() {
@@ -8,12 +8,16 @@
 #include <QTableWidget>
 #include <QPushButton>
 #include <QSqlDatabase>
+#include <QStringList>
 
 class MarksDialog : public QDialog {
     Q_OBJECT
 
 public:
     explicit MarksDialog(QSqlDatabase &database, QWidget *parent = nullptr);
+    
+    // Roll numbers whose stored CGPA changed while the dialog was open
+    QStringList updatedStudents() const;
 
 private slots:
     void loadStudentMarks();
@@ -24,6 +28,7 @@ private slots:
 
 private:
     QSqlDatabase &db;
+    QStringList updatedRollNos;
     
     // UI Components
     QComboBox *studentCombo;
@@ -40,7 +45,7 @@ private:
     
     void setupUI();
     void loadStudentList();
-    double calculateStudentCGPA(const QString &rollNo);
+    void noteUpdated(const QString &rollNo);
 };
 
 #endif // MARKSDIALOG_H
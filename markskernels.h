@@ -0,0 +1,143 @@
+#ifndef MARKSKERNELS_H
+#define MARKSKERNELS_H
+
+#include "marksnapshot.h"
+
+#include <QVector>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+// Kernels over MarksColumns for ReportBuilder. Each is one loop over
+// contiguous arrays with no branches in its body: filters AND comparisons
+// together and write every row index, advancing the output only for the
+// rows that pass, so the row-local parts vectorize. Student attributes are
+// a gather and are only checked for the rows left after that.
+namespace MarksKernels {
+
+// -1 (year 0) matches anything
+struct Filter
+{
+    int subject = -1;
+    int examType = -1;
+    int branch = -1;
+    int year = 0;
+};
+
+// Rows passing the filter, ascending. Removed rows, marks out of
+// max_marks <= 0 and marks of deleted students never pass.
+inline QVector<int> select(const MarksColumns &c, const Filter &f)
+{
+    const int n = c.rows();
+    QVector<int> rows(n);
+    int *out = rows.data();
+
+    const quint16 *subject = c.subject.constData();
+    const quint16 *exam = c.examType.constData();
+    const qint16 *maxMarks = c.maxMarks.constData();
+    const bool anySubject = f.subject < 0;
+    const bool anyExam = f.examType < 0;
+    const quint16 wantSubject = quint16(f.subject);
+    const quint16 wantExam = quint16(f.examType);
+
+    int kept = 0;
+    for (int i = 0; i < n; i++) {
+        const bool keep = (subject[i] != MarksColumns::Removed) & (maxMarks[i] > 0)
+                          & (anySubject | (subject[i] == wantSubject))
+                          & (anyExam | (exam[i] == wantExam));
+        out[kept] = i;
+        kept += keep;
+    }
+
+    const qint32 *student = c.student.constData();
+    const qint16 *branch = c.studentBranch.constData();
+    const qint16 *year = c.studentYear.constData();
+    const bool anyBranch = f.branch < 0;
+    const bool anyYear = f.year <= 0;
+
+    int passed = 0;
+    for (int j = 0; j < kept; j++) {
+        const int s = student[out[j]];
+        const bool keep = (branch[s] >= 0)
+                          & (anyBranch | (branch[s] == f.branch))
+                          & (anyYear | (year[s] == f.year));
+        out[passed] = out[j];
+        passed += keep;
+    }
+    rows.resize(passed);
+    return rows;
+}
+
+// Percentage of each selected row
+inline QVector<float> percentages(const MarksColumns &c, const QVector<int> &rows)
+{
+    const int n = rows.size();
+    QVector<float> pct(n);
+    float *out = pct.data();
+    const int *r = rows.constData();
+    const qint16 *marks = c.marks.constData();
+    const qint16 *maxMarks = c.maxMarks.constData();
+    for (int j = 0; j < n; j++)
+        out[j] = marks[r[j]] * 100.0f / maxMarks[r[j]];
+    return pct;
+}
+
+struct Moments
+{
+    qint64 count = 0;
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    float  min = std::numeric_limits<float>::infinity();
+    float  max = -std::numeric_limits<float>::infinity();
+
+    double mean() const { return count > 0 ? sum / count : 0.0; }
+    // Population standard deviation
+    double stddev() const
+    {
+        if (count == 0)
+            return 0.0;
+        double m = mean();
+        return std::sqrt(std::max(0.0, sumSquares / count - m * m));
+    }
+};
+
+// Moments of values per group; keys[j] is value j's group, 0 .. groups-1
+inline QVector<Moments> aggregate(const QVector<int> &keys, const QVector<float> &values, int groups)
+{
+    QVector<Moments> result(groups);
+    Moments *m = result.data();
+    const int *k = keys.constData();
+    const float *v = values.constData();
+    const int n = qMin(keys.size(), values.size());
+    for (int j = 0; j < n; j++) {
+        Moments &g = m[k[j]];
+        g.count++;
+        g.sum += v[j];
+        g.sumSquares += double(v[j]) * v[j];
+        g.min = std::min(g.min, v[j]);
+        g.max = std::max(g.max, v[j]);
+    }
+    return result;
+}
+
+// Positions of the k largest values, largest first, ties in position
+// order. A partial sort keeps a k-element heap, so this is O(n log k).
+inline QVector<int> topK(const QVector<float> &values, int k)
+{
+    QVector<int> order(values.size());
+    std::iota(order.begin(), order.end(), 0);
+    k = qBound(0, k, order.size());
+
+    const float *v = values.constData();
+    std::partial_sort(order.begin(), order.begin() + k, order.end(), [v](int a, int b) {
+        return v[a] > v[b] || (v[a] == v[b] && a < b);
+    });
+    order.resize(k);
+    return order;
+}
+
+} // namespace MarksKernels
+
+#endif // MARKSKERNELS_H
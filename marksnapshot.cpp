@@ -0,0 +1,251 @@
+#include "marksnapshot.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+namespace {
+// Keyed by database file, so the GUI's and the worker's connections share
+// one snapshot. The mutex guards the registry; each snapshot has its own
+// read-write lock.
+QMutex registryMutex;
+QHash<QString, std::shared_ptr<MarksSnapshot>> registry;
+
+qint16 clampToInt16(int value)
+{
+    return qint16(qBound(-32768, value, 32767));
+}
+}
+
+std::shared_ptr<MarksSnapshot> MarksSnapshot::acquire(const QSqlDatabase &db, QString *error)
+{
+    QMutexLocker lock(&registryMutex);
+
+    std::shared_ptr<MarksSnapshot> &snapshot = registry[db.databaseName()];
+    if (snapshot)
+        return snapshot;
+
+    std::shared_ptr<MarksSnapshot> fresh(new MarksSnapshot);
+    QString loadError;
+    if (!fresh->load(db, loadError)) {
+        registry.remove(db.databaseName());
+        if (error)
+            *error = loadError;
+        return nullptr;
+    }
+    snapshot = fresh;
+    return snapshot;
+}
+
+std::shared_ptr<MarksSnapshot> MarksSnapshot::loaded(const QSqlDatabase &db)
+{
+    QMutexLocker lock(&registryMutex);
+    return registry.value(db.databaseName());
+}
+
+// Reports still holding the old snapshot finish on it
+void MarksSnapshot::invalidate(const QSqlDatabase &db)
+{
+    QMutexLocker lock(&registryMutex);
+    registry.remove(db.databaseName());
+}
+
+void MarksSnapshot::markAdded(const QSqlDatabase &db, qint64 markId, const QString &rollNo,
+                              const QString &subject, const QString &examType,
+                              int marks, int maxMarks)
+{
+    std::shared_ptr<MarksSnapshot> snapshot = loaded(db);
+    if (!snapshot)
+        return;
+
+    QWriteLocker lock(&snapshot->rwLock);
+    int ordinal = snapshot->data.ordinals.value(rollNo, -1);
+    if (ordinal < 0 && snapshot->loadStudent(db, rollNo))
+        ordinal = snapshot->data.ordinals.value(rollNo, -1);
+    if (ordinal >= 0)
+        snapshot->append(markId, ordinal, subject, examType, marks, maxMarks);
+}
+
+void MarksSnapshot::markRemoved(const QSqlDatabase &db, qint64 markId)
+{
+    std::shared_ptr<MarksSnapshot> snapshot = loaded(db);
+    if (!snapshot)
+        return;
+
+    QWriteLocker lock(&snapshot->rwLock);
+    snapshot->remove(markId);
+}
+
+// Rereads the student's name, branch and year, or marks them deleted
+void MarksSnapshot::studentChanged(const QSqlDatabase &db, const QString &rollNo)
+{
+    std::shared_ptr<MarksSnapshot> snapshot = loaded(db);
+    if (!snapshot)
+        return;
+
+    QWriteLocker lock(&snapshot->rwLock);
+    if (!snapshot->loadStudent(db, rollNo))
+        invalidate(db);
+}
+
+// =========================================
+// Loading
+// =========================================
+
+// Two forward-only scans: students with their ordinals, then marks in
+// mark_id (rowid) order
+bool MarksSnapshot::load(const QSqlDatabase &db, QString &error)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+
+    QueryTrace students(q);
+    if (!students.exec("SELECT o.ordinal, o.roll_no, s.name, s.branch, s.year, s.roll_no IS NOT NULL "
+                       "FROM student_ordinals o LEFT JOIN students s ON s.roll_no = o.roll_no")) {
+        error = q.lastError().text();
+        return false;
+    }
+    while (students.next()) {
+        setStudent(q.value(0).toInt(), q.value(1).toString(), q.value(2).toString(),
+                   q.value(3).toString(), q.value(4).toInt(), q.value(5).toBool());
+    }
+    students.finish();
+
+    QueryTrace marks(q);
+    if (!marks.exec("SELECT mark_id, roll_no, subject, exam_type, marks, max_marks FROM marks "
+                    "ORDER BY mark_id")) {
+        error = q.lastError().text();
+        return false;
+    }
+    while (marks.next()) {
+        int ordinal = data.ordinals.value(q.value(1).toString(), -1);
+        if (ordinal < 0)
+            continue;
+        append(q.value(0).toLongLong(), ordinal, q.value(2).toString(), q.value(3).toString(),
+               q.value(4).toInt(), q.value(5).toInt());
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    loadTime = timer.elapsed();
+    qInfo().noquote() << QString("Marks snapshot: %1 marks, %2 subjects, %3 exam types in %4 ms")
+                             .arg(data.rows())
+                             .arg(data.subjects.size())
+                             .arg(data.examTypes.size())
+                             .arg(loadTime);
+    return true;
+}
+
+// False when the query fails
+bool MarksSnapshot::loadStudent(const QSqlDatabase &db, const QString &rollNo)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT o.ordinal, s.name, s.branch, s.year, s.roll_no IS NOT NULL "
+        "FROM student_ordinals o LEFT JOIN students s ON s.roll_no = o.roll_no "
+        "WHERE o.roll_no = ?");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec())
+        return false;
+    if (trace.next()) {
+        setStudent(q.value(0).toInt(), rollNo, q.value(1).toString(), q.value(2).toString(),
+                   q.value(3).toInt(), q.value(4).toBool());
+    }
+    trace.finish();
+    return true;
+}
+
+void MarksSnapshot::setStudent(int ordinal, const QString &rollNo, const QString &name,
+                               const QString &branch, int year, bool exists)
+{
+    if (ordinal < 0)
+        return;
+    if (ordinal >= data.studentBranch.size()) {
+        const int old = data.studentBranch.size();
+        const int size = qMax(ordinal + 1, old * 2);
+        data.studentBranch.resize(size);
+        data.studentYear.resize(size);
+        data.studentRollNo.resize(size);
+        data.studentName.resize(size);
+        std::fill(data.studentBranch.begin() + old, data.studentBranch.end(), qint16(-1));
+    }
+
+    data.ordinals.insert(rollNo, ordinal);
+    data.studentRollNo[ordinal] = rollNo;
+    data.studentName[ordinal] = name;
+    data.studentBranch[ordinal] = exists ? qint16(data.branches.intern(branch)) : qint16(-1);
+    data.studentYear[ordinal] = clampToInt16(year);
+}
+
+// =========================================
+// Updates
+// =========================================
+
+// Marks arrive in mark_id order; ids already in the columns were picked up
+// by a load that raced with the write
+void MarksSnapshot::append(qint64 markId, int ordinal, const QString &subject,
+                           const QString &examType, int marks, int maxMarks)
+{
+    if (!data.markId.isEmpty() && markId <= data.markId.last())
+        return;
+
+    data.markId.append(markId);
+    data.student.append(ordinal);
+    data.subject.append(quint16(data.subjects.intern(subject)));
+    data.examType.append(quint16(data.examTypes.intern(examType)));
+    data.marks.append(clampToInt16(marks));
+    data.maxMarks.append(clampToInt16(maxMarks));
+}
+
+// Rows are only flagged; the columns are rewritten once a quarter of them
+// are gone
+void MarksSnapshot::remove(qint64 markId)
+{
+    auto it = std::lower_bound(data.markId.cbegin(), data.markId.cend(), markId);
+    if (it == data.markId.cend() || *it != markId)
+        return;
+
+    const int row = int(it - data.markId.cbegin());
+    if (data.subject[row] == MarksColumns::Removed)
+        return;
+    data.subject[row] = MarksColumns::Removed;
+    if (++data.removed > data.rows() / 4)
+        compact();
+}
+
+void MarksSnapshot::compact()
+{
+    int kept = 0;
+    for (int i = 0; i < data.rows(); i++) {
+        if (data.subject[i] == MarksColumns::Removed)
+            continue;
+        data.markId[kept] = data.markId[i];
+        data.student[kept] = data.student[i];
+        data.subject[kept] = data.subject[i];
+        data.examType[kept] = data.examType[i];
+        data.marks[kept] = data.marks[i];
+        data.maxMarks[kept] = data.maxMarks[i];
+        kept++;
+    }
+    data.markId.resize(kept);
+    data.student.resize(kept);
+    data.subject.resize(kept);
+    data.examType.resize(kept);
+    data.marks.resize(kept);
+    data.maxMarks.resize(kept);
+    data.removed = 0;
+}
@@ -0,0 +1,113 @@
+#ifndef MARKSNAPSHOT_H
+#define MARKSNAPSHOT_H
+
+#include <QSqlDatabase>
+#include <QReadWriteLock>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+// Strings of one column mapped to dense ids in order of first appearance
+class ColumnDictionary
+{
+public:
+    // -1 when the string never occurred
+    int id(const QString &value) const { return ids.value(value, -1); }
+
+    int intern(const QString &value)
+    {
+        auto it = ids.constFind(value);
+        if (it != ids.cend())
+            return it.value();
+        names.append(value);
+        return ids.insert(value, names.size() - 1).value();
+    }
+
+    const QString &name(int id) const { return names[id]; }
+    int size() const { return names.size(); }
+
+private:
+    QHash<QString, int> ids;
+    QVector<QString> names;
+};
+
+// The marks table as columns, one entry per mark in mark_id order, plus the
+// attributes of each student by ordinal (student_ordinals.ordinal). Marks
+// of roll numbers that never were a student are left out.
+struct MarksColumns
+{
+    static const quint16 Removed = 0xFFFF;      // subject of a deleted mark
+
+    QVector<qint64>  markId;
+    QVector<qint32>  student;       // ordinal
+    QVector<quint16> subject;       // id in subjects, or Removed
+    QVector<quint16> examType;      // id in examTypes
+    QVector<qint16>  marks;         // clamped to the qint16 range
+    QVector<qint16>  maxMarks;
+
+    // By ordinal; branch is -1 where the student was deleted
+    QVector<qint16>  studentBranch; // id in branches
+    QVector<qint16>  studentYear;
+    QVector<QString> studentRollNo;
+    QVector<QString> studentName;
+
+    ColumnDictionary subjects;
+    ColumnDictionary examTypes;
+    ColumnDictionary branches;
+    QHash<QString, int> ordinals;   // roll_no -> ordinal
+
+    int rows() const { return markId.size(); }
+    int removed = 0;
+};
+
+// An in-memory columnar copy of marks for ad-hoc analytics (ReportBuilder),
+// shared by every connection to the same database file. It is optional:
+// nothing is loaded until acquire() is first called, and until then the
+// write hooks below cost one hash lookup.
+//
+// Once loaded it follows the single-row write paths: MarksRepository calls
+// markAdded()/markRemoved() after its write commits and StudentRepository
+// calls studentChanged(). Bulk loads (imports, the generator) call
+// invalidate() instead and the next acquire() reads the table again. Read
+// the columns under lock() for reading.
+class MarksSnapshot
+{
+public:
+    // The database's snapshot, loaded from db on first use; null with
+    // error set when loading fails
+    static std::shared_ptr<MarksSnapshot> acquire(const QSqlDatabase &db, QString *error = nullptr);
+    // Null unless a snapshot of db's database is loaded
+    static std::shared_ptr<MarksSnapshot> loaded(const QSqlDatabase &db);
+    static void invalidate(const QSqlDatabase &db);
+
+    // Write hooks; they do nothing when no snapshot is loaded
+    static void markAdded(const QSqlDatabase &db, qint64 markId, const QString &rollNo,
+                          const QString &subject, const QString &examType, int marks, int maxMarks);
+    static void markRemoved(const QSqlDatabase &db, qint64 markId);
+    static void studentChanged(const QSqlDatabase &db, const QString &rollNo);
+
+    QReadWriteLock &lock() { return rwLock; }
+    const MarksColumns &columns() const { return data; }
+
+    qint64 loadMs() const { return loadTime; }
+
+private:
+    MarksSnapshot() = default;
+
+    QReadWriteLock rwLock;
+    MarksColumns data;
+    qint64 loadTime = 0;
+
+    bool load(const QSqlDatabase &db, QString &error);
+    bool loadStudent(const QSqlDatabase &db, const QString &rollNo);
+    void setStudent(int ordinal, const QString &rollNo, const QString &name,
+                    const QString &branch, int year, bool exists);
+    void append(qint64 markId, int ordinal, const QString &subject, const QString &examType,
+                int marks, int maxMarks);
+    void remove(qint64 markId);
+    void compact();
+};
+
+#endif // MARKSNAPSHOT_H
@@ -0,0 +1,423 @@
+#include "marksrepository.h"
+#include "statementcache.h"
+#include "gradingkernels.h"
+#include "querystats.h"
+#include "dashboardrepository.h"
+#include "marksnapshot.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QStringList>
+
+MarksRepository::MarksRepository(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QVector<MarkRecord> MarksRepository::forStudent(const QString &rollNo)
+{
+    QVector<MarkRecord> marks;
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT mark_id, subject, marks, max_marks, exam_type FROM marks WHERE roll_no = ?");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return marks;
+    }
+
+    while (trace.next()) {
+        MarkRecord m;
+        m.markId   = q.value(0).toInt();
+        m.rollNo   = rollNo;
+        m.subject  = q.value(1).toString();
+        m.marks    = q.value(2).toInt();
+        m.maxMarks = q.value(3).toInt();
+        m.examType = q.value(4).toString();
+        marks.append(m);
+    }
+    return marks;
+}
+
+bool MarksRepository::add(MarkRecord &mark)
+{
+    if (!begin())
+        return false;
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "INSERT INTO marks (roll_no, subject, marks, max_marks, exam_type) "
+        "VALUES (?, ?, ?, ?, ?)");
+    q.addBindValue(mark.rollNo);
+    q.addBindValue(mark.subject);
+    q.addBindValue(mark.marks);
+    q.addBindValue(mark.maxMarks);
+    q.addBindValue(mark.examType);
+
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        rollback();
+        return false;
+    }
+    mark.markId = q.lastInsertId().toInt();
+
+    if (mark.maxMarks > 0
+        && !applyDelta(mark.rollNo, mark.subject, mark.examType, mark.percentage(), 1)) {
+        rollback();
+        return false;
+    }
+    if (!commit())
+        return false;
+
+    MarksSnapshot::markAdded(db, mark.markId, mark.rollNo, mark.subject, mark.examType,
+                             mark.marks, mark.maxMarks);
+    CohortRanking::invalidate(db, mark.subject, mark.examType);
+    StudentProfileRepository::invalidate(db, mark.rollNo);
+    return true;
+}
+
+bool MarksRepository::remove(int markId)
+{
+    if (!begin())
+        return false;
+
+    StatementCache &statements = StatementCache::forDatabase(db);
+
+    // The aggregates need the row being deleted; NULL subjects and exam
+    // types are keyed as '' in marks_agg, as by the migration-3 backfill
+    QSqlQuery &read = statements.prepared(
+        "SELECT roll_no, COALESCE(subject, ''), marks, max_marks, COALESCE(exam_type, '') "
+        "FROM marks WHERE mark_id = ?");
+    read.addBindValue(markId);
+    QueryTrace readTrace(read);
+    if (!readTrace.exec()) {
+        error = read.lastError().text();
+        rollback();
+        return false;
+    }
+    if (!readTrace.next()) {
+        readTrace.finish();
+        return commit();
+    }
+
+    MarkRecord mark;
+    mark.markId   = markId;
+    mark.rollNo   = read.value(0).toString();
+    mark.subject  = read.value(1).toString();
+    mark.marks    = read.value(2).toInt();
+    mark.maxMarks = read.value(3).toInt();
+    mark.examType = read.value(4).toString();
+    readTrace.finish();
+
+    QSqlQuery &q = statements.prepared("DELETE FROM marks WHERE mark_id = ?");
+    q.addBindValue(markId);
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        rollback();
+        return false;
+    }
+
+    if (mark.maxMarks > 0
+        && !applyDelta(mark.rollNo, mark.subject, mark.examType, -mark.percentage(), -1)) {
+        rollback();
+        return false;
+    }
+    if (!commit())
+        return false;
+
+    MarksSnapshot::markRemoved(db, markId);
+    CohortRanking::invalidate(db, mark.subject, mark.examType);
+    StudentProfileRepository::invalidate(db, mark.rollNo);
+    return true;
+}
+
+bool MarksRepository::addTotalsSince(qint64 afterMarkId)
+{
+    if (!foldTotalsSince(afterMarkId))
+        return false;
+
+    // After the commit, so no reader caches the totals from before it.
+    // Bulk inserts are reloaded rather than replayed into the snapshot.
+    MarksSnapshot::invalidate(db);
+    CohortRanking::invalidateAll(db);
+    StudentProfileRepository::invalidateAll(db);
+    return true;
+}
+
+bool MarksRepository::foldTotalsSince(qint64 afterMarkId)
+{
+    if (!begin())
+        return false;
+
+    // mark_id is the rowid, so "mark_id > ?" only reads the new rows. The
+    // WHERE also keeps the SELECT from swallowing ON CONFLICT. Keys as in
+    // the migration-3 backfill: no NULL roll numbers, NULL subjects and
+    // exam types as ''.
+    const QStringList sums = {
+        "INSERT INTO marks_agg (roll_no, subject, exam_type, sum_pct, n) "
+        "SELECT roll_no, COALESCE(subject, ''), COALESCE(exam_type, ''),"
+        " SUM(marks * 100.0 / max_marks), COUNT(*) "
+        "FROM marks WHERE mark_id > :after AND roll_no IS NOT NULL AND max_marks > 0 "
+        "GROUP BY 1, 2, 3 "
+        "ON CONFLICT(roll_no, subject, exam_type) DO UPDATE SET "
+        " sum_pct = sum_pct + excluded.sum_pct, n = n + excluded.n",
+
+        "INSERT INTO cgpa_totals (roll_no, sum_pct, n) "
+        "SELECT roll_no, SUM(marks * 100.0 / max_marks), COUNT(*) "
+        "FROM marks WHERE mark_id > :after AND roll_no IS NOT NULL AND max_marks > 0 "
+        "GROUP BY roll_no "
+        "ON CONFLICT(roll_no) DO UPDATE SET "
+        " sum_pct = sum_pct + excluded.sum_pct, n = n + excluded.n"
+    };
+
+    // The class dashboard's results of the touched aggregates, out before
+    // the sums change and back in after
+    DashboardRepository dashboard(db);
+    if (!dashboard.addResultsSince(-1, afterMarkId)) {
+        error = dashboard.lastError();
+        rollback();
+        return false;
+    }
+
+    QSqlQuery q(db);
+    for (const QString &sql : sums) {
+        q.prepare(sql);
+        q.bindValue(":after", afterMarkId);
+        if (!QueryTrace(q).exec()) {
+            error = q.lastError().text();
+            rollback();
+            return false;
+        }
+    }
+
+    if (!dashboard.addResultsSince(1, afterMarkId)) {
+        error = dashboard.lastError();
+        rollback();
+        return false;
+    }
+
+    // The plain average is one UPDATE; other policies go student by student
+    GradingPolicy policy = GradingPolicy::active();
+    if (policy.kind == GradingPolicy::Average) {
+        q.prepare("UPDATE students SET cgpa = "
+                  " (SELECT c.sum_pct / c.n / 10.0 FROM cgpa_totals c"
+                  "  WHERE c.roll_no = students.roll_no AND c.n > 0) "
+                  "WHERE roll_no IN (SELECT roll_no FROM marks WHERE mark_id > :after AND max_marks > 0)");
+        q.bindValue(":after", afterMarkId);
+        if (!QueryTrace(q).exec()) {
+            error = q.lastError().text();
+            rollback();
+            return false;
+        }
+        return commit();
+    }
+
+    q.prepare("SELECT DISTINCT roll_no FROM marks WHERE mark_id > :after AND max_marks > 0");
+    q.bindValue(":after", afterMarkId);
+    QueryTrace distinct(q);
+    if (!distinct.exec()) {
+        error = q.lastError().text();
+        rollback();
+        return false;
+    }
+    QStringList rollNos;
+    while (distinct.next())
+        rollNos << q.value(0).toString();
+    distinct.finish();
+
+    QSqlQuery &store = StatementCache::forDatabase(db).prepared(
+        "UPDATE students SET cgpa = ? WHERE roll_no = ?");
+    for (const QString &rollNo : rollNos) {
+        error.clear();
+        double value = weightedCgpa(rollNo, policy);
+        if (!error.isEmpty()) {
+            rollback();
+            return false;
+        }
+        store.addBindValue(value);
+        store.addBindValue(rollNo);
+        if (!QueryTrace(store).exec()) {
+            error = store.lastError().text();
+            rollback();
+            return false;
+        }
+    }
+    return commit();
+}
+
+double MarksRepository::cgpa(const QString &rollNo)
+{
+    GradingPolicy policy = GradingPolicy::active();
+    if (policy.kind != GradingPolicy::Average)
+        return weightedCgpa(rollNo, policy);
+
+    // The plain average is the per-student total: one row
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT sum_pct, n FROM cgpa_totals WHERE roll_no = ?");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return 0.0;
+    }
+
+    double cgpa = 0.0;
+    if (trace.next()) {
+        int count = q.value(1).toInt();
+        if (count > 0)
+            cgpa = q.value(0).toDouble() / count / 10.0;
+    }
+    trace.finish();
+    return cgpa;
+}
+
+// Weighted policies need the (subject, exam_type) sums, one row each,
+// read in primary key order so each subject's rows are together
+double MarksRepository::weightedCgpa(const QString &rollNo, const GradingPolicy &policy)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT subject, exam_type, sum_pct, n FROM marks_agg "
+        "WHERE roll_no = ? ORDER BY subject, exam_type");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return 0.0;
+    }
+
+    GradingTables tables(policy);
+    return Grading::withKernel(tables, [&](auto &kernel) {
+        while (trace.next()) {
+            kernel.add(tables.subjectId(q.value(0).toString()),
+                       tables.examId(q.value(1).toString()),
+                       q.value(2).toDouble(), q.value(3).toInt());
+        }
+        return kernel.finish();
+    });
+}
+
+// =========================================
+// Running totals
+// =========================================
+
+// Adds pct / count to the (roll_no, subject, exam_type) and per-student
+// sums and stores the resulting CGPA. Sums whose count drops to zero are
+// deleted, which also discards floating-point residue from subtractions.
+bool MarksRepository::applyDelta(const QString &rollNo, const QString &subject,
+                                 const QString &examType, double pct, int count)
+{
+    StatementCache &statements = StatementCache::forDatabase(db);
+
+    // The class dashboard drops this result as it was and re-adds it below
+    DashboardRepository dashboard(db);
+    if (!dashboard.addResults(-1, rollNo, subject, examType)) {
+        error = dashboard.lastError();
+        return false;
+    }
+
+    QSqlQuery &agg = statements.prepared(
+        "INSERT INTO marks_agg (roll_no, subject, exam_type, sum_pct, n) "
+        "VALUES (?, ?, ?, ?, ?) "
+        "ON CONFLICT(roll_no, subject, exam_type) DO UPDATE SET "
+        " sum_pct = sum_pct + excluded.sum_pct, n = n + excluded.n");
+    agg.addBindValue(rollNo);
+    agg.addBindValue(subject);
+    agg.addBindValue(examType);
+    agg.addBindValue(pct);
+    agg.addBindValue(count);
+    if (!QueryTrace(agg).exec()) {
+        error = agg.lastError().text();
+        return false;
+    }
+
+    QSqlQuery &totals = statements.prepared(
+        "INSERT INTO cgpa_totals (roll_no, sum_pct, n) VALUES (?, ?, ?) "
+        "ON CONFLICT(roll_no) DO UPDATE SET "
+        " sum_pct = sum_pct + excluded.sum_pct, n = n + excluded.n");
+    totals.addBindValue(rollNo);
+    totals.addBindValue(pct);
+    totals.addBindValue(count);
+    if (!QueryTrace(totals).exec()) {
+        error = totals.lastError().text();
+        return false;
+    }
+
+    QSqlQuery &emptyAgg = statements.prepared(
+        "DELETE FROM marks_agg WHERE roll_no = ? AND subject = ? AND exam_type = ? AND n <= 0");
+    emptyAgg.addBindValue(rollNo);
+    emptyAgg.addBindValue(subject);
+    emptyAgg.addBindValue(examType);
+    if (!QueryTrace(emptyAgg).exec()) {
+        error = emptyAgg.lastError().text();
+        return false;
+    }
+    if (!dashboard.addResults(1, rollNo, subject, examType)) {
+        error = dashboard.lastError();
+        return false;
+    }
+
+    QSqlQuery &emptyTotals = statements.prepared(
+        "DELETE FROM cgpa_totals WHERE roll_no = ? AND n <= 0");
+    emptyTotals.addBindValue(rollNo);
+    if (!QueryTrace(emptyTotals).exec()) {
+        error = emptyTotals.lastError().text();
+        return false;
+    }
+
+    // Under the active grading policy
+    error.clear();
+    double value = cgpa(rollNo);
+    if (!error.isEmpty())
+        return false;
+
+    QSqlQuery &store = statements.prepared(
+        "UPDATE students SET cgpa = ? WHERE roll_no = ?");
+    store.addBindValue(value);
+    store.addBindValue(rollNo);
+    if (!QueryTrace(store).exec()) {
+        error = store.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// A savepoint rather than BEGIN, so a bulk caller that already opened a
+// transaction can add marks through this class
+bool MarksRepository::begin()
+{
+    QSqlQuery q(db);
+    if (!QueryTrace(q).exec("SAVEPOINT marks_write")) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool MarksRepository::commit()
+{
+    QSqlQuery q(db);
+    if (!QueryTrace(q).exec("RELEASE marks_write")) {
+        error = q.lastError().text();
+        rollback();
+        return false;
+    }
+    return true;
+}
+
+void MarksRepository::rollback()
+{
+    QSqlQuery q(db);
+    QueryTrace(q).exec("ROLLBACK TO marks_write");
+    QueryTrace(q).exec("RELEASE marks_write");
+}
+
+QString MarksRepository::lastError() const
+{
+    return error;
+}
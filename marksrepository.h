@@ -0,0 +1,62 @@
+#ifndef MARKSREPOSITORY_H
+#define MARKSREPOSITORY_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+
+#include "gradingpolicy.h"
+
+struct MarkRecord
+{
+    int     markId = 0;
+    QString rollNo;
+    QString subject;
+    int     marks = 0;
+    int     maxMarks = 0;
+    QString examType;
+
+    double percentage() const { return maxMarks > 0 ? (marks * 100.0) / maxMarks : 0.0; }
+};
+
+Q_DECLARE_METATYPE(MarkRecord)
+
+class MarksRepository
+{
+public:
+    explicit MarksRepository(const QSqlDatabase &database);
+
+    QVector<MarkRecord> forStudent(const QString &rollNo);
+
+    // Both also update marks_agg, cgpa_totals and students.cgpa, all in
+    // one transaction (a savepoint, so they can run inside a caller's)
+    bool add(MarkRecord &mark);     // fills in markId
+    bool remove(int markId);
+
+    // For marks inserted in bulk without add(): folds every mark with
+    // mark_id above afterMarkId into the totals, set-based, and refreshes
+    // the CGPA of the students concerned
+    bool addTotalsSince(qint64 afterMarkId);
+
+    // Under the active GradingPolicy, from the running totals: one row for
+    // the plain average, one per (subject, exam_type) for the others
+    double cgpa(const QString &rollNo);
+
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+
+    double weightedCgpa(const QString &rollNo, const GradingPolicy &policy);
+    bool applyDelta(const QString &rollNo, const QString &subject,
+                    const QString &examType, double pct, int count);
+    bool foldTotalsSince(qint64 afterMarkId);
+
+    bool begin();
+    bool commit();
+    void rollback();
+};
+
+#endif // MARKSREPOSITORY_H
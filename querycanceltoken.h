@@ -0,0 +1,21 @@
+#ifndef QUERYCANCELTOKEN_H
+#define QUERYCANCELTOKEN_H
+
+#include <atomic>
+#include <memory>
+
+// Shared between the GUI thread, which cancels, and the worker, which
+// checks it between rows or before expensive steps.
+class QueryCancelToken
+{
+public:
+    QueryCancelToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    bool isCancelled() const { return flag->load(std::memory_order_relaxed); }
+    void cancel() const { flag->store(true, std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+#endif // QUERYCANCELTOKEN_H
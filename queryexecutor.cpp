@@ -0,0 +1,136 @@
+#include "queryexecutor.h"
+#include "statementcache.h"
+
+#include <QSqlError>
+#include <QMetaObject>
+#include <QDebug>
+
+QueryExecutor::QueryExecutor(const QString &databaseName, const ConnectionProfile &profile,
+                             QObject *parent)
+    : QObject(parent),
+      worker(new QObject),
+      databaseName(databaseName),
+      connectionName(QString("srms_worker_%1").arg(quintptr(this), 0, 16)),
+      profile(profile),
+      nextTicket(0),
+      pending(0)
+{
+    thread.setObjectName("srms-query-worker");
+    worker->moveToThread(&thread);
+    thread.start();
+}
+
+QueryExecutor::~QueryExecutor()
+{
+    for (const QueryCancelToken &token : tokens)
+        token.cancel();
+
+    // The connection has to be closed on the thread that opened it
+    QMetaObject::invokeMethod(worker, [this]() { closeWorkerConnection(); },
+                              Qt::BlockingQueuedConnection);
+    thread.quit();
+    thread.wait();
+    delete worker;
+
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+// =========================================
+// Submitting work (owner thread)
+// =========================================
+
+quint64 QueryExecutor::submit(const QString &channel, Task task)
+{
+    quint64 ticket = ++nextTicket;
+
+    // Supersede the previous request of this channel
+    if (tokens.contains(channel))
+        tokens[channel].cancel();
+
+    QueryCancelToken token;
+    tokens.insert(channel, token);
+    latestTicket.insert(channel, ticket);
+
+    if (pending++ == 0)
+        emit busyChanged(true);
+
+    QMetaObject::invokeMethod(worker, [this, ticket, channel, task, token]() {
+        QVariant result;
+        QString error;
+
+        if (!token.isCancelled()) {
+            QSqlDatabase db = workerConnection(error);
+            if (error.isEmpty())
+                result = task(db, token, error);
+        }
+
+        bool cancelled = token.isCancelled();
+        QMetaObject::invokeMethod(this, [=]() {
+            deliver(ticket, channel, result, error, cancelled);
+        }, Qt::QueuedConnection);
+    }, Qt::QueuedConnection);
+
+    return ticket;
+}
+
+void QueryExecutor::cancel(const QString &channel)
+{
+    if (tokens.contains(channel))
+        tokens.take(channel).cancel();
+    latestTicket.remove(channel);
+}
+
+bool QueryExecutor::isBusy() const
+{
+    return pending > 0;
+}
+
+void QueryExecutor::deliver(quint64 ticket, const QString &channel, const QVariant &result,
+                            const QString &error, bool cancelled)
+{
+    if (--pending == 0)
+        emit busyChanged(false);
+
+    // Superseded or cancelled requests are dropped silently
+    if (cancelled || latestTicket.value(channel) != ticket)
+        return;
+
+    latestTicket.remove(channel);
+    tokens.remove(channel);
+
+    if (!error.isEmpty())
+        emit failed(ticket, channel, error);
+    else
+        emit finished(ticket, channel, result);
+}
+
+// =========================================
+// Worker connection (worker thread)
+// =========================================
+
+QSqlDatabase QueryExecutor::workerConnection(QString &error)
+{
+    if (QSqlDatabase::contains(connectionName))
+        return QSqlDatabase::database(connectionName);
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+    db.setDatabaseName(databaseName);
+    if (!db.open()) {
+        error = "Could not open database: " + db.lastError().text();
+        return db;
+    }
+
+    QString profileError;
+    if (!profile.apply(db, &profileError))
+        qWarning() << "Worker connection: could not apply profile" << profile.name << profileError;
+    return db;
+}
+
+void QueryExecutor::closeWorkerConnection()
+{
+    StatementCache::release(connectionName);
+    if (QSqlDatabase::contains(connectionName)) {
+        QSqlDatabase db = QSqlDatabase::database(connectionName, false);
+        db.close();
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef QUERYEXECUTOR_H
+#define QUERYEXECUTOR_H
+
+#include "connectionprofile.h"
+#include "querycanceltoken.h"
+
+#include <QObject>
+#include <QThread>
+#include <QHash>
+#include <QString>
+#include <QVariant>
+#include <QSqlDatabase>
+
+#include <functional>
+
+// Runs database work on a dedicated thread that owns its own connection to
+// the same database file. Requests are grouped in named channels: submitting
+// to a channel cancels whatever is still queued or running there, and only
+// the newest request of a channel ever reports back. Results are delivered
+// on the thread that owns the executor.
+class QueryExecutor : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Runs on the worker thread. Set error to report a failure.
+    using Task = std::function<QVariant(QSqlDatabase &db,
+                                        const QueryCancelToken &token,
+                                        QString &error)>;
+
+    QueryExecutor(const QString &databaseName, const ConnectionProfile &profile,
+                  QObject *parent = nullptr);
+    ~QueryExecutor() override;
+
+    quint64 submit(const QString &channel, Task task);
+    void cancel(const QString &channel);
+
+    bool isBusy() const;
+
+signals:
+    void finished(quint64 ticket, const QString &channel, const QVariant &result);
+    void failed(quint64 ticket, const QString &channel, const QString &error);
+    void busyChanged(bool busy);
+
+private:
+    QThread thread;
+    QObject *worker;
+    QString databaseName;
+    QString connectionName;
+    ConnectionProfile profile;
+
+    quint64 nextTicket;
+    int pending;
+    QHash<QString, quint64> latestTicket;
+    QHash<QString, QueryCancelToken> tokens;
+
+    QSqlDatabase workerConnection(QString &error);
+    void closeWorkerConnection();
+    void deliver(quint64 ticket, const QString &channel, const QVariant &result,
+                 const QString &error, bool cancelled);
+};
+
+#endif // QUERYEXECUTOR_H
@@ -0,0 +1,387 @@
+#include "querystats.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+#include <QDateTime>
+#include <QThread>
+#include <QVariant>
+#include <QRegularExpression>
+#include <QDebug>
+
+#include <algorithm>
+#include <cmath>
+
+// =========================================
+// Histogram
+// =========================================
+
+LatencyHistogram::LatencyHistogram()
+    : counts(Buckets, 0),
+      total(0),
+      max(0),
+      sum(0)
+{
+}
+
+// Below 64 us one bucket per microsecond; above, the top six bits of the
+// value pick one of 32 buckets within its power of two
+int LatencyHistogram::bucketOf(qint64 micros)
+{
+    if (micros < 2 * SubBuckets)
+        return int(qMax<qint64>(micros, 0));
+
+    int msb = 63;
+    while (!(quint64(micros) >> msb))
+        msb--;
+    int shift = msb - 5;
+    int top = int(micros >> shift);          // 32 .. 63
+    int bucket = 2 * SubBuckets + (shift - 1) * SubBuckets + (top - SubBuckets);
+    return qMin(bucket, Buckets - 1);
+}
+
+qint64 LatencyHistogram::valueOf(int bucket)
+{
+    if (bucket < 2 * SubBuckets)
+        return bucket;
+
+    int k = bucket - 2 * SubBuckets;
+    int shift = k / SubBuckets + 1;
+    qint64 top = SubBuckets + k % SubBuckets;
+    return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(qint64 nanoseconds)
+{
+    counts[bucketOf(nanoseconds / 1000)]++;
+    total++;
+    max = qMax(max, nanoseconds);
+    sum += nanoseconds;
+}
+
+quint64 LatencyHistogram::count() const
+{
+    return total;
+}
+
+qint64 LatencyHistogram::maxNs() const
+{
+    return max;
+}
+
+qint64 LatencyHistogram::totalNs() const
+{
+    return sum;
+}
+
+qint64 LatencyHistogram::percentileNs(double percentile) const
+{
+    if (total == 0)
+        return 0;
+
+    quint64 wanted = qMax<quint64>(1, quint64(std::ceil(total * qBound(0.0, percentile, 100.0) / 100.0)));
+    quint64 seen = 0;
+    for (int b = 0; b < Buckets; b++) {
+        seen += counts[b];
+        if (seen >= wanted)
+            return qMin(valueOf(b) * 1000, max);
+    }
+    return max;
+}
+
+// =========================================
+// Registry
+// =========================================
+
+namespace {
+
+struct Entry
+{
+    LatencyHistogram histogram;
+    quint64 rows = 0;
+    quint64 binds = 0;
+    quint64 slow = 0;
+};
+
+QMutex statsMutex;
+QHash<QString, Entry> entries;
+QHash<QString, QString> fingerprints;       // SQL text -> fingerprint
+double slowThresholdMs = 100.0;
+QString slowLogFile = "srms-slow.log";
+
+QMutex logMutex;
+
+const int MaxCachedFingerprints = 4096;
+
+} // namespace
+
+QString QueryStats::fingerprint(const QString &sql)
+{
+    static const QRegularExpression strings("'(?:[^']|'')*'");
+    static const QRegularExpression numbers("\\b\\d+(?:\\.\\d+)?\\b");
+    static const QRegularExpression spaces("\\s+");
+    static const QRegularExpression tuples("\\((\\?(?:, \\?)*)\\)(?:, \\(\\1\\))+");
+
+    QString text = sql;
+    text.replace(strings, "?");
+    text.replace(numbers, "?");
+    text.replace(spaces, " ");
+    text.replace(tuples, "(\\1), ...");
+    return text.trimmed();
+}
+
+void QueryStats::record(const QString &sql, int binds, qint64 rows, qint64 nanoseconds,
+                        const QString &boundValues)
+{
+    double ms = nanoseconds / 1e6;
+    bool slow = false;
+    QString logFile;
+    QString key;
+    {
+        QMutexLocker lock(&statsMutex);
+
+        // Regex work once per distinct SQL text
+        auto cached = fingerprints.constFind(sql);
+        if (cached != fingerprints.cend()) {
+            key = cached.value();
+        } else {
+            key = fingerprint(sql);
+            if (fingerprints.size() >= MaxCachedFingerprints)
+                fingerprints.clear();
+            fingerprints.insert(sql, key);
+        }
+
+        Entry &entry = entries[key];
+        entry.histogram.record(nanoseconds);
+        entry.rows += quint64(qMax<qint64>(rows, 0));
+        entry.binds += quint64(qMax(binds, 0));
+
+        slow = slowThresholdMs >= 0 && ms >= slowThresholdMs;
+        if (slow) {
+            entry.slow++;
+            logFile = slowLogFile;
+        }
+    }
+
+    if (!slow)
+        return;
+
+    QString line = QString("%1\t%2 ms\trows=%3\tbinds=%4\tthread=%5\t%6")
+                       .arg(QDateTime::currentDateTime().toString(Qt::ISODateWithMs))
+                       .arg(ms, 0, 'f', 3)
+                       .arg(rows)
+                       .arg(binds)
+                       .arg(QThread::currentThread()->objectName())
+                       .arg(sql.simplified());
+    if (!boundValues.isEmpty())
+        line += "\t[" + boundValues + "]";
+
+    qWarning().noquote() << "Slow query:" << line;
+    if (logFile.isEmpty())
+        return;
+
+    QMutexLocker lock(&logMutex);
+    QFile file(logFile);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        file.write(line.toUtf8() + '\n');
+}
+
+QVector<QueryStats::Summary> QueryStats::snapshot()
+{
+    QVector<Summary> summaries;
+    {
+        QMutexLocker lock(&statsMutex);
+        for (auto it = entries.cbegin(); it != entries.cend(); ++it) {
+            const LatencyHistogram &h = it.value().histogram;
+            Summary s;
+            s.fingerprint = it.key();
+            s.calls = h.count();
+            s.rows = it.value().rows;
+            s.binds = it.value().binds;
+            s.slow = it.value().slow;
+            s.p50Ms = h.percentileNs(50) / 1e6;
+            s.p90Ms = h.percentileNs(90) / 1e6;
+            s.p99Ms = h.percentileNs(99) / 1e6;
+            s.maxMs = h.maxNs() / 1e6;
+            s.totalMs = h.totalNs() / 1e6;
+            summaries.append(s);
+        }
+    }
+
+    std::sort(summaries.begin(), summaries.end(), [](const Summary &a, const Summary &b) {
+        return a.totalMs > b.totalMs;
+    });
+    return summaries;
+}
+
+void QueryStats::reset()
+{
+    QMutexLocker lock(&statsMutex);
+    entries.clear();
+}
+
+// =========================================
+// Configuration
+// =========================================
+
+void QueryStats::configure(const QStringList &arguments, const QString &configFile)
+{
+    QString threshold;
+    for (int i = 1; i < arguments.size(); i++) {
+        const QString &arg = arguments[i];
+        if (arg.startsWith("--slow-query-ms="))
+            threshold = arg.mid(QString("--slow-query-ms=").size());
+        else if (arg == "--slow-query-ms" && i + 1 < arguments.size())
+            threshold = arguments[++i];
+    }
+
+    if (QFileInfo::exists(configFile)) {
+        QSettings settings(configFile, QSettings::IniFormat);
+        settings.beginGroup("diagnostics");
+        if (threshold.isEmpty())
+            threshold = settings.value("slow_query_ms").toString();
+        if (settings.contains("slow_query_log"))
+            setSlowQueryLog(settings.value("slow_query_log").toString());
+        settings.endGroup();
+    }
+
+    bool ok = false;
+    double ms = threshold.toDouble(&ok);
+    if (ok)
+        setSlowQueryThresholdMs(ms);
+
+    qInfo().noquote() << QString("Slow query log: %1")
+                             .arg(slowQueryThresholdMs() < 0
+                                      ? QString("off")
+                                      : QString("%1 ms and over to %2")
+                                            .arg(slowQueryThresholdMs())
+                                            .arg(slowQueryLog().isEmpty() ? "the console only"
+                                                                          : slowQueryLog()));
+}
+
+void QueryStats::setSlowQueryThresholdMs(double ms)
+{
+    QMutexLocker lock(&statsMutex);
+    slowThresholdMs = ms;
+}
+
+double QueryStats::slowQueryThresholdMs()
+{
+    QMutexLocker lock(&statsMutex);
+    return slowThresholdMs;
+}
+
+void QueryStats::setSlowQueryLog(const QString &fileName)
+{
+    QMutexLocker lock(&statsMutex);
+    slowLogFile = fileName;
+}
+
+QString QueryStats::slowQueryLog()
+{
+    QMutexLocker lock(&statsMutex);
+    return slowLogFile;
+}
+
+// =========================================
+// Trace
+// =========================================
+
+QueryTrace::QueryTrace(QSqlQuery &query)
+    : q(query),
+      ns(0),
+      started(false),
+      rows(0),
+      binds(0),
+      batch(false)
+{
+}
+
+QueryTrace::~QueryTrace()
+{
+    report();
+}
+
+void QueryTrace::report()
+{
+    if (!started)
+        return;
+
+    // Writes report the rows they changed
+    qint64 counted = rows;
+    if (!batch && !q.isSelect() && q.isActive())
+        counted = qMax(0, q.numRowsAffected());
+
+    // Bound values only matter for the slow log
+    QString values;
+    double threshold = QueryStats::slowQueryThresholdMs();
+    if (threshold >= 0 && ns / 1e6 >= threshold && !batch) {
+        QStringList shown;
+        const QVariantList bound = q.boundValues().values();
+        for (int i = 0; i < bound.size() && i < 10; i++)
+            shown << bound[i].toString().left(40);
+        if (bound.size() > 10)
+            shown << QString("... %1 more").arg(bound.size() - 10);
+        values = shown.join(", ");
+    }
+
+    QueryStats::record(q.lastQuery(), binds, counted, ns, values);
+    started = false;
+}
+
+bool QueryTrace::exec()
+{
+    binds = q.boundValues().size();
+    started = true;
+    ns = 0;
+    timer.start();
+    bool ok = q.exec();
+    ns += timer.nsecsElapsed();
+    return ok;
+}
+
+bool QueryTrace::exec(const QString &sql)
+{
+    started = true;
+    ns = 0;
+    timer.start();
+    bool ok = q.exec(sql);
+    ns += timer.nsecsElapsed();
+    return ok;
+}
+
+// binds counts the values of all rows; rows the rows in the batch
+bool QueryTrace::execBatch()
+{
+    const QVariantList columns = q.boundValues().values();
+    for (const QVariant &column : columns)
+        binds += column.toList().size();
+    rows = columns.isEmpty() ? 0 : columns.first().toList().size();
+    batch = true;
+    started = true;
+    ns = 0;
+    timer.start();
+    bool ok = q.execBatch();
+    ns += timer.nsecsElapsed();
+    return ok;
+}
+
+bool QueryTrace::next()
+{
+    timer.start();
+    bool ok = q.next();
+    ns += timer.nsecsElapsed();
+    if (!ok)
+        return false;
+    rows++;
+    return true;
+}
+
+void QueryTrace::finish()
+{
+    report();
+    q.finish();
+}
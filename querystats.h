@@ -0,0 +1,118 @@
+#ifndef QUERYSTATS_H
+#define QUERYSTATS_H
+
+#include <QSqlQuery>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+
+// Latencies in log-linear buckets, as in HdrHistogram: exact up to 64 us,
+// then every power of two of microseconds is split into 32 buckets, so any
+// percentile is within about 3% of the recorded value up to days, in a
+// fixed 10 KiB however many values are recorded.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(qint64 nanoseconds);
+
+    quint64 count() const;
+    qint64 maxNs() const;
+    qint64 totalNs() const;
+    qint64 percentileNs(double percentile) const;   // 0 .. 100
+
+private:
+    static const int SubBuckets = 32;
+    static const int Magnitudes = 36;
+    static const int Buckets = 2 * SubBuckets + Magnitudes * SubBuckets;
+
+    QVector<quint64> counts;
+    quint64 total;
+    qint64 max;
+    qint64 sum;
+
+    static int bucketOf(qint64 micros);
+    static qint64 valueOf(int bucket);      // upper edge of the bucket, in us
+};
+
+// Process-wide latency statistics per query fingerprint, fed by QueryTrace
+// from every thread, and the slow-query log. A fingerprint is the SQL with
+// literals replaced by ? and repeated VALUES tuples folded, so every
+// batch size of a multi-row INSERT counts as one query.
+//
+// The slow-query threshold and log file come from --slow-query-ms or the
+// [diagnostics] section of srms.ini (slow_query_ms, slow_query_log).
+class QueryStats
+{
+public:
+    struct Summary
+    {
+        QString fingerprint;
+        quint64 calls = 0;
+        quint64 rows = 0;
+        quint64 binds = 0;
+        quint64 slow = 0;
+        double  p50Ms = 0.0;
+        double  p90Ms = 0.0;
+        double  p99Ms = 0.0;
+        double  maxMs = 0.0;
+        double  totalMs = 0.0;
+    };
+
+    static void record(const QString &sql, int binds, qint64 rows, qint64 nanoseconds,
+                       const QString &boundValues = QString());
+
+    // Most total time first
+    static QVector<Summary> snapshot();
+    static void reset();
+
+    static QString fingerprint(const QString &sql);
+
+    static void configure(const QStringList &arguments,
+                          const QString &configFile = "srms.ini");
+    static void setSlowQueryThresholdMs(double ms);     // < 0 disables the log
+    static double slowQueryThresholdMs();
+    static void setSlowQueryLog(const QString &fileName);
+    static QString slowQueryLog();
+};
+
+// Times one statement, counting the rows read through next(), and hands
+// the result to QueryStats when it goes out of scope:
+//
+//     QueryTrace trace(q);
+//     if (!trace.exec()) ...
+//     while (trace.next()) ...
+//
+// Only exec() and each next() are timed, so the work a caller does on
+// each row between two steps does not count as query time. For
+// statements that return no rows, QueryTrace(q).exec() records at the end
+// of the expression. finish() resets the query and records right away.
+class QueryTrace
+{
+public:
+    explicit QueryTrace(QSqlQuery &query);
+    ~QueryTrace();
+
+    bool exec();
+    bool exec(const QString &sql);
+    bool execBatch();
+    bool next();
+    void finish();
+
+private:
+    QSqlQuery &q;
+    QElapsedTimer timer;
+    qint64 ns;                  // inside exec() and next() so far
+    bool started;
+    qint64 rows;
+    int binds;
+    bool batch;
+
+    void report();
+
+    Q_DISABLE_COPY(QueryTrace)
+};
+
+#endif // QUERYSTATS_H
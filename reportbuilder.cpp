@@ -0,0 +1,227 @@
+#include "reportbuilder.h"
+#include "marksnapshot.h"
+#include "markskernels.h"
+
+#include <QReadLocker>
+#include <QElapsedTimer>
+
+#include <algorithm>
+
+QString MarksReport::summary() const
+{
+    QString text = QString("%1 of %2 marks matched, %3 rows in %4 ms")
+                       .arg(matched)
+                       .arg(scanned)
+                       .arg(rows.size())
+                       .arg(elapsedMs, 0, 'f', 1);
+    if (loadMs > 0)
+        text += QString(" (snapshot loaded in %1 ms)").arg(loadMs);
+    return text;
+}
+
+ReportBuilder::ReportBuilder(const QSqlDatabase &database)
+    : db(database),
+      yearValue(0)
+{
+}
+
+ReportBuilder &ReportBuilder::subject(const QString &name)
+{
+    subjectName = name;
+    return *this;
+}
+
+ReportBuilder &ReportBuilder::examType(const QString &name)
+{
+    examName = name;
+    return *this;
+}
+
+ReportBuilder &ReportBuilder::branch(const QString &name)
+{
+    branchName = name;
+    return *this;
+}
+
+ReportBuilder &ReportBuilder::year(int value)
+{
+    yearValue = value;
+    return *this;
+}
+
+bool ReportBuilder::parseGroupBy(const QString &text, GroupBy &by)
+{
+    if (text == "subject")
+        by = BySubject;
+    else if (text == "exam_type" || text == "exam")
+        by = ByExamType;
+    else if (text == "branch")
+        by = ByBranch;
+    else if (text == "year")
+        by = ByYear;
+    else
+        return false;
+    return true;
+}
+
+QString ReportBuilder::lastError() const
+{
+    return error;
+}
+
+// Names to dictionary ids; false when a named value never occurs, so
+// nothing can match
+bool ReportBuilder::resolve(const MarksColumns &columns, MarksKernels::Filter &filter) const
+{
+    filter.year = yearValue;
+    if (!subjectName.isEmpty() && (filter.subject = columns.subjects.id(subjectName)) < 0)
+        return false;
+    if (!examName.isEmpty() && (filter.examType = columns.examTypes.id(examName)) < 0)
+        return false;
+    if (!branchName.isEmpty() && (filter.branch = columns.branches.id(branchName)) < 0)
+        return false;
+    return true;
+}
+
+// =========================================
+// Reports
+// =========================================
+
+bool ReportBuilder::top(int k, MarksReport &report)
+{
+    report = MarksReport();
+    report.columns = QStringList{"rank", "roll_no", "name", "branch", "year", "subject",
+                                 "exam_type", "marks", "max_marks", "pct"};
+
+    const bool loading = !MarksSnapshot::loaded(db);
+    std::shared_ptr<MarksSnapshot> snapshot = MarksSnapshot::acquire(db, &error);
+    if (!snapshot)
+        return false;
+    if (loading)
+        report.loadMs = snapshot->loadMs();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QReadLocker lock(&snapshot->lock());
+    const MarksColumns &c = snapshot->columns();
+    report.scanned = c.rows() - c.removed;
+
+    MarksKernels::Filter filter;
+    if (resolve(c, filter)) {
+        const QVector<int> rows = MarksKernels::select(c, filter);
+        const QVector<float> pct = MarksKernels::percentages(c, rows);
+        report.matched = rows.size();
+
+        int rank = 0;
+        float previous = 0.0f;
+        const QVector<int> best = MarksKernels::topK(pct, k);
+        for (int i = 0; i < best.size(); i++) {
+            const int j = best[i];
+            const int r = rows[j];
+            const int s = c.student[r];
+            if (i == 0 || pct[j] != previous)
+                rank = i + 1;
+            previous = pct[j];
+
+            report.rows.append(QVariantList{
+                rank, c.studentRollNo[s], c.studentName[s], c.branches.name(c.studentBranch[s]),
+                int(c.studentYear[s]), c.subjects.name(c.subject[r]), c.examTypes.name(c.examType[r]),
+                int(c.marks[r]), int(c.maxMarks[r]), double(pct[j])});
+        }
+    }
+
+    report.elapsedMs = timer.nsecsElapsed() / 1e6;
+    return true;
+}
+
+bool ReportBuilder::stats(GroupBy by, MarksReport &report)
+{
+    static const char *const keyColumns[] = {"subject", "exam_type", "branch", "year"};
+
+    report = MarksReport();
+    report.columns = QStringList{keyColumns[by], "marks", "mean_pct", "stddev_pct",
+                                 "min_pct", "max_pct"};
+
+    const bool loading = !MarksSnapshot::loaded(db);
+    std::shared_ptr<MarksSnapshot> snapshot = MarksSnapshot::acquire(db, &error);
+    if (!snapshot)
+        return false;
+    if (loading)
+        report.loadMs = snapshot->loadMs();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QReadLocker lock(&snapshot->lock());
+    const MarksColumns &c = snapshot->columns();
+    report.scanned = c.rows() - c.removed;
+
+    MarksKernels::Filter filter;
+    if (!resolve(c, filter)) {
+        report.elapsedMs = timer.nsecsElapsed() / 1e6;
+        return true;
+    }
+
+    const QVector<int> rows = MarksKernels::select(c, filter);
+    const QVector<float> pct = MarksKernels::percentages(c, rows);
+    report.matched = rows.size();
+
+    // Group key of each selected mark, as a dense id
+    QVector<int> keys(rows.size());
+    int groups = 0;
+    switch (by) {
+    case BySubject:
+        for (int j = 0; j < rows.size(); j++)
+            keys[j] = c.subject[rows[j]];
+        groups = c.subjects.size();
+        break;
+    case ByExamType:
+        for (int j = 0; j < rows.size(); j++)
+            keys[j] = c.examType[rows[j]];
+        groups = c.examTypes.size();
+        break;
+    case ByBranch:
+        for (int j = 0; j < rows.size(); j++)
+            keys[j] = c.studentBranch[c.student[rows[j]]];
+        groups = c.branches.size();
+        break;
+    case ByYear:
+        for (int j = 0; j < rows.size(); j++) {
+            keys[j] = qMax(0, int(c.studentYear[c.student[rows[j]]]));
+            groups = qMax(groups, keys[j] + 1);
+        }
+        break;
+    }
+
+    const QVector<MarksKernels::Moments> moments = MarksKernels::aggregate(keys, pct, groups);
+
+    auto label = [&](int key) -> QVariant {
+        switch (by) {
+        case BySubject:  return c.subjects.name(key);
+        case ByExamType: return c.examTypes.name(key);
+        case ByBranch:   return c.branches.name(key);
+        default:         return key;
+        }
+    };
+
+    QVector<int> present;
+    for (int g = 0; g < groups; g++) {
+        if (moments[g].count > 0)
+            present.append(g);
+    }
+    if (by != ByYear) {
+        std::sort(present.begin(), present.end(), [&](int a, int b) {
+            return label(a).toString() < label(b).toString();
+        });
+    }
+
+    for (int g : present) {
+        const MarksKernels::Moments &m = moments[g];
+        report.rows.append(QVariantList{label(g), m.count, m.mean(), m.stddev(),
+                                        double(m.min), double(m.max)});
+    }
+
+    report.elapsedMs = timer.nsecsElapsed() / 1e6;
+    return true;
+}
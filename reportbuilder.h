@@ -0,0 +1,75 @@
+#ifndef REPORTBUILDER_H
+#define REPORTBUILDER_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+namespace MarksKernels { struct Filter; }
+struct MarksColumns;
+
+// A report as a table: column names and rows of plain values (strings and
+// numbers), for the CLI or a model
+struct MarksReport
+{
+    QStringList columns;
+    QVector<QVariantList> rows;
+    int scanned = 0;            // marks in the snapshot
+    int matched = 0;            // marks that passed the filters
+    double elapsedMs = 0.0;     // filtering and aggregating, not the load
+    qint64 loadMs = 0;          // loading the snapshot, when this report did
+
+    QString summary() const;
+};
+
+// Ad-hoc questions over the marks snapshot (MarksSnapshot), e.g. the top 50
+// in DBMS finals in CSE year 3, or the mean and standard deviation per
+// subject, without writing SQL or scanning marks:
+//
+//   ReportBuilder(db).subject("DBMS").examType("Final").branch("CSE").year(3).top(50, report);
+//   ReportBuilder(db).stats(ReportBuilder::BySubject, report);
+//
+// Percentages are marks / max_marks; marks out of max_marks <= 0 do not
+// count, as for the CGPA. The first report loads the snapshot.
+class ReportBuilder
+{
+public:
+    enum GroupBy {
+        BySubject,
+        ByExamType,
+        ByBranch,
+        ByYear
+    };
+
+    explicit ReportBuilder(const QSqlDatabase &database);
+
+    // Filters; empty / 0 means any
+    ReportBuilder &subject(const QString &name);
+    ReportBuilder &examType(const QString &name);
+    ReportBuilder &branch(const QString &name);
+    ReportBuilder &year(int value);
+
+    // The k highest percentages, ranked (equal percentages share a rank)
+    bool top(int k, MarksReport &report);
+    // Marks, mean, standard deviation, min and max percentage per group
+    bool stats(GroupBy by, MarksReport &report);
+
+    // "subject", "exam_type", "branch" or "year"
+    static bool parseGroupBy(const QString &text, GroupBy &by);
+
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+    QString subjectName;
+    QString examName;
+    QString branchName;
+    int yearValue;
+
+    bool resolve(const MarksColumns &columns, MarksKernels::Filter &filter) const;
+};
+
+#endif // REPORTBUILDER_H
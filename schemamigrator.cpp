@@ -0,0 +1,938 @@
+#include "schemamigrator.h"
+#include "attendancerepository.h"
+#include "attendancebitmap.h"
+#include "dashboardrepository.h"
+#include "studentprofile.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMap>
+#include <QVariant>
+#include <QDebug>
+
+SchemaMigrator::SchemaMigrator(QSqlDatabase &database)
+    : db(database)
+{
+}
+
+// The old table kept one status per (roll_no, subject) and no date. Each
+// subject becomes one session on the day of the upgrade in
+// AttendanceRepository::UndatedPeriod, so nothing is lost and no dates are
+// made up. Rows of deleted students have no ordinal and are dropped.
+//
+// The sessions and their counts are one INSERT ... SELECT (see migration
+// 4); this writes their bitmaps one range of ordinals at a time. A range
+// need not start on a block, so each block is merged with what an earlier
+// range wrote to it.
+static bool convertUndatedAttendance(QSqlDatabase &db, qint64 lo, qint64 hi, QString &error)
+{
+    // The previous step made the only sessions in the undated period
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT s.session_id, o.ordinal, a.status = 'Present' FROM student_ordinals o "
+              "JOIN attendance a ON a.roll_no = o.roll_no "
+              "JOIN attendance_sessions s ON s.subject = a.subject AND s.period = ? "
+              "WHERE o.ordinal >= ? AND o.ordinal < ?");
+    q.addBindValue(AttendanceRepository::UndatedPeriod);
+    q.addBindValue(lo);
+    q.addBindValue(hi);
+    if (!q.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    QMap<qint64, AttendanceBitmap> rosters, present;
+    while (q.next()) {
+        const qint64 session = q.value(0).toLongLong();
+        const int ordinal = q.value(1).toInt();
+        rosters[session].set(ordinal);
+        present[session].set(ordinal, q.value(2).toBool());
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    QSqlQuery read(db);
+    read.prepare("SELECT roster, present FROM attendance_bits WHERE session_id = ? AND block = ?");
+    QSqlQuery write(db);
+    write.prepare("INSERT OR REPLACE INTO attendance_bits (session_id, block, roster, present) "
+                  "VALUES (?, ?, ?, ?)");
+    for (auto it = rosters.begin(); it != rosters.end(); ++it) {
+        AttendanceBitmap &roster = it.value();
+        AttendanceBitmap &attended = present[it.key()];
+        for (int block : roster.blocks()) {
+            read.addBindValue(it.key());
+            read.addBindValue(block);
+            if (!read.exec()) {
+                error = read.lastError().text();
+                return false;
+            }
+            if (read.next()
+                && (!roster.decodeBlock(block, read.value(0).toByteArray())
+                    || !attended.decodeBlock(block, read.value(1).toByteArray()))) {
+                error = QString("Damaged attendance block %1 of session %2").arg(block).arg(it.key());
+                return false;
+            }
+            read.finish();
+
+            write.addBindValue(it.key());
+            write.addBindValue(block);
+            write.addBindValue(roster.encodeBlock(block));
+            // Never NULL, even with nobody present
+            QByteArray presentBlock = attended.encodeBlock(block);
+            write.addBindValue(presentBlock.isNull() ? QByteArray("") : presentBlock);
+            if (!write.exec()) {
+                error = write.lastError().text();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// student_attendance for one range of ordinals: each student's sessions
+// held and attended, counted over the one or two blocks the range falls in.
+// Each block is counted on its own, so a counter spans BlockBits ordinals
+// whatever the block number.
+static bool fillStudentAttendance(QSqlDatabase &db, qint64 lo, qint64 hi, QString &error)
+{
+    QSqlQuery q(db);
+    q.setForwardOnly(true);
+    q.prepare("SELECT block, roster, present FROM attendance_bits WHERE block >= ? AND block <= ?");
+    q.addBindValue(lo / AttendanceBitmap::BlockBits);
+    q.addBindValue((hi - 1) / AttendanceBitmap::BlockBits);
+    if (!q.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    QMap<int, AttendanceCounter> held, attended;
+    while (q.next()) {
+        const int block = q.value(0).toInt();
+        AttendanceBitmap roster, present;
+        if (!roster.decodeBlock(0, q.value(1).toByteArray())
+            || !present.decodeBlock(0, q.value(2).toByteArray())) {
+            error = QString("Damaged attendance block %1").arg(block);
+            return false;
+        }
+        held[block].add(roster);
+        attended[block].add(present, roster);
+    }
+    if (q.lastError().isValid()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    QSqlQuery insert(db);
+    insert.prepare("INSERT OR REPLACE INTO student_attendance (ordinal, held, present) "
+                   "VALUES (?, ?, ?)");
+    for (auto it = held.begin(); it != held.end(); ++it) {
+        const qint64 base = qint64(it.key()) * AttendanceBitmap::BlockBits;
+        const AttendanceCounter &attendedHere = attended[it.key()];
+        for (int offset = 0; offset < it.value().size(); offset++) {
+            const qint64 ordinal = base + offset;
+            if (ordinal < lo || ordinal >= hi || it.value().value(offset) == 0)
+                continue;
+            insert.addBindValue(ordinal);
+            insert.addBindValue(it.value().value(offset));
+            insert.addBindValue(attendedHere.value(offset));
+            if (!insert.exec()) {
+                error = insert.lastError().text();
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Trigger bodies for the class summaries of migration 5. row is new or
+// old, sign 1 or -1; students without a branch or year count under '' / 0.
+static QString classDelta(const QString &row, int sign)
+{
+    return QString("INSERT INTO class_summary (branch, year, students, graded, cgpa_sum) "
+                   "VALUES (COALESCE(%1.branch, ''), COALESCE(%1.year, 0), %2,"
+                   " %2 * (COALESCE(%1.cgpa, 0) > 0), %2 * (CASE WHEN %1.cgpa > 0 THEN %1.cgpa ELSE 0 END)) "
+                   "ON CONFLICT(branch, year) DO UPDATE SET"
+                   " students = students + excluded.students, graded = graded + excluded.graded,"
+                   " cgpa_sum = cgpa_sum + excluded.cgpa_sum; ")
+        .arg(row)
+        .arg(sign);
+}
+
+// The student's results, one per (subject, exam_type) aggregate
+static QString resultsDelta(const QString &row, int sign)
+{
+    return QString("INSERT INTO class_subject_summary (branch, year, subject, results, passed, pct_sum) "
+                   "SELECT COALESCE(%1.branch, ''), COALESCE(%1.year, 0), a.subject,"
+                   " %2 * COUNT(*), %2 * SUM(a.sum_pct >= %3 * a.n), %2 * SUM(a.sum_pct / a.n) "
+                   "FROM marks_agg a WHERE a.roll_no = %1.roll_no AND a.n > 0 GROUP BY a.subject "
+                   "ON CONFLICT(branch, year, subject) DO UPDATE SET"
+                   " results = results + excluded.results, passed = passed + excluded.passed,"
+                   " pct_sum = pct_sum + excluded.pct_sum; ")
+        .arg(row)
+        .arg(sign)
+        .arg(DashboardRepository::PassPercentage);
+}
+
+// A student_attendance row into the band of its class. from joins the
+// row to s, the student.
+static QString attendanceDelta(const QString &row, int sign, const QString &branchYear,
+                               const QString &from)
+{
+    return QString("INSERT INTO class_attendance_summary (branch, year, band, students, held, present) "
+                   "SELECT %3, MIN(%4, %1.present * %5 / %1.held), %2, %2 * %1.held, %2 * %1.present "
+                   "%6 AND %1.held > 0 "
+                   "ON CONFLICT(branch, year, band) DO UPDATE SET"
+                   " students = students + excluded.students, held = held + excluded.held,"
+                   " present = present + excluded.present; ")
+        .arg(row)
+        .arg(sign)
+        .arg(branchYear)
+        .arg(DashboardRepository::AttendanceBands - 1)
+        .arg(DashboardRepository::AttendanceBands)
+        .arg(from);
+}
+
+// A student's attendance totals, when the student row changes
+static QString studentAttendanceDelta(const QString &row, int sign)
+{
+    return attendanceDelta("a", sign,
+                           QString("COALESCE(%1.branch, ''), COALESCE(%1.year, 0)").arg(row),
+                           QString("FROM student_ordinals o "
+                                   "JOIN student_attendance a ON a.ordinal = o.ordinal "
+                                   "WHERE o.roll_no = %1.roll_no").arg(row));
+}
+
+// A change of the totals, in the class of the student they belong to
+static QString totalsDelta(const QString &row, int sign)
+{
+    return attendanceDelta(row, sign, "COALESCE(s.branch, ''), COALESCE(s.year, 0)",
+                           QString("FROM student_ordinals o "
+                                   "JOIN students s ON s.roll_no = o.roll_no "
+                                   "WHERE o.ordinal = %1.ordinal").arg(row));
+}
+
+// =========================================
+// Migrations
+// =========================================
+
+// Append new migrations at the end and never edit one that has shipped:
+// databases in the field only run the versions above their user_version.
+QList<SchemaMigrator::Migration> SchemaMigrator::migrations() const
+{
+    return {
+        // 1: indexes for the per-student lookups and the attendance joins
+        {1, {
+            // Attendance is saved with an UPSERT keyed on (roll_no, subject).
+            // Older databases may hold duplicates, keep the newest row. The
+            // helper index keeps each chunk's EXISTS probe a lookup.
+            statementStep("attendance dedupe index",
+                          {"CREATE INDEX IF NOT EXISTS idx_attendance_dedupe "
+                           "ON attendance (roll_no, subject, attendance_id)"}),
+            chunkedStep("drop duplicate attendance rows", "attendance",
+                        "DELETE FROM attendance "
+                        "WHERE attendance_id >= :lo AND attendance_id < :hi "
+                        "AND EXISTS (SELECT 1 FROM attendance newer "
+                        " WHERE newer.roll_no = attendance.roll_no "
+                        " AND newer.subject = attendance.subject "
+                        " AND newer.attendance_id > attendance.attendance_id)",
+                        20000),
+            statementStep("indexes",
+                          {"CREATE UNIQUE INDEX IF NOT EXISTS idx_attendance_roll_subject "
+                           "ON attendance (roll_no, subject)",
+                           "DROP INDEX IF EXISTS idx_attendance_dedupe",
+                           // Covers the marks and CGPA reads (mark_id is the rowid)
+                           "CREATE INDEX IF NOT EXISTS idx_marks_roll_subject "
+                           "ON marks (roll_no, subject, exam_type, marks, max_marks)",
+                           "CREATE INDEX IF NOT EXISTS idx_students_branch_year "
+                           "ON students (branch, year)"})
+        }},
+
+        // 2: teacher search. Prefix matches go through the roll_no primary
+        // key and a case-insensitive name index; substring and fuzzy matches
+        // through a trigram FTS5 index kept in sync by triggers. SQLite
+        // builds without FTS5 or the trigram tokenizer skip the index and
+        // search falls back to LIKE.
+        {2, {
+            statementStep("student name index",
+                          {"CREATE INDEX IF NOT EXISTS idx_students_name "
+                           "ON students (name COLLATE NOCASE)"}),
+            optionalStep("student search index",
+                         {"CREATE VIRTUAL TABLE IF NOT EXISTS students_fts USING fts5("
+                          "roll_no, name, email, "
+                          "content='students', content_rowid='rowid', tokenize='trigram')",
+                          "CREATE TRIGGER IF NOT EXISTS students_fts_insert "
+                          "AFTER INSERT ON students BEGIN "
+                          " INSERT INTO students_fts (rowid, roll_no, name, email) "
+                          " VALUES (new.rowid, new.roll_no, new.name, new.email); "
+                          "END",
+                          "CREATE TRIGGER IF NOT EXISTS students_fts_delete "
+                          "AFTER DELETE ON students BEGIN "
+                          " INSERT INTO students_fts (students_fts, rowid, roll_no, name, email) "
+                          " VALUES ('delete', old.rowid, old.roll_no, old.name, old.email); "
+                          "END",
+                          // CGPA updates do not touch the index
+                          "CREATE TRIGGER IF NOT EXISTS students_fts_update "
+                          "AFTER UPDATE OF roll_no, name, email ON students BEGIN "
+                          " INSERT INTO students_fts (students_fts, rowid, roll_no, name, email) "
+                          " VALUES ('delete', old.rowid, old.roll_no, old.name, old.email); "
+                          " INSERT INTO students_fts (rowid, roll_no, name, email) "
+                          " VALUES (new.rowid, new.roll_no, new.name, new.email); "
+                          "END",
+                          "INSERT INTO students_fts (students_fts) VALUES ('rebuild')"})
+        }},
+
+        // 3: running sums of mark percentages, maintained by MarksRepository
+        // in the same transaction as each marks write, so the CGPA is read
+        // in O(1) and students.cgpa is always current. Marks with
+        // max_marks <= 0 do not count, as before.
+        {3, {
+            statementStep("marks aggregate tables",
+                          {"CREATE TABLE IF NOT EXISTS marks_agg ("
+                           " roll_no TEXT NOT NULL,"
+                           " subject TEXT NOT NULL,"
+                           " exam_type TEXT NOT NULL,"
+                           " sum_pct REAL NOT NULL DEFAULT 0,"
+                           " n INTEGER NOT NULL DEFAULT 0,"
+                           " PRIMARY KEY (roll_no, subject, exam_type)) WITHOUT ROWID",
+                           "CREATE TABLE IF NOT EXISTS cgpa_totals ("
+                           " roll_no TEXT PRIMARY KEY,"
+                           " sum_pct REAL NOT NULL DEFAULT 0,"
+                           " n INTEGER NOT NULL DEFAULT 0) WITHOUT ROWID"}),
+            statementStep("backfill marks aggregates",
+                          {"DELETE FROM marks_agg",
+                           "DELETE FROM cgpa_totals",
+                           "INSERT INTO marks_agg (roll_no, subject, exam_type, sum_pct, n) "
+                           "SELECT roll_no, COALESCE(subject, ''), COALESCE(exam_type, ''),"
+                           " SUM(marks * 100.0 / max_marks), COUNT(*) "
+                           "FROM marks WHERE roll_no IS NOT NULL AND max_marks > 0 "
+                           "GROUP BY 1, 2, 3",
+                           "INSERT INTO cgpa_totals (roll_no, sum_pct, n) "
+                           "SELECT roll_no, SUM(sum_pct), SUM(n) FROM marks_agg GROUP BY roll_no",
+                           "UPDATE students SET cgpa = COALESCE("
+                           " (SELECT c.sum_pct / c.n / 10.0 FROM cgpa_totals c"
+                           "  WHERE c.roll_no = students.roll_no AND c.n > 0), 0.0)"})
+        }},
+
+        // 4: dated attendance sessions, see AttendanceRepository. Every
+        // student gets a small fixed ordinal that indexes the session
+        // bitmaps; ordinals are never reused. The undated attendance table
+        // is converted and then left alone.
+        {4, {
+            statementStep("student ordinals",
+                          {"CREATE TABLE IF NOT EXISTS student_ordinals ("
+                           " ordinal INTEGER PRIMARY KEY,"
+                           " roll_no TEXT NOT NULL UNIQUE)",
+                           "INSERT OR IGNORE INTO student_ordinals (roll_no) "
+                           "SELECT roll_no FROM students ORDER BY roll_no",
+                           "CREATE TRIGGER IF NOT EXISTS students_ordinal_insert "
+                           "AFTER INSERT ON students BEGIN "
+                           " INSERT OR IGNORE INTO student_ordinals (roll_no) VALUES (new.roll_no); "
+                           "END"}),
+            statementStep("attendance session tables",
+                          {"CREATE TABLE IF NOT EXISTS attendance_sessions ("
+                           " session_id INTEGER PRIMARY KEY,"
+                           " subject TEXT NOT NULL,"
+                           " session_date TEXT NOT NULL,"      // yyyy-MM-dd
+                           " period INTEGER NOT NULL,"
+                           " held INTEGER NOT NULL DEFAULT 0,"
+                           " present INTEGER NOT NULL DEFAULT 0,"
+                           " UNIQUE (subject, session_date, period))",
+                           "CREATE INDEX IF NOT EXISTS idx_attendance_sessions_date "
+                           "ON attendance_sessions (session_date)",
+                           "CREATE TABLE IF NOT EXISTS attendance_bits ("
+                           " session_id INTEGER NOT NULL,"
+                           " block INTEGER NOT NULL,"
+                           " roster BLOB NOT NULL,"
+                           " present BLOB NOT NULL,"
+                           " PRIMARY KEY (session_id, block)) WITHOUT ROWID",
+                           "CREATE INDEX IF NOT EXISTS idx_attendance_bits_block "
+                           "ON attendance_bits (block, session_id)"}),
+            statementStep("undated attendance sessions",
+                          {QString("INSERT OR IGNORE INTO attendance_sessions "
+                                   "(subject, session_date, period, held, present) "
+                                   "SELECT a.subject, date('now', 'localtime'), %1,"
+                                   " COUNT(*), SUM(a.status = 'Present') "
+                                   "FROM attendance a JOIN student_ordinals o ON o.roll_no = a.roll_no "
+                                   "WHERE a.subject IS NOT NULL AND a.subject <> '' "
+                                   "GROUP BY a.subject")
+                               .arg(AttendanceRepository::UndatedPeriod)}),
+            chunkedStep("convert undated attendance", "student_ordinals",
+                        convertUndatedAttendance, AttendanceBitmap::BlockBits)
+        }},
+
+        // 5: class dashboards, see DashboardRepository. student_attendance
+        // holds each student's sessions over all subjects, kept by
+        // AttendanceRepository::save(). Triggers carry student and
+        // attendance changes into the class summaries; the results follow
+        // marks_agg through MarksRepository. The triggers come after the
+        // fill: student_attendance a range of ordinals at a time, then the
+        // summaries as one GROUP BY each.
+        {5, {
+            statementStep("class summary tables",
+                          {"CREATE TABLE IF NOT EXISTS student_attendance ("
+                           " ordinal INTEGER PRIMARY KEY,"
+                           " held INTEGER NOT NULL DEFAULT 0,"
+                           " present INTEGER NOT NULL DEFAULT 0)",
+                           "CREATE TABLE IF NOT EXISTS class_summary ("
+                           " branch TEXT NOT NULL,"
+                           " year INTEGER NOT NULL,"
+                           " students INTEGER NOT NULL DEFAULT 0,"
+                           " graded INTEGER NOT NULL DEFAULT 0,"
+                           " cgpa_sum REAL NOT NULL DEFAULT 0,"
+                           " PRIMARY KEY (branch, year)) WITHOUT ROWID",
+                           "CREATE TABLE IF NOT EXISTS class_subject_summary ("
+                           " branch TEXT NOT NULL,"
+                           " year INTEGER NOT NULL,"
+                           " subject TEXT NOT NULL,"
+                           " results INTEGER NOT NULL DEFAULT 0,"
+                           " passed INTEGER NOT NULL DEFAULT 0,"
+                           " pct_sum REAL NOT NULL DEFAULT 0,"
+                           " PRIMARY KEY (branch, year, subject)) WITHOUT ROWID",
+                           "CREATE TABLE IF NOT EXISTS class_attendance_summary ("
+                           " branch TEXT NOT NULL,"
+                           " year INTEGER NOT NULL,"
+                           " band INTEGER NOT NULL,"
+                           " students INTEGER NOT NULL DEFAULT 0,"
+                           " held INTEGER NOT NULL DEFAULT 0,"
+                           " present INTEGER NOT NULL DEFAULT 0,"
+                           " PRIMARY KEY (branch, year, band)) WITHOUT ROWID"}),
+            chunkedStep("fill student attendance", "student_ordinals",
+                        fillStudentAttendance, AttendanceBitmap::BlockBits),
+            statementStep("fill class summaries",
+                          {"DELETE FROM class_summary",
+                           "INSERT INTO class_summary (branch, year, students, graded, cgpa_sum) "
+                           "SELECT COALESCE(branch, ''), COALESCE(year, 0), COUNT(*),"
+                           " SUM(COALESCE(cgpa, 0) > 0), TOTAL(CASE WHEN cgpa > 0 THEN cgpa END) "
+                           "FROM students GROUP BY 1, 2",
+                           "DELETE FROM class_subject_summary",
+                           QString("INSERT INTO class_subject_summary "
+                                   "(branch, year, subject, results, passed, pct_sum) "
+                                   "SELECT COALESCE(s.branch, ''), COALESCE(s.year, 0), a.subject,"
+                                   " COUNT(*), SUM(a.sum_pct >= %1 * a.n), SUM(a.sum_pct / a.n) "
+                                   "FROM marks_agg a JOIN students s ON s.roll_no = a.roll_no "
+                                   "WHERE a.n > 0 GROUP BY 1, 2, 3")
+                               .arg(DashboardRepository::PassPercentage),
+                           "DELETE FROM class_attendance_summary",
+                           QString("INSERT INTO class_attendance_summary "
+                                   "(branch, year, band, students, held, present) "
+                                   "SELECT COALESCE(s.branch, ''), COALESCE(s.year, 0),"
+                                   " MIN(%1, a.present * %2 / a.held), COUNT(*), SUM(a.held), SUM(a.present) "
+                                   "FROM student_attendance a "
+                                   "JOIN student_ordinals o ON o.ordinal = a.ordinal "
+                                   "JOIN students s ON s.roll_no = o.roll_no "
+                                   "WHERE a.held > 0 GROUP BY 1, 2, 3")
+                               .arg(DashboardRepository::AttendanceBands - 1)
+                               .arg(DashboardRepository::AttendanceBands)}),
+            statementStep("class summary triggers",
+                          {"CREATE TRIGGER IF NOT EXISTS class_summary_student_insert "
+                           "AFTER INSERT ON students BEGIN "
+                           + classDelta("new", 1) + resultsDelta("new", 1)
+                           + studentAttendanceDelta("new", 1) +
+                           "END",
+                           "CREATE TRIGGER IF NOT EXISTS class_summary_student_delete "
+                           "AFTER DELETE ON students BEGIN "
+                           + classDelta("old", -1) + resultsDelta("old", -1)
+                           + studentAttendanceDelta("old", -1) +
+                           "END",
+                           // Fires for every CGPA store, so it only touches
+                           // class_summary
+                           "CREATE TRIGGER IF NOT EXISTS class_summary_student_update "
+                           "AFTER UPDATE OF cgpa, branch, year ON students BEGIN "
+                           + classDelta("old", -1) + classDelta("new", 1) +
+                           "END",
+                           "CREATE TRIGGER IF NOT EXISTS class_summary_student_move "
+                           "AFTER UPDATE OF branch, year ON students "
+                           "WHEN COALESCE(old.branch, '') <> COALESCE(new.branch, '') "
+                           " OR COALESCE(old.year, 0) <> COALESCE(new.year, 0) BEGIN "
+                           + resultsDelta("old", -1) + resultsDelta("new", 1)
+                           + studentAttendanceDelta("old", -1) + studentAttendanceDelta("new", 1) +
+                           "END",
+                           "CREATE TRIGGER IF NOT EXISTS class_summary_attendance_insert "
+                           "AFTER INSERT ON student_attendance BEGIN "
+                           + totalsDelta("new", 1) +
+                           "END",
+                           "CREATE TRIGGER IF NOT EXISTS class_summary_attendance_update "
+                           "AFTER UPDATE ON student_attendance BEGIN "
+                           + totalsDelta("old", -1) + totalsDelta("new", 1) +
+                           "END",
+                           "CREATE TRIGGER IF NOT EXISTS class_summary_attendance_delete "
+                           "AFTER DELETE ON student_attendance BEGIN "
+                           + totalsDelta("old", -1) +
+                           "END"})
+        }},
+
+        // 6: class ranks, see CohortRanking. A cohort is read as one range
+        // of this index, which also covers the averages.
+        {6, {
+            statementStep("cohort index",
+                          {"CREATE INDEX IF NOT EXISTS idx_marks_agg_cohort "
+                           "ON marks_agg (subject, exam_type, sum_pct, n)"})
+        }},
+
+        // 7: the search index of migration 2 keyed on student ordinals
+        // instead of the implicit rowid of students, which VACUUM may
+        // renumber. It reads its content through a view joining the two;
+        // the insert trigger makes the ordinal itself, as trigger order is
+        // not defined.
+        {7, {
+            optionalStep("student search index by ordinal",
+                         {"DROP TRIGGER IF EXISTS students_fts_insert",
+                          "DROP TRIGGER IF EXISTS students_fts_delete",
+                          "DROP TRIGGER IF EXISTS students_fts_update",
+                          "DROP TABLE IF EXISTS students_fts",
+                          "CREATE VIEW IF NOT EXISTS students_search AS "
+                          "SELECT o.ordinal, s.roll_no, s.name, s.email FROM student_ordinals o "
+                          "JOIN students s ON s.roll_no = o.roll_no",
+                          "CREATE VIRTUAL TABLE students_fts USING fts5("
+                          "roll_no, name, email, "
+                          "content='students_search', content_rowid='ordinal', tokenize='trigram')",
+                          "CREATE TRIGGER students_fts_insert "
+                          "AFTER INSERT ON students BEGIN "
+                          " INSERT OR IGNORE INTO student_ordinals (roll_no) VALUES (new.roll_no); "
+                          " INSERT INTO students_fts (rowid, roll_no, name, email) "
+                          " SELECT ordinal, new.roll_no, new.name, new.email "
+                          " FROM student_ordinals WHERE roll_no = new.roll_no; "
+                          "END",
+                          "CREATE TRIGGER students_fts_delete "
+                          "AFTER DELETE ON students BEGIN "
+                          " INSERT INTO students_fts (students_fts, rowid, roll_no, name, email) "
+                          " SELECT 'delete', ordinal, old.roll_no, old.name, old.email "
+                          " FROM student_ordinals WHERE roll_no = old.roll_no; "
+                          "END",
+                          "CREATE TRIGGER students_fts_update "
+                          "AFTER UPDATE OF roll_no, name, email ON students BEGIN "
+                          " INSERT INTO students_fts (students_fts, rowid, roll_no, name, email) "
+                          " SELECT 'delete', ordinal, old.roll_no, old.name, old.email "
+                          " FROM student_ordinals WHERE roll_no = old.roll_no; "
+                          " INSERT OR IGNORE INTO student_ordinals (roll_no) VALUES (new.roll_no); "
+                          " INSERT INTO students_fts (rowid, roll_no, name, email) "
+                          " SELECT ordinal, new.roll_no, new.name, new.email "
+                          " FROM student_ordinals WHERE roll_no = new.roll_no; "
+                          "END",
+                          "INSERT INTO students_fts (students_fts) VALUES ('rebuild')"})
+        }}
+    };
+}
+
+SchemaMigrator::Step SchemaMigrator::statementStep(const QString &description,
+                                                   const QStringList &statements)
+{
+    return {description, statements, QString(), QString(), 0, false, nullptr};
+}
+
+SchemaMigrator::Step SchemaMigrator::optionalStep(const QString &description,
+                                                  const QStringList &statements)
+{
+    return {description, statements, QString(), QString(), 0, true, nullptr};
+}
+
+SchemaMigrator::Step SchemaMigrator::chunkedStep(const QString &description,
+                                                 const QString &table,
+                                                 const QString &sql,
+                                                 int chunkSize)
+{
+    return {description, QStringList(), table, sql, chunkSize, false, nullptr};
+}
+
+SchemaMigrator::Step SchemaMigrator::chunkedStep(const QString &description,
+                                                 const QString &table,
+                                                 const ChunkCode &code,
+                                                 int chunkSize)
+{
+    return {description, QStringList(), table, QString(), chunkSize, false, code};
+}
+
+// =========================================
+// Public API
+// =========================================
+
+bool SchemaMigrator::migrate()
+{
+    if (!createBaseTables())
+        return false;
+
+    int version = currentVersion();
+    for (const Migration &migration : migrations()) {
+        if (migration.version <= version)
+            continue;
+        if (!applyMigration(migration))
+            return false;
+    }
+    return true;
+}
+
+int SchemaMigrator::currentVersion()
+{
+    QSqlQuery q(db);
+    if (q.exec("PRAGMA user_version") && q.next())
+        return q.value(0).toInt();
+    return 0;
+}
+
+int SchemaMigrator::latestVersion() const
+{
+    QList<Migration> all = migrations();
+    return all.isEmpty() ? 0 : all.last().version;
+}
+
+QString SchemaMigrator::lastError() const
+{
+    return error;
+}
+
+// The table a full-scan row of EXPLAIN QUERY PLAN reads, as named in the
+// query (its alias if any), or empty for any other row. SQLite before 3.36,
+// which Qt5 often bundles, writes "SCAN TABLE students AS s" where newer
+// ones write "SCAN s", so both are read. SEARCH rows are index lookups and
+// never count.
+static QString scannedTable(const QString &detail)
+{
+    const QStringList words = detail.split(' ');
+    int i = 1;
+    if (words.size() < 2 || words[0] != "SCAN")
+        return QString();
+    if (words[i] == "TABLE" && words.size() > 2)
+        i++;
+    if (i + 2 < words.size() && words[i + 1] == "AS")
+        return words[i + 2];
+    return words[i];
+}
+
+// The hot per-student and per-subject queries must be index lookups. A
+// "SCAN" of one of the listed tables means an index went missing or the
+// planner stopped using it, which is reported instead of silently slowing down.
+bool SchemaMigrator::verifyQueryPlans(QStringList &regressions)
+{
+    struct PlanCheck {
+        QString name;
+        QString sql;
+        int bindCount;
+        QStringList searchedTables;   // as named in the plan (alias if any)
+    };
+
+    const QList<PlanCheck> checks = {
+        {"student marks",
+         "SELECT mark_id, subject, marks, max_marks, exam_type FROM marks WHERE roll_no = ?",
+         1, {"marks"}},
+        {"CGPA",
+         "SELECT sum_pct, n FROM cgpa_totals WHERE roll_no = ?",
+         1, {"cgpa_totals"}},
+        {"student page",
+         "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students "
+         "WHERE roll_no > ? ORDER BY roll_no LIMIT ?",
+         2, {"students"}},
+        {"student name prefix",
+         "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students "
+         "WHERE name >= ? COLLATE NOCASE AND name < ? COLLATE NOCASE "
+         "ORDER BY name COLLATE NOCASE LIMIT ?",
+         3, {"students"}},
+        {"student attendance",
+         "SELECT s.subject, b.roster, b.present FROM attendance_bits b "
+         "CROSS JOIN attendance_sessions s ON s.session_id = b.session_id "
+         "WHERE b.block = ?",
+         1, {"b", "s"}},
+        {"attendance session",
+         "SELECT session_id FROM attendance_sessions "
+         "WHERE subject = ? AND session_date = ? AND period = ?",
+         3, {"attendance_sessions"}},
+        {"session bitmaps",
+         "SELECT block, roster, present FROM attendance_bits WHERE session_id = ?",
+         1, {"attendance_bits"}},
+        {"class roster",
+         "SELECT s.roll_no, s.name, s.branch, s.year, o.ordinal "
+         "FROM students s JOIN student_ordinals o ON o.roll_no = s.roll_no "
+         "WHERE 1=1 AND s.branch = ? AND s.year = ? ORDER BY s.roll_no",
+         2, {"s", "o"}},
+        {"class subjects",
+         "SELECT subject, results, passed, pct_sum FROM class_subject_summary "
+         "WHERE branch = ? AND year = ? AND results > 0 ORDER BY subject",
+         2, {"class_subject_summary"}},
+        {"subject cohort",
+         "SELECT a.sum_pct / a.n FROM marks_agg a JOIN students s ON s.roll_no = a.roll_no "
+         "WHERE a.subject = ? AND a.exam_type = ? AND a.n > 0",
+         2, {"a", "s"}},
+        {"student profile", StudentProfileRepository::query(),
+         1, {"s", "o", "m", "a", "b", "t"}}
+    };
+
+    regressions.clear();
+    for (const PlanCheck &check : checks) {
+        QSqlQuery q(db);
+        if (!q.prepare("EXPLAIN QUERY PLAN " + check.sql)) {
+            regressions << QString("%1: %2").arg(check.name, q.lastError().text());
+            continue;
+        }
+        for (int i = 0; i < check.bindCount; i++)
+            q.addBindValue(QString());
+        if (!q.exec()) {
+            regressions << QString("%1: %2").arg(check.name, q.lastError().text());
+            continue;
+        }
+
+        // Columns: id, parent, notused, detail
+        while (q.next()) {
+            QString detail = q.value(3).toString();
+            if (check.searchedTables.contains(scannedTable(detail)))
+                regressions << QString("%1: %2").arg(check.name, detail);
+        }
+    }
+
+    return regressions.isEmpty();
+}
+
+// =========================================
+// Base schema
+// =========================================
+
+bool SchemaMigrator::createBaseTables()
+{
+    const QStringList tables = {
+        // Users table: user_id = roll_no for students, anything for teachers
+        "CREATE TABLE IF NOT EXISTS users ("
+        " user_id TEXT PRIMARY KEY,"
+        " username TEXT UNIQUE,"
+        " password TEXT NOT NULL,"
+        " role TEXT NOT NULL,"         // 'TEACHER' or 'STUDENT'
+        " email TEXT)",
+
+        // Students table
+        "CREATE TABLE IF NOT EXISTS students ("
+        " roll_no TEXT PRIMARY KEY,"
+        " name TEXT,"
+        " email TEXT,"
+        " branch TEXT,"
+        " year INTEGER,"
+        " gender TEXT,"
+        " cgpa REAL DEFAULT 0.0)",
+
+        // Marks table
+        "CREATE TABLE IF NOT EXISTS marks ("
+        " mark_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        " roll_no TEXT,"
+        " subject TEXT,"
+        " marks INTEGER,"
+        " max_marks INTEGER,"
+        " exam_type TEXT)",
+
+        // Attendance table
+        "CREATE TABLE IF NOT EXISTS attendance ("
+        " attendance_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        " roll_no TEXT,"
+        " subject TEXT,"
+        " status TEXT)",
+
+        // Migration bookkeeping: one row per step, cursor is the next rowid
+        // a chunked step will process
+        "CREATE TABLE IF NOT EXISTS schema_migration_steps ("
+        " version INTEGER NOT NULL,"
+        " step INTEGER NOT NULL,"
+        " description TEXT,"
+        " cursor INTEGER DEFAULT 0,"
+        " done INTEGER DEFAULT 0,"
+        " started_at TEXT,"
+        " finished_at TEXT,"
+        " duration_ms INTEGER DEFAULT 0,"
+        " PRIMARY KEY (version, step))"
+    };
+
+    QSqlQuery q(db);
+    for (const QString &sql : tables) {
+        if (!q.exec(sql)) {
+            error = q.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+// =========================================
+// Applying migrations
+// =========================================
+
+bool SchemaMigrator::applyMigration(const Migration &migration)
+{
+    // Steps finished by an earlier, interrupted run are skipped and chunked
+    // steps continue from their saved cursor.
+    QHash<int, qint64> cursors;
+    QHash<int, bool> finished;
+
+    QSqlQuery q(db);
+    q.prepare("SELECT step, cursor, done FROM schema_migration_steps WHERE version = ?");
+    q.addBindValue(migration.version);
+    if (q.exec()) {
+        while (q.next()) {
+            cursors.insert(q.value(0).toInt(), q.value(1).toLongLong());
+            finished.insert(q.value(0).toInt(), q.value(2).toInt() != 0);
+        }
+    }
+    q.finish();
+
+    QElapsedTimer total;
+    total.start();
+
+    for (int i = 0; i < migration.steps.size(); i++) {
+        const Step &step = migration.steps[i];
+        if (finished.value(i, false))
+            continue;
+
+        bool ok = step.chunkTable.isEmpty()
+                      ? runStatements(migration, i, step)
+                      : runChunked(migration, i, step, cursors.value(i, 0));
+        if (!ok && step.optional) {
+            qWarning() << "Schema migration" << migration.version
+                       << "skipped optional step" << i << step.description << ":" << error;
+            error.clear();
+            if (!recordStep(migration.version, i, step.description + " (skipped)", 0, true, 0))
+                return false;
+            continue;
+        }
+        if (!ok) {
+            qCritical() << "Schema migration" << migration.version
+                        << "step" << i << step.description << "failed:" << error;
+            return false;
+        }
+    }
+
+    if (!q.exec(QString("PRAGMA user_version = %1").arg(migration.version))) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    qInfo() << "Applied schema migration" << migration.version
+            << "in" << total.elapsed() << "ms";
+    return true;
+}
+
+bool SchemaMigrator::runStatements(const Migration &migration, int index, const Step &step)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!db.transaction()) {
+        error = db.lastError().text();
+        return false;
+    }
+
+    QSqlQuery q(db);
+    for (const QString &sql : step.statements) {
+        if (!q.exec(sql)) {
+            error = q.lastError().text();
+            db.rollback();
+            return false;
+        }
+    }
+
+    qint64 elapsed = timer.elapsed();
+    if (!recordStep(migration.version, index, step.description, 0, true, elapsed)
+        || !db.commit()) {
+        if (error.isEmpty())
+            error = db.lastError().text();
+        db.rollback();
+        return false;
+    }
+
+    qInfo() << "Migration" << migration.version << "step" << index
+            << step.description << "took" << elapsed << "ms";
+    return true;
+}
+
+bool SchemaMigrator::runChunked(const Migration &migration, int index, const Step &step,
+                                qint64 cursor)
+{
+    QSqlQuery q(db);
+    qint64 maxRowId = 0;
+    qint64 minRowId = 0;
+    if (q.exec(QString("SELECT MIN(rowid), MAX(rowid) FROM %1").arg(step.chunkTable)) && q.next()) {
+        minRowId = q.value(0).toLongLong();
+        maxRowId = q.value(1).toLongLong();
+    }
+    q.finish();
+
+    qint64 lo = qMax(cursor, minRowId);
+    qint64 totalMs = 0;
+    int chunks = 0;
+
+    // Each chunk commits together with its cursor, so the table is only
+    // write-locked for one chunk at a time and a crash loses at most one.
+    do {
+        QElapsedTimer timer;
+        timer.start();
+
+        qint64 hi = lo + step.chunkSize;
+        bool done = hi > maxRowId;
+
+        if (!db.transaction()) {
+            error = db.lastError().text();
+            return false;
+        }
+
+        if (step.chunkCode) {
+            if (!step.chunkCode(db, lo, hi, error)) {
+                db.rollback();
+                return false;
+            }
+        } else {
+            q.prepare(step.chunkSql);
+            q.bindValue(":lo", lo);
+            q.bindValue(":hi", hi);
+            if (!q.exec()) {
+                error = q.lastError().text();
+                db.rollback();
+                return false;
+            }
+            q.finish();
+        }
+
+        qint64 elapsed = timer.elapsed();
+        if (!recordStep(migration.version, index, step.description, hi, done, elapsed)
+            || !db.commit()) {
+            if (error.isEmpty())
+                error = db.lastError().text();
+            db.rollback();
+            return false;
+        }
+
+        totalMs += elapsed;
+        chunks++;
+        lo = hi;
+    } while (lo <= maxRowId);
+
+    qInfo() << "Migration" << migration.version << "step" << index
+            << step.description << "took" << totalMs << "ms over" << chunks << "chunks";
+    return true;
+}
+
+bool SchemaMigrator::recordStep(int version, int index, const QString &description,
+                                qint64 cursor, bool done, qint64 elapsedMs)
+{
+    QString now = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+
+    QSqlQuery q(db);
+    q.prepare("INSERT INTO schema_migration_steps "
+              "(version, step, description, cursor, done, started_at, finished_at, duration_ms) "
+              "VALUES (?, ?, ?, ?, ?, ?, ?, ?) "
+              "ON CONFLICT(version, step) DO UPDATE SET "
+              " cursor = excluded.cursor,"
+              " done = excluded.done,"
+              " finished_at = excluded.finished_at,"
+              " duration_ms = duration_ms + excluded.duration_ms");
+    q.addBindValue(version);
+    q.addBindValue(index);
+    q.addBindValue(description);
+    q.addBindValue(cursor);
+    q.addBindValue(done ? 1 : 0);
+    q.addBindValue(now);
+    q.addBindValue(done ? QVariant(now) : QVariant());
+    q.addBindValue(elapsedMs);
+
+    if (!q.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#ifndef SCHEMAMIGRATOR_H
+#define SCHEMAMIGRATOR_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QStringList>
+#include <QList>
+
+#include <functional>
+
+// Owns the database schema. The base tables are created on every start,
+// everything after that is a numbered migration tracked in PRAGMA
+// user_version. Progress of each step is kept in schema_migration_steps, so
+// a migration interrupted by a crash resumes where it stopped.
+class SchemaMigrator
+{
+public:
+    explicit SchemaMigrator(QSqlDatabase &database);
+
+    bool migrate();
+
+    // EXPLAIN QUERY PLAN over the hot queries; false if any of them scans
+    // a table it should search through an index
+    bool verifyQueryPlans(QStringList &regressions);
+
+    int currentVersion();
+    int latestVersion() const;
+    QString lastError() const;
+
+private:
+    // A step either runs its statements in one transaction, or, when
+    // chunkTable is set, runs chunkSql (or chunkCode) once per rowid range
+    // [:lo, :hi) of that table, committing the cursor with every chunk. An
+    // optional step that fails (e.g. a missing SQLite extension) is logged
+    // and skipped.
+    using ChunkCode = std::function<bool(QSqlDatabase &db, qint64 lo, qint64 hi, QString &error)>;
+
+    struct Step {
+        QString     description;
+        QStringList statements;
+        QString     chunkTable;
+        QString     chunkSql;
+        int         chunkSize;
+        bool        optional;
+        ChunkCode   chunkCode;
+    };
+
+    struct Migration {
+        int         version;
+        QList<Step> steps;
+    };
+
+    QSqlDatabase &db;
+    QString error;
+
+    QList<Migration> migrations() const;
+
+    bool createBaseTables();
+    bool applyMigration(const Migration &migration);
+    bool runStatements(const Migration &migration, int index, const Step &step);
+    bool runChunked(const Migration &migration, int index, const Step &step,
+                    qint64 cursor);
+    bool recordStep(int version, int index, const QString &description,
+                    qint64 cursor, bool done, qint64 elapsedMs);
+
+    static Step statementStep(const QString &description, const QStringList &statements);
+    static Step optionalStep(const QString &description, const QStringList &statements);
+    static Step chunkedStep(const QString &description, const QString &table,
+                            const QString &sql, int chunkSize);
+    static Step chunkedStep(const QString &description, const QString &table,
+                            const ChunkCode &code, int chunkSize);
+};
+
+#endif // SCHEMAMIGRATOR_H
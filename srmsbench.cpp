@@ -0,0 +1,470 @@
+#include <QCoreApplication>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFile>
+#include <QDir>
+#include <QDateTime>
+#include <QDate>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QVector>
+#include <QList>
+#include <QPair>
+
+#include <algorithm>
+#include <functional>
+
+#include "connectionprofile.h"
+#include "schemamigrator.h"
+#include "statementcache.h"
+#include "gradingpolicy.h"
+#include "datagenerator.h"
+#include "userrepository.h"
+#include "studentrepository.h"
+#include "marksrepository.h"
+#include "attendancerepository.h"
+#include "attendanceanalytics.h"
+#include "dashboardrepository.h"
+#include "marksnapshot.h"
+#include "reportbuilder.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
+#include "cgparecomputejob.h"
+
+// srms-bench: generates a database per scale and times the operations
+// behind the login, the teacher page, search, the marks dialog, CGPA
+// recompute, attendance, the class dashboard and marks reports. Results
+// are printed as JSON; with --baseline the medians are compared against an
+// earlier run. A benchmark that fails makes the exit code 1 and skips the
+// comparison.
+//
+// The default scales are 1k and 100k. 1M is opt-in: generating it takes
+// far longer than all the benchmarks together, so it is meant to be run
+// once and kept with --reuse.
+//
+//   srms-bench [--scales 1k,100k,1M] [--marks-per-student 10]
+//              [--attendance-days 30] [--seed 42] [--dir .] [--reuse]
+//              [--label text] [--output results.json]
+//              [--baseline old.json] [--tolerance 1.25]
+
+static QTextStream err(stderr);
+
+static QString option(const QStringList &arguments, const QString &name,
+                      const QString &fallback = QString())
+{
+    for (int i = 1; i < arguments.size(); i++) {
+        if (arguments[i].startsWith(name + "="))
+            return arguments[i].mid(name.size() + 1);
+        if (arguments[i] == name && i + 1 < arguments.size())
+            return arguments[i + 1];
+    }
+    return fallback;
+}
+
+// "1k" -> 1000, "1M" -> 1000000
+static int parseScale(QString text)
+{
+    text = text.trimmed().toLower();
+    int factor = 1;
+    if (text.endsWith('k'))
+        factor = 1000;
+    else if (text.endsWith('m'))
+        factor = 1000000;
+    if (factor > 1)
+        text.chop(1);
+    return text.toInt() * factor;
+}
+
+// Times body(i) for i = 0 .. iterations - 1; body returns false on error
+static QJsonObject measure(int scale, const QString &name, int iterations,
+                           const std::function<bool(int)> &body)
+{
+    QVector<double> ms;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        timer.start();
+        bool ok = body(i);
+        ms.append(timer.nsecsElapsed() / 1e6);
+        if (!ok) {
+            err << "  " << name << " failed\n";
+            break;
+        }
+    }
+
+    QJsonObject result;
+    result["scale"] = scale;
+    result["name"] = name;
+    result["iterations"] = ms.size();
+    if (ms.size() < iterations)
+        result["failed"] = true;
+    if (ms.isEmpty())
+        return result;
+
+    std::sort(ms.begin(), ms.end());
+    double sum = 0.0;
+    for (double v : ms)
+        sum += v;
+    double median = ms[ms.size() / 2];
+    result["min_ms"] = ms.first();
+    result["median_ms"] = median;
+    result["p95_ms"] = ms[qMin(ms.size() - 1, int(ms.size() * 0.95))];
+    result["max_ms"] = ms.last();
+    result["mean_ms"] = sum / ms.size();
+    result["ops_per_s"] = median > 0 ? 1000.0 / median : 0.0;
+
+    err << QString("  %1: median %2 ms, p95 %3 ms (%4 runs)\n")
+               .arg(name, -28)
+               .arg(median, 0, 'f', 3)
+               .arg(result.value("p95_ms").toDouble(), 0, 'f', 3)
+               .arg(ms.size());
+    err.flush();
+    return result;
+}
+
+// Every benchmark of one scale on its open connection; false if the data
+// could not be set up
+static bool runBenchmarks(QSqlDatabase &db, const QStringList &arguments, int scale,
+                          const DataGenerator::Config &base, QJsonArray &results)
+{
+    const QString fileName = db.databaseName();
+    QString profileError;
+    if (!ConnectionProfile::load(arguments).apply(db, &profileError)) {
+        err << "Could not apply database profile: " << profileError << "\n";
+        return false;
+    }
+
+    SchemaMigrator migrator(db);
+    if (!migrator.migrate()) {
+        err << "Schema migration failed: " << migrator.lastError() << "\n";
+        return false;
+    }
+
+    err << "Scale " << scale << " (" << fileName << ")\n";
+
+    // ---- Data ----
+    QSqlQuery count(db);
+    count.exec("SELECT COUNT(*) FROM students");
+    int existing = count.next() ? count.value(0).toInt() : 0;
+    count.finish();
+
+    if (existing == 0) {
+        DataGenerator::Config config = base;
+        config.students = scale;
+        DataGenerator generator(db);
+        QJsonObject generate = measure(scale, "generate", 1, [&](int) {
+            return generator.generate(config);
+        });
+        DataGenerator::Stats stats = generator.stats();
+        generate["rows"] = double(stats.students * 2 + stats.marks + stats.attendance);
+        results.append(generate);
+        if (!generator.lastError().isEmpty()) {
+            err << "Generation failed: " << generator.lastError() << "\n";
+            return false;
+        }
+        QSqlQuery(db).exec("ANALYZE");
+    } else if (existing != scale) {
+        err << fileName << " holds " << existing << " students, not " << scale << "\n";
+        return false;
+    }
+
+    // Benchmark inputs are drawn from their own fixed sequence too
+    quint64 state = base.seed;
+    auto pick = [&]() {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return int((state >> 33) % quint64(scale));
+    };
+
+    // ---- Login ----
+    UserRepository users(db);
+    results.append(measure(scale, "login", 200, [&](int) {
+        UserAccount account;
+        return users.authenticate(DataGenerator::username(pick()),
+                                  DataGenerator::password(), account);
+    }));
+
+    // ---- Teacher page: first page, then pages deep in the table ----
+    StudentRepository students(db);
+    results.append(measure(scale, "teacher_page_load", 50, [&](int) {
+        return !students.page(QString(), 200).isEmpty();
+    }));
+    results.append(measure(scale, "teacher_page_scroll", 50, [&](int) {
+        students.page(DataGenerator::rollNo(pick()), 200);
+        return students.lastError().isEmpty();
+    }));
+
+    // ---- Search, one benchmark per tier ----
+    const QList<QPair<QString, QString>> searches = {
+        {"search_roll_prefix", DataGenerator::rollNo(scale / 2).left(7)},
+        {"search_name_prefix", "Kav"},
+        {"search_substring", "harm"},
+        {"search_fuzzy", "Koushk"}
+    };
+    for (const auto &search : searches) {
+        results.append(measure(scale, search.first, 20, [&](int) {
+            students.search(search.second, 500);
+            return students.lastError().isEmpty();
+        }));
+    }
+
+    // ---- Marks dialog ----
+    MarksRepository marks(db);
+    results.append(measure(scale, "marks_load", 200, [&](int) {
+        marks.forStudent(DataGenerator::rollNo(pick()));
+        return marks.lastError().isEmpty();
+    }));
+    results.append(measure(scale, "cgpa_single", 200, [&](int) {
+        marks.cgpa(DataGenerator::rollNo(pick()));
+        return marks.lastError().isEmpty();
+    }));
+
+    // ---- Bulk CGPA ----
+    results.append(measure(scale, "cgpa_recompute", scale >= 1000000 ? 1 : 3, [&](int) {
+        CgpaRecomputeJob job(db);
+        return job.run();
+    }));
+
+    // ---- Attendance: one class roster, saved with flipped statuses ----
+    AttendanceRepository attendance(db);
+    const QString subject = DataGenerator::subjects().first();
+    const QDate day = base.firstDay;
+    QVector<AttendanceRecord> roster = attendance.forClass(subject, day, 1, "CSE", 2);
+    results.append(measure(scale, "attendance_save", 10, [&](int i) {
+        for (AttendanceRecord &record : roster)
+            record.status = (i % 2) ? "Present" : "Absent";
+        return attendance.save(subject, day, 1, roster);
+    }));
+    results.append(measure(scale, "attendance_stats", 10, [&](int) {
+        attendance.sessions(subject);
+        return attendance.lastError().isEmpty();
+    }));
+    results.append(measure(scale, "attendance_student", 200, [&](int) {
+        attendance.summaryForStudent(DataGenerator::rollNo(pick()));
+        return attendance.lastError().isEmpty();
+    }));
+    results.append(measure(scale, "attendance_analytics", 3, [&](int) {
+        AttendanceAnalytics analytics(db);
+        return analytics.run(AttendanceQuery());
+    }));
+
+    // ---- Class dashboard: every class, then one class's subjects ----
+    DashboardRepository dashboard(db);
+    results.append(measure(scale, "dashboard_load", 200, [&](int) {
+        dashboard.classes();
+        dashboard.subjects("CSE", 2);
+        return dashboard.lastError().isEmpty();
+    }));
+
+    // ---- Marks reports: snapshot load, then queries on it ----
+    results.append(measure(scale, "report_snapshot_load", 3, [&](int) {
+        MarksSnapshot::invalidate(db);
+        return MarksSnapshot::acquire(db) != nullptr;
+    }));
+    const QString reportSubject = DataGenerator::subjects().first();
+    const QString reportExam = DataGenerator::examTypes().first();
+    results.append(measure(scale, "report_top", 50, [&](int) {
+        MarksReport report;
+        return ReportBuilder(db).subject(reportSubject).examType(reportExam)
+            .branch("CSE").year(3).top(50, report);
+    }));
+    results.append(measure(scale, "report_stats", 50, [&](int) {
+        MarksReport report;
+        return ReportBuilder(db).stats(ReportBuilder::BySubject, report);
+    }));
+    MarksSnapshot::invalidate(db);
+
+    // ---- Class ranks: a cohort load, then cached lookups ----
+    results.append(measure(scale, "cohort_load", 10, [&](int) {
+        CohortRanking::invalidate(db, reportSubject, reportExam);
+        QVector<int> bands;
+        return CohortRanking(db).histogram(reportSubject, reportExam, 10, bands);
+    }));
+    results.append(measure(scale, "cohort_rank", 200, [&](int) {
+        QHash<CohortRanking::Key, CohortStanding> standings;
+        return CohortRanking(db).forStudent(DataGenerator::rollNo(pick()), standings);
+    }));
+
+    // ---- Student portal: the former separate reads, one query, cached ----
+    results.append(measure(scale, "student_portal_separate", 200, [&](int) {
+        const QString rollNo = DataGenerator::rollNo(pick());
+        StudentRecord student;
+        QHash<CohortRanking::Key, CohortStanding> standings;
+        students.find(rollNo, student);
+        marks.forStudent(rollNo);
+        attendance.summaryForStudent(rollNo);
+        return CohortRanking(db).forStudent(rollNo, standings)
+            && marks.lastError().isEmpty() && attendance.lastError().isEmpty();
+    }));
+    StudentProfileRepository profiles(db);
+    results.append(measure(scale, "student_portal", 200, [&](int) {
+        const QString rollNo = DataGenerator::rollNo(pick());
+        StudentProfile profile;
+        QHash<CohortRanking::Key, CohortStanding> standings;
+        StudentProfileRepository::invalidate(db, rollNo);
+        return profiles.load(rollNo, profile) && CohortRanking(db).rank(profile.averages, standings);
+    }));
+    const QString portalRollNo = DataGenerator::rollNo(pick());
+    results.append(measure(scale, "student_portal_cached", 200, [&](int) {
+        StudentProfile profile;
+        QHash<CohortRanking::Key, CohortStanding> standings;
+        return profiles.load(portalRollNo, profile) && CohortRanking(db).rank(profile.averages, standings);
+    }));
+    StudentProfileRepository::invalidateAll(db);
+    CohortRanking::invalidateAll(db);
+    return true;
+}
+
+// Opens the scale's database, runs the benchmarks and always drops the
+// connection again, whether they ran or not
+static bool runScale(const QStringList &arguments, int scale, const DataGenerator::Config &base,
+                     QJsonArray &results)
+{
+    QString dir = option(arguments, "--dir", ".");
+    QString fileName = QDir(dir).filePath(QString("srms-bench-%1.db").arg(scale));
+    if (!arguments.contains("--reuse")) {
+        for (const char *suffix : {"", "-wal", "-shm"})
+            QFile::remove(fileName + suffix);
+    }
+
+    QString connectionName = QString("bench-%1").arg(scale);
+    bool ok = false;
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        db.setDatabaseName(fileName);
+        if (db.open()) {
+            ok = runBenchmarks(db, arguments, scale, base, results);
+            StatementCache::release(connectionName);
+            db.close();
+        } else {
+            err << "Could not open " << fileName << ": " << db.lastError().text() << "\n";
+        }
+    }
+    QSqlDatabase::removeDatabase(connectionName);
+    return ok;
+}
+
+// Medians above tolerance x the baseline's, per (scale, name)
+static int compareWithBaseline(const QJsonArray &results, const QString &fileName,
+                               double tolerance)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        err << "Could not read baseline " << fileName << "\n";
+        return 2;
+    }
+    QJsonArray baseline = QJsonDocument::fromJson(file.readAll()).object()["results"].toArray();
+
+    int regressions = 0;
+    for (const QJsonValue &value : results) {
+        QJsonObject current = value.toObject();
+        for (const QJsonValue &old : baseline) {
+            QJsonObject previous = old.toObject();
+            if (previous.value("scale") != current.value("scale")
+                || previous.value("name") != current.value("name"))
+                continue;
+
+            double before = previous.value("median_ms").toDouble();
+            double now = current.value("median_ms").toDouble();
+            if (before > 0 && now > before * tolerance) {
+                err << QString("REGRESSION %1 @ %2: %3 ms -> %4 ms (x%5)\n")
+                           .arg(current.value("name").toString())
+                           .arg(current.value("scale").toInt())
+                           .arg(before, 0, 'f', 3)
+                           .arg(now, 0, 'f', 3)
+                           .arg(now / before, 0, 'f', 2);
+                regressions++;
+            }
+        }
+    }
+    return regressions > 0 ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList arguments = app.arguments();
+
+    if (arguments.contains("--help")) {
+        QTextStream(stdout) << "Usage: srms-bench [--scales 1k,100k,1M] [--marks-per-student 10]\n"
+                               "                  [--attendance-days 30] [--seed 42] [--dir .] [--reuse]\n"
+                               "                  [--label text] [--output results.json]\n"
+                               "                  [--baseline old.json] [--tolerance 1.25]\n";
+        return 0;
+    }
+
+    DataGenerator::Config config;
+    config.marksPerStudent = option(arguments, "--marks-per-student", "10").toInt();
+    config.attendanceDays = option(arguments, "--attendance-days", "30").toInt();
+    config.seed = option(arguments, "--seed", "42").toULongLong();
+
+    GradingPolicy::setActive(GradingPolicy::load(arguments));
+
+    QJsonArray results;
+    QString sqliteVersion;
+    for (const QString &scaleText : option(arguments, "--scales", "1k,100k").split(',')) {
+        int scale = parseScale(scaleText);
+        if (scale <= 0) {
+            err << "Bad scale " << scaleText << "\n";
+            return 2;
+        }
+        if (!runScale(arguments, scale, config, results))
+            return 1;
+    }
+
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "bench-version");
+        db.setDatabaseName(":memory:");
+        if (db.open()) {
+            QSqlQuery q(db);
+            if (q.exec("SELECT sqlite_version()") && q.next())
+                sqliteVersion = q.value(0).toString();
+        }
+    }
+    QSqlDatabase::removeDatabase("bench-version");
+
+    QJsonObject configJson;
+    configJson["marks_per_student"] = config.marksPerStudent;
+    configJson["attendance_days"] = config.attendanceDays;
+    configJson["seed"] = QString::number(config.seed);
+    configJson["db_profile"] = ConnectionProfile::load(arguments).name;
+    configJson["grading_policy"] = GradingPolicy::active().name();
+
+    QJsonObject report;
+    report["label"] = option(arguments, "--label");
+    report["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    report["qt"] = QString(qVersion());
+    report["sqlite"] = sqliteVersion;
+    report["config"] = configJson;
+    report["results"] = results;
+
+    QByteArray json = QJsonDocument(report).toJson();
+    QString output = option(arguments, "--output");
+    if (output.isEmpty()) {
+        QTextStream(stdout) << json;
+    } else {
+        QFile file(output);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            err << "Could not write " << output << "\n";
+            return 1;
+        }
+    }
+
+    int failed = 0;
+    for (const QJsonValue &value : results) {
+        if (value.toObject().value("failed").toBool())
+            failed++;
+    }
+    if (failed > 0) {
+        err << failed << " benchmark(s) failed; not comparing with a baseline\n";
+        return 1;
+    }
+
+    QString baseline = option(arguments, "--baseline");
+    if (!baseline.isEmpty())
+        return compareWithBaseline(results, baseline,
+                                   option(arguments, "--tolerance", "1.25").toDouble());
+    return 0;
+}
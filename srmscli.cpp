@@ -0,0 +1,11 @@
+#include <QCoreApplication>
+#include "batchcommands.h"
+
+// srms-cli: batch operations without a display, see batchcommands.h
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("srms-cli");
+
+    return BatchCommands(app.arguments()).run();
+}
@@ -1,6 +1,24 @@
 #include "srmswindow.h"
 #include "marksdialog.h"
 #include "attendancedialog.h"
+#include "schemamigrator.h"
+#include "connectionprofile.h"
+#include "statementcache.h"
+#include "userrepository.h"
+#include "studentrepository.h"
+#include "marksrepository.h"
+#include "attendancerepository.h"
+#include "queryexecutor.h"
+#include "studenttablemodel.h"
+#include "cgparecomputejob.h"
+#include "gradingpolicy.h"
+#include "csvimporter.h"
+#include "dataexporter.h"
+#include "querystats.h"
+#include "diagnosticsdialog.h"
+#include "dashboardrepository.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
 
 #include <QApplication>
 #include <QVBoxLayout>
@@ -10,11 +28,14 @@
 #include <QHeaderView>
 #include <QMessageBox>
 #include <QInputDialog>
-#include <QCryptographicHash>
 #include <QAbstractItemView>
+#include <QTimer>
+#include <QFileDialog>
+#include <QPointer>
+#include <QProgressBar>
 
-#include <QSqlQuery>
 #include <QSqlError>
+#include <QDebug>
 
 // =========================================
 // Constructor / Destructor
@@ -26,7 +47,15 @@ SRMSWindow::SRMSWindow(QWidget *parent)
       loginPage(nullptr),
       teacherPage(nullptr),
       studentPage(nullptr),
+      dashboardPage(nullptr),
+      executor(nullptr),
+      teacherStatusLabel(nullptr),
       studentModel(nullptr),
+      searchDebounce(nullptr),
+      searchOverlay(nullptr),
+      recomputeBtn(nullptr),
+      importBtn(nullptr),
+      exportBtn(nullptr),
       logoutButtonTeacher(nullptr),
       logoutButtonStudent(nullptr),
       currentRole(UserRole::Teacher)   // default, will be overwritten on login
@@ -38,6 +67,7 @@ SRMSWindow::SRMSWindow(QWidget *parent)
     setupLoginUI();
     setupTeacherUI();
     setupStudentUI();
+    setupDashboardUI();
 
     setCentralWidget(stackedWidget);
     stackedWidget->setCurrentWidget(loginPage);
@@ -45,6 +75,7 @@ SRMSWindow::SRMSWindow(QWidget *parent)
 
 SRMSWindow::~SRMSWindow()
 {
+    StatementCache::release(db.connectionName());
 }
 
 // =========================================
@@ -61,55 +92,35 @@ void SRMSWindow::initDatabase()
         return;
     }
 
-    QSqlQuery q;
+    ConnectionProfile profile = ConnectionProfile::load(QCoreApplication::arguments());
+    QString profileError;
+    if (!profile.apply(db, &profileError))
+        QMessageBox::warning(this, "DB Warning",
+                             "Could not apply database profile " + profile.name + ":\n" + profileError);
 
-    // Users table: user_id = roll_no for students, anything for teachers
-    q.exec("CREATE TABLE IF NOT EXISTS users ("
-           " user_id TEXT PRIMARY KEY,"
-           " username TEXT UNIQUE,"
-           " password TEXT NOT NULL,"
-           " role TEXT NOT NULL,"         // 'TEACHER' or 'STUDENT'
-           " email TEXT)");
+    GradingPolicy::setActive(GradingPolicy::load(QCoreApplication::arguments()));
+    QueryStats::configure(QCoreApplication::arguments());
 
-    // Students table
-    q.exec("CREATE TABLE IF NOT EXISTS students ("
-           " roll_no TEXT PRIMARY KEY,"
-           " name TEXT,"
-           " email TEXT,"
-           " branch TEXT,"
-           " year INTEGER,"
-           " gender TEXT,"
-           " cgpa REAL DEFAULT 0.0)");
-
-    // Marks table
-    q.exec("CREATE TABLE IF NOT EXISTS marks ("
-           " mark_id INTEGER PRIMARY KEY AUTOINCREMENT,"
-           " roll_no TEXT,"
-           " subject TEXT,"
-           " marks INTEGER,"
-           " max_marks INTEGER,"
-           " exam_type TEXT)");
-
-    // Attendance table
-    q.exec("CREATE TABLE IF NOT EXISTS attendance ("
-           " attendance_id INTEGER PRIMARY KEY AUTOINCREMENT,"
-           " roll_no TEXT,"
-           " subject TEXT,"
-           " status TEXT)");
+    SchemaMigrator migrator(db);
+    if (!migrator.migrate()) {
+        QMessageBox::critical(this, "DB Error",
+                              "Schema migration failed:\n" + migrator.lastError());
+        return;
+    }
+    QStringList regressions;
+    if (!migrator.verifyQueryPlans(regressions)) {
+        qCritical() << "Query plan regression:" << regressions;
+        QMessageBox::critical(this, "DB Error",
+                              "Hot queries are no longer using their indexes:\n\n"
+                              + regressions.join("\n"));
+    }
 
-    // Default admin teacher if not exists
-    QString hashed = QString(
-        QCryptographicHash::hash("admin123", QCryptographicHash::Sha256).toHex());
+    UserRepository(db).ensureDefaultAdmin();
 
-    q.prepare("SELECT COUNT(*) FROM users WHERE username='admin'");
-    q.exec();
-    if (q.next() && q.value(0).toInt() == 0) {
-        QSqlQuery ins;
-        ins.prepare("INSERT INTO users (user_id, username, password, role, email) "
-                    "VALUES ('ADMIN', 'admin', ?, 'TEACHER', 'admin@example.com')");
-        ins.addBindValue(hashed);
-        ins.exec();
-    }
+    // Slow or table-wide reads run on a worker thread with its own connection
+    executor = new QueryExecutor(db.databaseName(), profile, this);
+    connect(executor, &QueryExecutor::finished, this, &SRMSWindow::onQueryFinished);
+    connect(executor, &QueryExecutor::failed, this, &SRMSWindow::onQueryFailed);
 }
 
 // =========================================
@@ -180,6 +191,15 @@ void SRMSWindow::setupTeacherUI()
     connect(btnSearch, &QPushButton::clicked, this, &SRMSWindow::onSearch);
     connect(btnReset,  &QPushButton::clicked, this, &SRMSWindow::onResetSearch);
 
+    // Search as you type: a query starts once typing pauses, Enter or the
+    // button start it right away
+    searchDebounce = new QTimer(this);
+    searchDebounce->setSingleShot(true);
+    searchDebounce->setInterval(SearchDebounceMs);
+    connect(searchDebounce, &QTimer::timeout, this, &SRMSWindow::onSearch);
+    connect(searchBox, &QLineEdit::textEdited, this, &SRMSWindow::onSearchTextEdited);
+    connect(searchBox, &QLineEdit::returnPressed, this, &SRMSWindow::onSearch);
+
     searchRow->addWidget(searchBox);
     searchRow->addWidget(btnSearch);
     searchRow->addWidget(btnReset);
@@ -195,6 +215,11 @@ void SRMSWindow::setupTeacherUI()
     QPushButton *delBtn = new QPushButton("Delete Student");
     QPushButton *markBtn = new QPushButton("Manage Marks");
     QPushButton *attBtn  = new QPushButton("Manage Attendance");
+    recomputeBtn = new QPushButton("Recompute All CGPA");
+    importBtn = new QPushButton("Import CSV");
+    exportBtn = new QPushButton("Export");
+    QPushButton *diagnosticsBtn = new QPushButton("Diagnostics");
+    QPushButton *dashboardBtn = new QPushButton("Dashboard");
 
     logoutButtonTeacher = new QPushButton("Logout");
     logoutButtonTeacher->setStyleSheet("background-color:#d9534f; color:white; padding:6px;");
@@ -204,6 +229,11 @@ void SRMSWindow::setupTeacherUI()
     connect(delBtn,  &QPushButton::clicked, this, &SRMSWindow::onDeleteStudent);
     connect(markBtn, &QPushButton::clicked, this, &SRMSWindow::onManageMarks);
     connect(attBtn,  &QPushButton::clicked, this, &SRMSWindow::onManageAttendance);
+    connect(recomputeBtn, &QPushButton::clicked, this, &SRMSWindow::onRecomputeCgpa);
+    connect(importBtn, &QPushButton::clicked, this, &SRMSWindow::onImportCsv);
+    connect(exportBtn, &QPushButton::clicked, this, &SRMSWindow::onExport);
+    connect(diagnosticsBtn, &QPushButton::clicked, this, &SRMSWindow::onShowDiagnostics);
+    connect(dashboardBtn, &QPushButton::clicked, this, &SRMSWindow::onShowDashboard);
     connect(logoutButtonTeacher, &QPushButton::clicked, this, &SRMSWindow::onLogout);
 
     btns->addWidget(addBtn);
@@ -211,24 +241,28 @@ void SRMSWindow::setupTeacherUI()
     btns->addWidget(delBtn);
     btns->addWidget(markBtn);
     btns->addWidget(attBtn);
+    btns->addWidget(recomputeBtn);
+    btns->addWidget(importBtn);
+    btns->addWidget(exportBtn);
+    btns->addWidget(diagnosticsBtn);
+    btns->addWidget(dashboardBtn);
     btns->addStretch();
     btns->addWidget(logoutButtonTeacher);
 
     main->addLayout(btns);
 
-    // Student table
+    // Status line: loading state and row counts
+    teacherStatusLabel = new QLabel;
+    teacherStatusLabel->setStyleSheet("color: gray;");
+    main->addWidget(teacherStatusLabel);
+
+    // Student table, paged in from the query worker as it scrolls
     studentTable = new QTableView;
-    studentModel = new QSqlTableModel(this, db);
-    studentModel->setTable("students");
-    studentModel->select();
-
-    studentModel->setHeaderData(0, Qt::Horizontal, "Roll No");
-    studentModel->setHeaderData(1, Qt::Horizontal, "Name");
-    studentModel->setHeaderData(2, Qt::Horizontal, "Email");
-    studentModel->setHeaderData(3, Qt::Horizontal, "Branch");
-    studentModel->setHeaderData(4, Qt::Horizontal, "Year");
-    studentModel->setHeaderData(5, Qt::Horizontal, "Gender");
-    studentModel->setHeaderData(6, Qt::Horizontal, "CGPA");
+    if (executor) {
+        studentModel = new StudentTableModel(executor, this);
+        connect(studentModel, &StudentTableModel::pageLoaded, this, &SRMSWindow::onStudentsLoaded);
+        connect(studentModel, &StudentTableModel::loadFailed, this, &SRMSWindow::onStudentsLoadFailed);
+    }
 
     studentTable->setModel(studentModel);
     studentTable->setSelectionBehavior(QAbstractItemView::SelectRows);
@@ -237,6 +271,18 @@ void SRMSWindow::setupTeacherUI()
 
     main->addWidget(studentTable);
 
+    // Keystroke-to-results latency, drawn over the table when started with
+    // --debug-overlay or SRMS_DEBUG_OVERLAY set
+    if (QApplication::arguments().contains("--debug-overlay")
+        || qEnvironmentVariableIsSet("SRMS_DEBUG_OVERLAY")) {
+        searchOverlay = new QLabel(studentTable);
+        searchOverlay->setStyleSheet("background-color: rgba(0, 0, 0, 160); color: white;"
+                                     " padding: 4px; font-family: monospace;");
+        searchOverlay->setAttribute(Qt::WA_TransparentForMouseEvents);
+        searchOverlay->move(8, 8);
+        searchOverlay->hide();
+    }
+
     stackedWidget->addWidget(teacherPage);
 }
 
@@ -263,9 +309,9 @@ void SRMSWindow::setupStudentUI()
     main->addWidget(marksLabel);
 
     studentMarksTable = new QTableWidget;
-    studentMarksTable->setColumnCount(4);
+    studentMarksTable->setColumnCount(7);
     studentMarksTable->setHorizontalHeaderLabels(
-        {"Subject", "Marks", "Max Marks", "Percent"});
+        {"Subject", "Exam Type", "Marks", "Max Marks", "Percent", "Class Rank", "Percentile"});
     studentMarksTable->horizontalHeader()->setStretchLastSection(true);
     main->addWidget(studentMarksTable);
 
@@ -275,8 +321,8 @@ void SRMSWindow::setupStudentUI()
     main->addWidget(attLabel);
 
     studentAttendanceTable = new QTableWidget;
-    studentAttendanceTable->setColumnCount(2);
-    studentAttendanceTable->setHorizontalHeaderLabels({"Subject", "Status"});
+    studentAttendanceTable->setColumnCount(4);
+    studentAttendanceTable->setHorizontalHeaderLabels({"Subject", "Attended", "Held", "Attendance %"});
     studentAttendanceTable->horizontalHeader()->setStretchLastSection(true);
     main->addWidget(studentAttendanceTable);
 
@@ -289,6 +335,78 @@ void SRMSWindow::setupStudentUI()
     stackedWidget->addWidget(studentPage);
 }
 
+// =========================================
+// Dashboard UI
+// =========================================
+
+void SRMSWindow::setupDashboardUI()
+{
+    dashboardPage = new QWidget;
+    QVBoxLayout *main = new QVBoxLayout(dashboardPage);
+
+    QHBoxLayout *header = new QHBoxLayout;
+    QLabel *title = new QLabel("Class Dashboard");
+    title->setStyleSheet("font-size: 20px; font-weight: bold;");
+    QPushButton *refreshBtn = new QPushButton("Refresh");
+    QPushButton *backBtn = new QPushButton("Back");
+    connect(refreshBtn, &QPushButton::clicked, this, &SRMSWindow::onRefreshDashboard);
+    connect(backBtn, &QPushButton::clicked, this, &SRMSWindow::onCloseDashboard);
+    header->addWidget(title);
+    header->addStretch();
+    header->addWidget(refreshBtn);
+    header->addWidget(backBtn);
+    main->addLayout(header);
+
+    dashboardStatusLabel = new QLabel;
+    dashboardStatusLabel->setStyleSheet("color: gray;");
+    main->addWidget(dashboardStatusLabel);
+
+    // One row per branch and year
+    classTable = new QTableWidget;
+    classTable->setColumnCount(6);
+    classTable->setHorizontalHeaderLabels(
+        {"Branch", "Year", "Students", "Graded", "Avg CGPA", "Attendance %"});
+    classTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    classTable->setSelectionMode(QAbstractItemView::SingleSelection);
+    classTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    classTable->horizontalHeader()->setStretchLastSection(true);
+    connect(classTable, &QTableWidget::itemSelectionChanged,
+            this, &SRMSWindow::onDashboardClassSelected);
+    main->addWidget(classTable);
+
+    // The selected class: results per subject and how attendance spreads
+    QHBoxLayout *details = new QHBoxLayout;
+
+    QVBoxLayout *subjectColumn = new QVBoxLayout;
+    QLabel *subjectLabel = new QLabel("Results by subject:");
+    subjectLabel->setStyleSheet("font-weight: bold;");
+    classSubjectTable = new QTableWidget;
+    classSubjectTable->setColumnCount(5);
+    classSubjectTable->setHorizontalHeaderLabels(
+        {"Subject", "Results", "Passed", "Pass Rate %", "Avg %"});
+    classSubjectTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    classSubjectTable->horizontalHeader()->setStretchLastSection(true);
+    subjectColumn->addWidget(subjectLabel);
+    subjectColumn->addWidget(classSubjectTable);
+
+    QVBoxLayout *attendanceColumn = new QVBoxLayout;
+    QLabel *attendanceLabel = new QLabel("Attendance distribution:");
+    attendanceLabel->setStyleSheet("font-weight: bold;");
+    classAttendanceTable = new QTableWidget;
+    classAttendanceTable->setColumnCount(3);
+    classAttendanceTable->setHorizontalHeaderLabels({"Attendance", "Students", ""});
+    classAttendanceTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    classAttendanceTable->horizontalHeader()->setStretchLastSection(true);
+    attendanceColumn->addWidget(attendanceLabel);
+    attendanceColumn->addWidget(classAttendanceTable);
+
+    details->addLayout(subjectColumn, 3);
+    details->addLayout(attendanceColumn, 2);
+    main->addLayout(details);
+
+    stackedWidget->addWidget(dashboardPage);
+}
+
 // =========================================
 // Register
 // =========================================
@@ -351,20 +469,18 @@ void SRMSWindow::onRegister()
         int year = yearStr.toInt();
 
         // insert/update into students table
-        QSqlQuery qs(db);
-        qs.prepare("INSERT OR REPLACE INTO students "
-                   "(roll_no, name, email, branch, year, gender) "
-                   "VALUES (?, ?, ?, ?, ?, ?)");
-        qs.addBindValue(rollNo.trimmed());
-        qs.addBindValue(name.trimmed());
-        qs.addBindValue(email.trimmed());
-        qs.addBindValue(branch.trimmed());
-        qs.addBindValue(year);
-        qs.addBindValue(gender.trimmed());
-
-        if (!qs.exec()) {
+        StudentRecord student;
+        student.rollNo = rollNo.trimmed();
+        student.name   = name.trimmed();
+        student.email  = email.trimmed();
+        student.branch = branch.trimmed();
+        student.year   = year;
+        student.gender = gender.trimmed();
+
+        StudentRepository students(db);
+        if (!students.upsert(student)) {
             QMessageBox::critical(this, "Error",
-                                  "Failed to save student record:\n" + qs.lastError().text());
+                                  "Failed to save student record:\n" + students.lastError());
             return;
         }
 
@@ -374,23 +490,16 @@ void SRMSWindow::onRegister()
         userId = username.trimmed().toUpper();
     }
 
-    QString hashed = QString(
-        QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256).toHex());
-
-    QString dbRole = (roleText == "Teacher") ? "TEACHER" : "STUDENT";
-
-    QSqlQuery q(db);
-    q.prepare("INSERT INTO users (user_id, username, password, role, email) "
-              "VALUES (?, ?, ?, ?, ?)");
-    q.addBindValue(userId);
-    q.addBindValue(username.trimmed());
-    q.addBindValue(hashed);
-    q.addBindValue(dbRole);
-    q.addBindValue(email.trimmed());
+    UserAccount account;
+    account.userId   = userId;
+    account.username = username.trimmed();
+    account.role     = (roleText == "Teacher") ? "TEACHER" : "STUDENT";
+    account.email    = email.trimmed();
 
-    if (!q.exec()) {
+    UserRepository users(db);
+    if (!users.create(account, password)) {
         QMessageBox::critical(this, "Registration Failed",
-                              "Failed to create account:\n" + q.lastError().text());
+                              "Failed to create account:\n" + users.lastError());
         return;
     }
 
@@ -403,8 +512,8 @@ void SRMSWindow::onRegister()
 
     QMessageBox::information(this, "Success", msg);
 
-    if (studentModel)
-        studentModel->select();
+    if (studentModel && account.role == "STUDENT")
+        studentModel->refreshStudent(userId);
 }
 
 // =========================================
@@ -446,28 +555,7 @@ void SRMSWindow::onLogin()
         studentHeaderLabel->setText(
             QString("Student Portal - %1").arg(rollNo));
 
-        // load details
-        QSqlQuery qs(db);
-        qs.prepare("SELECT name, email, branch, year, gender, cgpa "
-                   "FROM students WHERE roll_no=?");
-        qs.addBindValue(rollNo);
-        if (qs.exec() && qs.next()) {
-            QString details = QString(
-                                  "Name: %1\nEmail: %2\nBranch: %3\nYear: %4\nGender: %5\nCGPA: %6")
-                                  .arg(qs.value(0).toString())
-                                  .arg(qs.value(1).toString())
-                                  .arg(qs.value(2).toString())
-                                  .arg(qs.value(3).toInt())
-                                  .arg(qs.value(4).toString())
-                                  .arg(qs.value(5).toDouble());
-            studentDetailsLabel->setText(details);
-        } else {
-            studentDetailsLabel->setText("No student record found for this roll number.");
-        }
-
-        loadStudentMarks(rollNo);
-        loadStudentAttendance(rollNo);
-
+        showStudentProfile(rollNo);
         stackedWidget->setCurrentWidget(studentPage);
     }
 }
@@ -477,20 +565,12 @@ bool SRMSWindow::validateLogin(const QString &username,
                                QString &outRollNo,
                                UserRole &outRole)
 {
-    QString hashed = QString(
-        QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256).toHex());
-
-    QSqlQuery q(db);
-    q.prepare("SELECT user_id, role FROM users "
-              "WHERE username=? AND password=?");
-    q.addBindValue(username.trimmed());
-    q.addBindValue(hashed);
-
-    if (!q.exec() || !q.next())
+    UserAccount account;
+    if (!UserRepository(db).authenticate(username, password, account))
         return false;
 
-    QString userId = q.value(0).toString();
-    QString role = q.value(1).toString();
+    QString userId = account.userId;
+    QString role = account.role;
 
     if (role == "TEACHER") {
         outRole = UserRole::Teacher;
@@ -527,8 +607,39 @@ void SRMSWindow::loadStudentRecords()
     if (!studentModel)
         return;
 
-    studentModel->setTable("students");
-    studentModel->select();
+    // Starts over from the first page; rows further down are fetched when
+    // the view scrolls to them
+    teacherStatusLabel->setText(currentSearch.isEmpty()
+                                    ? QString("Loading students...")
+                                    : QString("Searching for \"%1\"...").arg(currentSearch));
+    studentModel->setFilter(currentSearch);
+}
+
+void SRMSWindow::onStudentsLoaded(int loadedRows, bool complete)
+{
+    if (keystrokeTimer.isValid()) {
+        reportSearchLatency(keystrokeTimer.elapsed());
+        keystrokeTimer.invalidate();
+    }
+
+    QString text = currentSearch.isEmpty()
+                       ? QString("%1 students").arg(loadedRows)
+                       : QString("%1 matches for \"%2\"").arg(loadedRows).arg(currentSearch);
+    if (!complete)
+        text += " loaded, scroll for more";
+    teacherStatusLabel->setText(text);
+}
+
+void SRMSWindow::onStudentsLoadFailed(const QString &error)
+{
+    teacherStatusLabel->setText("Failed to load students: " + error);
+}
+
+void SRMSWindow::onSearchTextEdited()
+{
+    if (!keystrokeTimer.isValid())
+        keystrokeTimer.start();
+    searchDebounce->start();
 }
 
 void SRMSWindow::onSearch()
@@ -536,18 +647,21 @@ void SRMSWindow::onSearch()
     if (!studentModel)
         return;
 
+    searchDebounce->stop();
+
     QString text = searchBox->text().trimmed();
+    if (text == currentSearch && !text.isEmpty()) {
+        keystrokeTimer.invalidate();
+        return;
+    }
+
     if (text.isEmpty()) {
         onResetSearch();
         return;
     }
 
-    QString filter =
-        QString("roll_no LIKE '%%1%' OR name LIKE '%%1%' OR email LIKE '%%1%'")
-            .arg(text.replace("'", "''"));
-
-    studentModel->setFilter(filter);
-    studentModel->select();
+    currentSearch = text;
+    loadStudentRecords();
 }
 
 void SRMSWindow::onResetSearch()
@@ -556,8 +670,27 @@ void SRMSWindow::onResetSearch()
         return;
 
     searchBox->clear();
-    studentModel->setFilter("");
-    studentModel->select();
+    currentSearch.clear();
+    loadStudentRecords();
+}
+
+// Time from the first keystroke of a burst until its results are shown;
+// that includes the debounce delay
+void SRMSWindow::reportSearchLatency(qint64 elapsedMs)
+{
+    QString line = QString("search \"%1\": %2 ms after keystroke, %3 ms %4, %5 rows")
+                       .arg(currentSearch)
+                       .arg(elapsedMs)
+                       .arg(studentModel->lastFetchMs())
+                       .arg(studentModel->lastFetchRefined() ? "refined in memory" : "in SQLite")
+                       .arg(studentModel->rowCount());
+
+    if (searchOverlay) {
+        searchOverlay->setText(line);
+        searchOverlay->adjustSize();
+        searchOverlay->show();
+        searchOverlay->raise();
+    }
 }
 
 void SRMSWindow::onAddStudent()
@@ -591,17 +724,15 @@ void SRMSWindow::onDeleteStudent()
                               "Delete student " + rollNo + "?") != QMessageBox::Yes)
         return;
 
-    QSqlQuery q(db);
-    q.prepare("DELETE FROM students WHERE roll_no=?");
-    q.addBindValue(rollNo);
-    q.exec();
-
-    // Also delete user account for that roll_no
-    q.prepare("DELETE FROM users WHERE user_id=?");
-    q.addBindValue(rollNo);
-    q.exec();
+    // Also deletes the user account for that roll_no
+    StudentRepository students(db);
+    if (!students.remove(rollNo)) {
+        QMessageBox::critical(this, "Error",
+                              "Failed to delete student:\n" + students.lastError());
+        return;
+    }
 
-    studentModel->select();
+    studentModel->removeStudent(rollNo);
 }
 
 // Dialog to add / edit student basic info
@@ -656,32 +787,23 @@ void SRMSWindow::showStudentDialog(bool isEdit)
 
     int year = yearStr.toInt();
 
-    QSqlQuery q(db);
-    if (isEdit) {
-        q.prepare("UPDATE students SET name=?, email=?, branch=?, year=?, gender=? "
-                  "WHERE roll_no=?");
-        q.addBindValue(name.trimmed());
-        q.addBindValue(email.trimmed());
-        q.addBindValue(branch.trimmed());
-        q.addBindValue(year);
-        q.addBindValue(gender.trimmed());
-        q.addBindValue(rollNo.trimmed());
-    } else {
-        q.prepare("INSERT INTO students (roll_no, name, email, branch, year, gender) "
-                  "VALUES (?, ?, ?, ?, ?, ?)");
-        q.addBindValue(rollNo.trimmed());
-        q.addBindValue(name.trimmed());
-        q.addBindValue(email.trimmed());
-        q.addBindValue(branch.trimmed());
-        q.addBindValue(year);
-        q.addBindValue(gender.trimmed());
-    }
+    StudentRecord student;
+    student.rollNo = rollNo.trimmed();
+    student.name   = name.trimmed();
+    student.email  = email.trimmed();
+    student.branch = branch.trimmed();
+    student.year   = year;
+    student.gender = gender.trimmed();
+
+    StudentRepository students(db);
+    bool saved = isEdit ? students.update(student) : students.insert(student);
 
-    if (!q.exec()) {
+    if (!saved) {
         QMessageBox::critical(this, "Error",
-                              "Failed to save student:\n" + q.lastError().text());
+                              "Failed to save student:\n" + students.lastError());
     } else {
-        studentModel->select();
+        if (studentModel)
+            studentModel->refreshStudent(student.rollNo);
         QMessageBox::information(this, "Success", "Student saved.");
     }
 }
@@ -694,75 +816,400 @@ void SRMSWindow::onManageMarks()
 {
     MarksDialog dialog(db, this);
     dialog.exec();
-    studentModel->select(); // refresh CGPA if changed
+
+    // Only rows whose marks (and so CGPA) changed need refreshing
+    if (studentModel) {
+        for (const QString &rollNo : dialog.updatedStudents())
+            studentModel->refreshStudent(rollNo);
+    }
 }
 
 void SRMSWindow::onManageAttendance()
 {
-    AttendanceDialog dialog(db, this);
+    AttendanceDialog dialog(db, executor, this);
     dialog.exec();
 }
 
+// Rebuilds every student's CGPA from the marks table on the query worker;
+// normally the running totals make this unnecessary, it repairs them
+void SRMSWindow::onRecomputeCgpa()
+{
+    if (!executor)
+        return;
+
+    if (QMessageBox::question(this, "Recompute CGPA",
+                              "Recompute the CGPA of every student from all marks?")
+        != QMessageBox::Yes)
+        return;
+
+    recomputeBtn->setEnabled(false);
+    teacherStatusLabel->setText("Recomputing CGPA for all students...");
+
+    executor->submit("cgpa.recompute", [](QSqlDatabase &db, const QueryCancelToken &token, QString &error) {
+        CgpaRecomputeJob job(db);
+        if (!job.run(token))
+            error = job.lastError();
+        return QVariant::fromValue(job.stats());
+    });
+}
+
+// Bulk import of a CSV file on the query worker, in one transaction.
+// Progress goes to the status line; rejected rows to a file next to it.
+void SRMSWindow::onImportCsv()
+{
+    if (!executor)
+        return;
+
+    QString fileName = QFileDialog::getOpenFileName(
+        this, "Import CSV", QString(), "CSV files (*.csv *.txt);;All files (*)");
+    if (fileName.isEmpty())
+        return;
+
+    bool ok = false;
+    QString kindName = QInputDialog::getItem(
+        this, "Import CSV", "The file contains:", {"Students", "Marks", "Attendance"},
+        0, false, &ok);
+    CsvImporter::Kind kind;
+    if (!ok || !CsvImporter::kindFromName(kindName, kind))
+        return;
+
+    importBtn->setEnabled(false);
+    teacherStatusLabel->setText("Importing " + fileName + "...");
+
+    QPointer<QLabel> status = teacherStatusLabel;
+    executor->submit("import", [fileName, kind, status](QSqlDatabase &db, const QueryCancelToken &token, QString &error) {
+        CsvImporter importer(db, kind);
+        importer.setProgress([status](qint64 done, qint64 total, qint64 rows) {
+            QString text = QString("Importing: %1% (%2 rows)")
+                               .arg(total > 0 ? done * 100 / total : 100)
+                               .arg(rows);
+            QMetaObject::invokeMethod(status, [status, text]() {
+                if (status)
+                    status->setText(text);
+            }, Qt::QueuedConnection);
+        });
+        if (!importer.run(fileName, token))
+            error = importer.lastError();
+        return QVariant::fromValue(importer.stats());
+    });
+}
+
+// Streams a table or report to a file on the query worker
+void SRMSWindow::onExport()
+{
+    if (!executor)
+        return;
+
+    bool ok = false;
+    QString source = QInputDialog::getItem(
+        this, "Export", "Export:", DataExporter::sources(), 0, false, &ok);
+    if (!ok)
+        return;
+
+    const QStringList formats = {"CSV", "JSONL", "Columnar"};
+    QString formatName = QInputDialog::getItem(
+        this, "Export", "Format:", formats, 0, false, &ok);
+    DataExporter::Format format;
+    if (!ok || !DataExporter::formatFromName(formatName, format))
+        return;
+
+    QString suffix = DataExporter::suffix(format);
+    QString fileName = QFileDialog::getSaveFileName(
+        this, "Export", source + "." + suffix, formatName + " files (*." + suffix + ");;All files (*)");
+    if (fileName.isEmpty())
+        return;
+
+    exportBtn->setEnabled(false);
+    teacherStatusLabel->setText("Exporting " + source + "...");
+
+    QPointer<QLabel> status = teacherStatusLabel;
+    executor->submit("export", [source, format, fileName, status](QSqlDatabase &db, const QueryCancelToken &token, QString &error) {
+        DataExporter exporter(db);
+        exporter.setProgress([status](qint64 rows) {
+            QString text = QString("Exporting: %1 rows").arg(rows);
+            QMetaObject::invokeMethod(status, [status, text]() {
+                if (status)
+                    status->setText(text);
+            }, Qt::QueuedConnection);
+        });
+        if (!exporter.run(source, format, fileName, token))
+            error = exporter.lastError();
+        return QVariant::fromValue(exporter.stats());
+    });
+}
+
 // =========================================
-// Student view: load marks & attendance
+// Teacher: class dashboard
 // =========================================
 
-void SRMSWindow::loadStudentMarks(const QString &rollNo)
+void SRMSWindow::onShowDashboard()
+{
+    stackedWidget->setCurrentWidget(dashboardPage);
+    onRefreshDashboard();
+}
+
+void SRMSWindow::onCloseDashboard()
 {
-    studentMarksTable->setRowCount(0);
+    stackedWidget->setCurrentWidget(teacherPage);
+}
 
-    QSqlQuery q(db);
-    q.prepare("SELECT subject, marks, max_marks FROM marks WHERE roll_no=?");
-    q.addBindValue(rollNo);
-    if (!q.exec())
+// The summaries are a few rows per class, so they are read right here
+// rather than on the query worker
+void SRMSWindow::onRefreshDashboard()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    DashboardRepository repository(db);
+    dashboardClasses = repository.classes();
+    if (!repository.lastError().isEmpty()) {
+        QMessageBox::critical(this, "Dashboard", "Could not load the dashboard:\n"
+                              + repository.lastError());
         return;
+    }
+
+    QString selectedBranch;
+    int selectedYear = -1;
+    int selected = classTable->currentRow();
+    if (selected >= 0 && classTable->item(selected, 0)) {
+        selectedBranch = classTable->item(selected, 0)->data(Qt::UserRole).toString();
+        selectedYear = classTable->item(selected, 1)->text().toInt();
+    }
+
+    classTable->blockSignals(true);
+    classTable->setRowCount(0);
+    classSubjectTable->setRowCount(0);
+    classAttendanceTable->setRowCount(0);
+
+    int reselect = -1;
+    for (const ClassSummary &c : dashboardClasses) {
+        int row = classTable->rowCount();
+        classTable->insertRow(row);
+
+        QTableWidgetItem *branch = new QTableWidgetItem(c.branch.isEmpty() ? "(none)" : c.branch);
+        branch->setData(Qt::UserRole, c.branch);
+        classTable->setItem(row, 0, branch);
+        classTable->setItem(row, 1, new QTableWidgetItem(QString::number(c.year)));
+        classTable->setItem(row, 2, new QTableWidgetItem(QString::number(c.students)));
+        classTable->setItem(row, 3, new QTableWidgetItem(QString::number(c.graded)));
+        classTable->setItem(row, 4, new QTableWidgetItem(QString::number(c.averageCgpa(), 'f', 2)));
+        classTable->setItem(row, 5, new QTableWidgetItem(
+            c.held > 0 ? QString::number(c.attendancePercentage(), 'f', 1) : QString("-")));
+
+        if (c.branch == selectedBranch && c.year == selectedYear)
+            reselect = row;
+    }
+    classTable->blockSignals(false);
+
+    if (reselect >= 0)
+        classTable->selectRow(reselect);
+    else if (!dashboardClasses.isEmpty())
+        classTable->selectRow(0);
 
-    while (q.next()) {
-        int row = studentMarksTable->rowCount();
-        studentMarksTable->insertRow(row);
+    dashboardStatusLabel->setText(QString("%1 classes, loaded in %2 ms")
+                                      .arg(dashboardClasses.size())
+                                      .arg(timer.elapsed()));
+}
 
-        QString subject = q.value(0).toString();
-        int marks = q.value(1).toInt();
-        int maxMarks = q.value(2).toInt();
-        double percent = maxMarks > 0 ? (marks * 100.0 / maxMarks) : 0.0;
+void SRMSWindow::onDashboardClassSelected()
+{
+    int row = classTable->currentRow();
+    if (row < 0 || row >= dashboardClasses.size())
+        return;
+    showClassDetails(dashboardClasses[row]);
+}
 
-        studentMarksTable->setItem(row, 0, new QTableWidgetItem(subject));
-        studentMarksTable->setItem(row, 1, new QTableWidgetItem(QString::number(marks)));
-        studentMarksTable->setItem(row, 2, new QTableWidgetItem(QString::number(maxMarks)));
-        studentMarksTable->setItem(row, 3, new QTableWidgetItem(QString::number(percent, 'f', 1) + "%"));
+void SRMSWindow::showClassDetails(const ClassSummary &summary)
+{
+    DashboardRepository repository(db);
+    const QVector<SubjectResults> subjects = repository.subjects(summary.branch, summary.year);
+    if (!repository.lastError().isEmpty())
+        dashboardStatusLabel->setText("Could not load the class results: " + repository.lastError());
+
+    classSubjectTable->clearSpans();
+    classSubjectTable->setRowCount(0);
+    for (const SubjectResults &s : subjects) {
+        int row = classSubjectTable->rowCount();
+        classSubjectTable->insertRow(row);
+
+        classSubjectTable->setItem(row, 0, new QTableWidgetItem(s.subject));
+        classSubjectTable->setItem(row, 1, new QTableWidgetItem(QString::number(s.results)));
+        classSubjectTable->setItem(row, 2, new QTableWidgetItem(QString::number(s.passed)));
+        classSubjectTable->setItem(row, 3, new QTableWidgetItem(QString::number(s.passRate(), 'f', 1)));
+        classSubjectTable->setItem(row, 4, new QTableWidgetItem(QString::number(s.averagePercentage(), 'f', 1)));
+    }
+    if (classSubjectTable->rowCount() == 0) {
+        classSubjectTable->insertRow(0);
+        classSubjectTable->setItem(0, 0, new QTableWidgetItem("No marks entered yet"));
+        classSubjectTable->setSpan(0, 0, 1, 5);
     }
 
-    if (studentMarksTable->rowCount() == 0) {
-        studentMarksTable->insertRow(0);
-        studentMarksTable->setItem(0, 0, new QTableWidgetItem("No marks entered yet"));
-        studentMarksTable->setSpan(0, 0, 1, 4);
+    // Highest band first, each with a bar for its share of the class
+    int withAttendance = 0;
+    for (int count : summary.attendanceBands)
+        withAttendance += count;
+
+    classAttendanceTable->setRowCount(0);
+    const int width = 100 / DashboardRepository::AttendanceBands;
+    for (int band = summary.attendanceBands.size() - 1; band >= 0; band--) {
+        int row = classAttendanceTable->rowCount();
+        classAttendanceTable->insertRow(row);
+
+        int count = summary.attendanceBands[band];
+        classAttendanceTable->setItem(row, 0, new QTableWidgetItem(
+            QString("%1-%2%").arg(band * width).arg((band + 1) * width)));
+        classAttendanceTable->setItem(row, 1, new QTableWidgetItem(QString::number(count)));
+
+        QProgressBar *bar = new QProgressBar;
+        bar->setRange(0, qMax(1, withAttendance));
+        bar->setValue(count);
+        bar->setTextVisible(false);
+        classAttendanceTable->setCellWidget(row, 2, bar);
     }
 }
 
-void SRMSWindow::loadStudentAttendance(const QString &rollNo)
+// Query latencies seen by every connection, including the worker's
+void SRMSWindow::onShowDiagnostics()
 {
-    studentAttendanceTable->setRowCount(0);
+    DiagnosticsDialog dialog(this);
+    dialog.exec();
+}
 
-    QSqlQuery q(db);
-    q.prepare("SELECT subject, status FROM attendance WHERE roll_no=?");
-    q.addBindValue(rollNo);
-    if (!q.exec())
+void SRMSWindow::onQueryFinished(quint64, const QString &channel, const QVariant &result)
+{
+    if (channel == "export") {
+        exportBtn->setEnabled(true);
+        teacherStatusLabel->clear();
+        QMessageBox::information(this, "Export", "Export finished.\n\n"
+                                 + result.value<DataExportStats>().summary());
+        return;
+    }
+    if (channel == "import") {
+        importBtn->setEnabled(true);
+        CsvImportStats stats = result.value<CsvImportStats>();
+        teacherStatusLabel->clear();
+        QMessageBox::information(this, "Import CSV", "Import finished.\n\n" + stats.summary());
+        loadStudentRecords();
+        return;
+    }
+    if (channel != "cgpa.recompute")
+        return;
+
+    recomputeBtn->setEnabled(true);
+    CgpaRecomputeStats stats = result.value<CgpaRecomputeStats>();
+    QMessageBox::information(this, "Recompute CGPA", "CGPA recomputed.\n\n" + stats.summary());
+    loadStudentRecords();
+}
+
+void SRMSWindow::onQueryFailed(quint64, const QString &channel, const QString &error)
+{
+    if (channel == "export") {
+        exportBtn->setEnabled(true);
+        teacherStatusLabel->clear();
+        QMessageBox::critical(this, "Export", "Export failed:\n" + error);
+        return;
+    }
+    if (channel == "import") {
+        importBtn->setEnabled(true);
+        teacherStatusLabel->clear();
+        QMessageBox::critical(this, "Import CSV", "Import failed, nothing was imported:\n" + error);
+        return;
+    }
+    if (channel != "cgpa.recompute")
         return;
 
-    while (q.next()) {
-        int row = studentAttendanceTable->rowCount();
-        studentAttendanceTable->insertRow(row);
+    recomputeBtn->setEnabled(true);
+    teacherStatusLabel->clear();
+    QMessageBox::critical(this, "Recompute CGPA", "CGPA recompute failed:\n" + error);
+}
 
-        QString subject = q.value(0).toString();
-        QString status = q.value(1).toString();
+// =========================================
+// Student view: details, marks & attendance
+// =========================================
 
-        studentAttendanceTable->setItem(row, 0, new QTableWidgetItem(subject));
-        studentAttendanceTable->setItem(row, 1, new QTableWidgetItem(status));
+// Details, marks and attendance come from one query, or from the profile
+// cache when the student was shown recently and nothing of theirs changed
+void SRMSWindow::showStudentProfile(const QString &rollNo)
+{
+    StudentProfileRepository profiles(db);
+    StudentProfile profile;
+    if (!profiles.load(rollNo, profile)) {
+        QMessageBox::critical(this, "Student Portal",
+                              "Could not load your records:\n" + profiles.lastError());
+        return;
+    }
+
+    if (profile.found) {
+        const StudentRecord &student = profile.student;
+        QString details = QString(
+                              "Name: %1\nEmail: %2\nBranch: %3\nYear: %4\nGender: %5\nCGPA: %6")
+                              .arg(student.name)
+                              .arg(student.email)
+                              .arg(student.branch)
+                              .arg(student.year)
+                              .arg(student.gender)
+                              .arg(student.cgpa);
+        studentDetailsLabel->setText(details);
+    } else {
+        studentDetailsLabel->setText("No student record found for this roll number.");
+    }
+
+    fillStudentMarks(profile);
+    fillStudentAttendance(profile);
+}
+
+// Both tables are sized once and filled with repaints off, rather than
+// growing a row at a time
+void SRMSWindow::fillStudentMarks(const StudentProfile &profile)
+{
+    CohortRanking ranking(db);
+    QHash<CohortRanking::Key, CohortStanding> standings;
+    if (!ranking.rank(profile.averages, standings))
+        qWarning() << "Class ranks unavailable:" << ranking.lastError();
+
+    studentMarksTable->setUpdatesEnabled(false);
+    studentMarksTable->clearSpans();
+    studentMarksTable->setRowCount(profile.marks.size());
+
+    for (int row = 0; row < profile.marks.size(); row++) {
+        const MarkRecord &mark = profile.marks[row];
+        const CohortStanding standing = standings.value(qMakePair(mark.subject, mark.examType));
+        studentMarksTable->setItem(row, 0, new QTableWidgetItem(mark.subject));
+        studentMarksTable->setItem(row, 1, new QTableWidgetItem(mark.examType));
+        studentMarksTable->setItem(row, 2, new QTableWidgetItem(QString::number(mark.marks)));
+        studentMarksTable->setItem(row, 3, new QTableWidgetItem(QString::number(mark.maxMarks)));
+        studentMarksTable->setItem(row, 4, new QTableWidgetItem(QString::number(mark.percentage(), 'f', 1) + "%"));
+        studentMarksTable->setItem(row, 5, new QTableWidgetItem(standing.rankText()));
+        studentMarksTable->setItem(row, 6, new QTableWidgetItem(
+            standing.cohort > 0 ? QString::number(standing.percentile, 'f', 1) : "-"));
+    }
+
+    if (profile.marks.isEmpty()) {
+        studentMarksTable->setRowCount(1);
+        studentMarksTable->setItem(0, 0, new QTableWidgetItem("No marks entered yet"));
+        studentMarksTable->setSpan(0, 0, 1, 7);
+    }
+    studentMarksTable->setUpdatesEnabled(true);
+}
+
+void SRMSWindow::fillStudentAttendance(const StudentProfile &profile)
+{
+    studentAttendanceTable->setUpdatesEnabled(false);
+    studentAttendanceTable->clearSpans();
+    studentAttendanceTable->setRowCount(profile.attendance.size());
+
+    for (int row = 0; row < profile.attendance.size(); row++) {
+        const AttendanceSummary &summary = profile.attendance[row];
+        studentAttendanceTable->setItem(row, 0, new QTableWidgetItem(summary.subject));
+        studentAttendanceTable->setItem(row, 1, new QTableWidgetItem(QString::number(summary.present)));
+        studentAttendanceTable->setItem(row, 2, new QTableWidgetItem(QString::number(summary.held)));
+        studentAttendanceTable->setItem(row, 3, new QTableWidgetItem(QString::number(summary.percentage(), 'f', 1) + "%"));
     }
 
-    if (studentAttendanceTable->rowCount() == 0) {
-        studentAttendanceTable->insertRow(0);
+    if (profile.attendance.isEmpty()) {
+        studentAttendanceTable->setRowCount(1);
         studentAttendanceTable->setItem(0, 0, new QTableWidgetItem("No attendance marked yet"));
-        studentAttendanceTable->setSpan(0, 0, 1, 2);
+        studentAttendanceTable->setSpan(0, 0, 1, 4);
     }
+    studentAttendanceTable->setUpdatesEnabled(true);
 }
@@ -6,10 +6,17 @@
 #include <QTableWidget>
 #include <QLineEdit>
 #include <QSqlDatabase>
-#include <QSqlTableModel>
 #include <QLabel>
 #include <QPushButton>
 #include <QStackedWidget>
+#include <QElapsedTimer>
+
+#include "dashboardrepository.h"
+
+class StudentTableModel;
+struct StudentProfile;
+class QueryExecutor;
+class QTimer;
 
 enum class UserRole {
     Teacher,
@@ -38,14 +45,34 @@ private slots:
     // Teacher: marks & attendance
     void onManageMarks();
     void onManageAttendance();
+    void onRecomputeCgpa();
+    void onImportCsv();
+    void onExport();
+    void onShowDiagnostics();
+
+    // Teacher: class dashboard
+    void onShowDashboard();
+    void onRefreshDashboard();
+    void onDashboardClassSelected();
+    void onCloseDashboard();
 
     // Teacher: search
     void onSearch();
     void onResetSearch();
+    void onSearchTextEdited();
+
+    // Student table paging
+    void onStudentsLoaded(int loadedRows, bool complete);
+    void onStudentsLoadFailed(const QString &error);
+
+    // Results from the query worker
+    void onQueryFinished(quint64 ticket, const QString &channel, const QVariant &result);
+    void onQueryFailed(quint64 ticket, const QString &channel, const QString &error);
 
 private:
     // Database
     QSqlDatabase db;
+    QueryExecutor *executor;
     void initDatabase();
 
     // Shared
@@ -60,11 +87,27 @@ private:
     // Teacher page
     QWidget        *teacherPage;
     QLabel         *teacherHeaderLabel;
-    QLineEdit      *searchBox;
-    QTableView     *studentTable;
-    QSqlTableModel *studentModel;
+    QLineEdit         *searchBox;
+    QLabel            *teacherStatusLabel;
+    QTableView        *studentTable;
+    StudentTableModel *studentModel;
+    QString            currentSearch;
+    QTimer            *searchDebounce;
+    QElapsedTimer      keystrokeTimer;
+    QLabel            *searchOverlay;
+    QPushButton       *recomputeBtn;
+    QPushButton       *importBtn;
+    QPushButton       *exportBtn;
     QPushButton    *logoutButtonTeacher;
 
+    // Dashboard page
+    QWidget              *dashboardPage;
+    QLabel               *dashboardStatusLabel;
+    QTableWidget         *classTable;
+    QTableWidget         *classSubjectTable;
+    QTableWidget         *classAttendanceTable;
+    QVector<ClassSummary> dashboardClasses;
+
     // Student page
     QWidget        *studentPage;
     QLabel         *studentHeaderLabel;
@@ -82,6 +125,7 @@ private:
     void setupLoginUI();
     void setupTeacherUI();
     void setupStudentUI();
+    void setupDashboardUI();
 
     // Helpers
     bool validateLogin(const QString &username,
@@ -89,9 +133,14 @@ private:
                        QString &outRollNo,
                        UserRole &outRole);
 
+    static const int SearchDebounceMs = 150;
+
     void loadStudentRecords();
-    void loadStudentMarks(const QString &rollNo);
-    void loadStudentAttendance(const QString &rollNo);
+    void reportSearchLatency(qint64 elapsedMs);
+    void showStudentProfile(const QString &rollNo);
+    void fillStudentMarks(const StudentProfile &profile);
+    void fillStudentAttendance(const StudentProfile &profile);
+    void showClassDetails(const ClassSummary &summary);
 
     void showStudentDialog(bool isEdit = false);
 };
@@ -0,0 +1,93 @@
+#include "statementcache.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+// Connections are per thread, so each cache is only used by the thread that
+// owns its connection. The mutex only guards the registry itself.
+QMutex registryMutex;
+QHash<QString, StatementCache *> registry;
+}
+
+StatementCache::StatementCache(const QSqlDatabase &database)
+    : db(database),
+      failed(database),
+      hitCount(0),
+      missCount(0)
+{
+}
+
+StatementCache::~StatementCache()
+{
+    clear();
+}
+
+StatementCache &StatementCache::forDatabase(const QSqlDatabase &db)
+{
+    QMutexLocker lock(&registryMutex);
+
+    StatementCache *&cache = registry[db.connectionName()];
+    if (!cache)
+        cache = new StatementCache(db);
+    return *cache;
+}
+
+// Call before the connection is closed or removed
+void StatementCache::release(const QString &connectionName)
+{
+    StatementCache *cache = nullptr;
+    {
+        QMutexLocker lock(&registryMutex);
+        cache = registry.take(connectionName);
+    }
+    if (cache) {
+        qInfo() << "Statement cache" << connectionName << ":" << cache->size() << "statements,"
+                << cache->hits() << "hits," << cache->misses() << "misses";
+        delete cache;
+    }
+}
+
+QSqlQuery &StatementCache::prepared(const QString &sql)
+{
+    QSqlQuery *query = statements.value(sql, nullptr);
+    if (query) {
+        hitCount++;
+        query->finish();    // reset the statement, keep the prepared handle
+        return *query;
+    }
+
+    missCount++;
+    query = new QSqlQuery(db);
+    if (!query->prepare(sql)) {
+        // Not cached; the caller sees the error from exec()/lastError()
+        failed = *query;
+        delete query;
+        return failed;
+    }
+
+    statements.insert(sql, query);
+    return *query;
+}
+
+quint64 StatementCache::hits() const
+{
+    return hitCount;
+}
+
+quint64 StatementCache::misses() const
+{
+    return missCount;
+}
+
+int StatementCache::size() const
+{
+    return statements.size();
+}
+
+void StatementCache::clear()
+{
+    qDeleteAll(statements);
+    statements.clear();
+}
@@ -0,0 +1,38 @@
+#ifndef STATEMENTCACHE_H
+#define STATEMENTCACHE_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QHash>
+#include <QString>
+
+// Prepared statements keyed by SQL text, one cache per connection. A handle
+// is prepared on first use and kept until the connection is released, so
+// repeated clicks only bind and execute. Use the returned query right away
+// and exec() it before asking for the same SQL again; bound values left from
+// the previous use are overwritten by the new ones.
+class StatementCache
+{
+public:
+    static StatementCache &forDatabase(const QSqlDatabase &db);
+    static void release(const QString &connectionName);
+
+    QSqlQuery &prepared(const QString &sql);
+
+    quint64 hits() const;
+    quint64 misses() const;
+    int size() const;
+    void clear();
+
+private:
+    explicit StatementCache(const QSqlDatabase &database);
+    ~StatementCache();
+
+    QSqlDatabase db;
+    QHash<QString, QSqlQuery *> statements;
+    QSqlQuery failed;
+    quint64 hitCount;
+    quint64 missCount;
+};
+
+#endif // STATEMENTCACHE_H
@@ -0,0 +1,185 @@
+#include "studentprofile.h"
+#include "attendancebitmap.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QMap>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace {
+// Keyed by database file and roll number, like the other process-wide
+// caches. generation counts invalidations, so a profile read while a
+// write was dropping it is not put back stale.
+QMutex cacheMutex;
+QCache<QString, StudentProfile> cache(StudentProfileRepository::MaxCached);
+quint64 generation = 0;
+
+QString cacheKey(const QSqlDatabase &db, const QString &rollNo)
+{
+    return db.databaseName() + QLatin1Char('\n') + rollNo;
+}
+}
+
+// One row per piece, the first column saying which:
+//   0  name, email, branch, year, gender, cgpa, ordinal
+//   1  mark_id, subject, marks, max_marks, exam_type
+//   2  subject, exam_type, average percentage
+//   3  ordinal, subject, roster block, present block
+// CROSS JOIN keeps every part on its roll_no / block index.
+QString StudentProfileRepository::query()
+{
+    return QString("WITH me(roll_no) AS (SELECT ?) "
+                   "SELECT 0, s.name, s.email, s.branch, s.year, s.gender, s.cgpa, o.ordinal "
+                   "FROM me CROSS JOIN students s ON s.roll_no = me.roll_no "
+                   "LEFT JOIN student_ordinals o ON o.roll_no = s.roll_no "
+                   "UNION ALL "
+                   "SELECT 1, m.mark_id, m.subject, m.marks, m.max_marks, m.exam_type, NULL, NULL "
+                   "FROM me CROSS JOIN marks m ON m.roll_no = me.roll_no "
+                   "UNION ALL "
+                   "SELECT 2, a.subject, a.exam_type, a.sum_pct / a.n, NULL, NULL, NULL, NULL "
+                   "FROM me CROSS JOIN marks_agg a ON a.roll_no = me.roll_no WHERE a.n > 0 "
+                   "UNION ALL "
+                   "SELECT 3, o.ordinal, t.subject, b.roster, b.present, NULL, NULL, NULL "
+                   "FROM me CROSS JOIN student_ordinals o ON o.roll_no = me.roll_no "
+                   "CROSS JOIN attendance_bits b ON b.block = o.ordinal / %1 "
+                   "CROSS JOIN attendance_sessions t ON t.session_id = b.session_id")
+        .arg(AttendanceBitmap::BlockBits);
+}
+
+StudentProfileRepository::StudentProfileRepository(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QString StudentProfileRepository::lastError() const
+{
+    return error;
+}
+
+bool StudentProfileRepository::load(const QString &rollNo, StudentProfile &out)
+{
+    const QString key = cacheKey(db, rollNo);
+    quint64 readGeneration;
+    {
+        QMutexLocker lock(&cacheMutex);
+        if (const StudentProfile *cached = cache.object(key)) {
+            out = *cached;
+            return true;
+        }
+        readGeneration = generation;
+    }
+
+    if (!read(rollNo, out))
+        return false;
+
+    QMutexLocker lock(&cacheMutex);
+    if (generation == readGeneration)
+        cache.insert(key, new StudentProfile(out));
+    return true;
+}
+
+bool StudentProfileRepository::read(const QString &rollNo, StudentProfile &out)
+{
+    out = StudentProfile();
+    out.student.rollNo = rollNo;
+
+    static const QString sql = query();
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+
+    QMap<QString, AttendanceSummary> bySubject;
+    while (trace.next()) {
+        switch (q.value(0).toInt()) {
+        case 0:
+            out.found          = true;
+            out.student.name   = q.value(1).toString();
+            out.student.email  = q.value(2).toString();
+            out.student.branch = q.value(3).toString();
+            out.student.year   = q.value(4).toInt();
+            out.student.gender = q.value(5).toString();
+            out.student.cgpa   = q.value(6).toDouble();
+            if (!q.value(7).isNull())
+                out.ordinal = q.value(7).toInt();
+            break;
+        case 1: {
+            MarkRecord m;
+            m.markId   = q.value(1).toInt();
+            m.rollNo   = rollNo;
+            m.subject  = q.value(2).toString();
+            m.marks    = q.value(3).toInt();
+            m.maxMarks = q.value(4).toInt();
+            m.examType = q.value(5).toString();
+            out.marks.append(m);
+            break;
+        }
+        case 2:
+            out.averages.insert(qMakePair(q.value(1).toString(), q.value(2).toString()),
+                                float(q.value(3).toDouble()));
+            break;
+        case 3: {
+            // As AttendanceRepository::summaryForStudent()
+            out.ordinal = q.value(1).toInt();
+            const int offset = out.ordinal % AttendanceBitmap::BlockBits;
+            if (!AttendanceBitmap::blockContains(q.value(3).toByteArray(), offset))
+                break;
+            AttendanceSummary &summary = bySubject[q.value(2).toString()];
+            summary.held++;
+            if (AttendanceBitmap::blockContains(q.value(4).toByteArray(), offset))
+                summary.present++;
+            break;
+        }
+        }
+    }
+
+    for (auto it = bySubject.begin(); it != bySubject.end(); ++it) {
+        it.value().subject = it.key();
+        out.attendance.append(it.value());
+    }
+    return true;
+}
+
+// =========================================
+// Invalidation
+// =========================================
+
+void StudentProfileRepository::invalidate(const QSqlDatabase &db, const QString &rollNo)
+{
+    QMutexLocker lock(&cacheMutex);
+    generation++;
+    cache.remove(cacheKey(db, rollNo));
+}
+
+void StudentProfileRepository::attendanceChanged(const QSqlDatabase &db,
+                                                 const AttendanceBitmap &roster)
+{
+    QMutexLocker lock(&cacheMutex);
+    generation++;
+    const QString prefix = cacheKey(db, QString());
+    for (const QString &key : cache.keys()) {
+        const StudentProfile *profile = cache.object(key);
+        if (key.startsWith(prefix) && profile && roster.test(profile->ordinal))
+            cache.remove(key);
+    }
+}
+
+void StudentProfileRepository::invalidateAll(const QSqlDatabase &db)
+{
+    QMutexLocker lock(&cacheMutex);
+    generation++;
+    const QString prefix = cacheKey(db, QString());
+    for (const QString &key : cache.keys()) {
+        if (key.startsWith(prefix))
+            cache.remove(key);
+    }
+}
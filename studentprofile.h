@@ -0,0 +1,64 @@
+#ifndef STUDENTPROFILE_H
+#define STUDENTPROFILE_H
+
+#include <QSqlDatabase>
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+#include "studentrepository.h"
+#include "marksrepository.h"
+#include "attendancerepository.h"
+#include "cohortranking.h"
+
+class AttendanceBitmap;
+
+// Everything the student page shows for one roll number
+struct StudentProfile
+{
+    bool found = false;             // false: no students row
+    StudentRecord student;
+    int ordinal = -1;               // student_ordinals.ordinal, -1 if none
+    QVector<MarkRecord> marks;
+    QHash<CohortRanking::Key, float> averages;  // marks_agg, for CohortRanking::rank()
+    QVector<AttendanceSummary> attendance;      // by subject
+};
+
+// Loads a StudentProfile in one query (details, marks, mark averages and
+// attendance blocks as one UNION ALL) and keeps the last MaxCached
+// profiles per process, keyed by database file and roll number, so a
+// student reopening or refreshing the page reads nothing.
+//
+// The write paths drop what they change: StudentRepository and
+// MarksRepository the roll number they wrote, AttendanceRepository::save()
+// the students on the saved roster, and bulk writes (imports, the
+// generator, CGPA recompute) the whole database. Class ranks are not
+// cached here; they come from CohortRanking's own cache.
+class StudentProfileRepository
+{
+public:
+    static const int MaxCached = 512;
+
+    explicit StudentProfileRepository(const QSqlDatabase &database);
+
+    // false only on a query error; an unknown roll number gives a profile
+    // with found false
+    bool load(const QString &rollNo, StudentProfile &out);
+
+    // The one statement, bound to a roll number; SchemaMigrator checks its plan
+    static QString query();
+
+    static void invalidate(const QSqlDatabase &db, const QString &rollNo);
+    static void attendanceChanged(const QSqlDatabase &db, const AttendanceBitmap &roster);
+    static void invalidateAll(const QSqlDatabase &db);
+
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+
+    bool read(const QString &rollNo, StudentProfile &out);
+};
+
+#endif // STUDENTPROFILE_H
@@ -0,0 +1,381 @@
+#include "studentrepository.h"
+#include "statementcache.h"
+#include "querystats.h"
+#include "marksnapshot.h"
+#include "cohortranking.h"
+#include "studentprofile.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QVariant>
+#include <QSet>
+#include <QPair>
+#include <QStringList>
+
+#include <algorithm>
+
+StudentRepository::StudentRepository(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+bool StudentRepository::find(const QString &rollNo, StudentRecord &out)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT name, email, branch, year, gender, cgpa "
+        "FROM students WHERE roll_no=?");
+    q.addBindValue(rollNo);
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    if (!trace.next())
+        return false;
+
+    out.rollNo = rollNo;
+    out.name   = q.value(0).toString();
+    out.email  = q.value(1).toString();
+    out.branch = q.value(2).toString();
+    out.year   = q.value(3).toInt();
+    out.gender = q.value(4).toString();
+    out.cgpa   = q.value(5).toDouble();
+    trace.finish();
+    return true;
+}
+
+QVector<StudentRecord> StudentRepository::byClass(const QString &branch, int year)
+{
+    // Filters are bound rather than spliced in, so each of the four filter
+    // combinations maps to one cached statement
+    QString sql = "SELECT roll_no, name, email, branch, year, gender, cgpa "
+                  "FROM students WHERE 1=1";
+    if (!branch.isEmpty())
+        sql += " AND branch = ?";
+    if (year > 0)
+        sql += " AND year = ?";
+    sql += " ORDER BY roll_no";
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    if (!branch.isEmpty())
+        q.addBindValue(branch);
+    if (year > 0)
+        q.addBindValue(year);
+
+    return readAll(q);
+}
+
+QVector<StudentRecord> StudentRepository::page(const QString &afterRollNo, int limit)
+{
+    // roll_no is the primary key, so "roll_no > ?" is a range search on its
+    // index and the cost of a page does not grow with how far in it starts
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students "
+        "WHERE roll_no > ? ORDER BY roll_no LIMIT ?");
+    q.addBindValue(afterRollNo);
+    q.addBindValue(limit);
+    return readAll(q);
+}
+
+// =========================================
+// Search
+// =========================================
+
+// Upper bound for a prefix range: sorts after every string starting with
+// prefix, in both BINARY and NOCASE order
+static QString prefixEnd(const QString &prefix)
+{
+    return prefix + QChar(0xFFFF);
+}
+
+// FTS5 query string matching text literally
+static QString ftsPhrase(const QString &text)
+{
+    QString escaped = text;
+    escaped.replace('"', "\"\"");
+    return '"' + escaped + '"';
+}
+
+static QSet<QString> trigrams(const QString &text)
+{
+    QString folded = text.toLower();
+    QSet<QString> out;
+    for (int i = 0; i + 3 <= folded.size(); i++)
+        out.insert(folded.mid(i, 3));
+    return out;
+}
+
+QVector<StudentRecord> StudentRepository::search(const QString &text, int limit,
+                                                 const QueryCancelToken &token)
+{
+    QString needle = text.trimmed();
+    if (needle.isEmpty() || limit <= 0)
+        return QVector<StudentRecord>();
+
+    if (!hasSearchIndex())
+        return searchScan(needle, limit);
+
+    // Each tier only fills what the ones before it left over; a student
+    // found by an earlier tier keeps that rank
+    QVector<StudentRecord> results;
+    QSet<QString> seen;
+    auto append = [&](const QVector<StudentRecord> &tier) {
+        for (const StudentRecord &s : tier) {
+            if (results.size() >= limit)
+                return;
+            if (!seen.contains(s.rollNo)) {
+                seen.insert(s.rollNo);
+                results.append(s);
+            }
+        }
+    };
+
+    append(searchPrefix(needle, limit));
+
+    // Trigrams need at least three characters
+    if (needle.size() >= 3 && results.size() < limit && !token.isCancelled())
+        append(searchSubstring(needle, limit));
+    if (needle.size() >= 4 && results.size() < limit && !token.isCancelled())
+        append(searchFuzzy(needle, limit));
+
+    return results;
+}
+
+bool StudentRepository::hasSearchIndex()
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'students_fts'");
+    QueryTrace trace(q);
+    bool found = trace.exec() && trace.next();
+    trace.finish();
+    return found;
+}
+
+// Roll numbers first, then names; both are index range searches
+QVector<StudentRecord> StudentRepository::searchPrefix(const QString &text, int limit)
+{
+    StatementCache &statements = StatementCache::forDatabase(db);
+
+    QSqlQuery &byRoll = statements.prepared(
+        "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students "
+        "WHERE roll_no >= ? AND roll_no < ? ORDER BY roll_no LIMIT ?");
+    byRoll.addBindValue(text);
+    byRoll.addBindValue(prefixEnd(text));
+    byRoll.addBindValue(limit);
+    QVector<StudentRecord> students = readAll(byRoll);
+
+    QSqlQuery &byName = statements.prepared(
+        "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students "
+        "WHERE name >= ? COLLATE NOCASE AND name < ? COLLATE NOCASE "
+        "ORDER BY name COLLATE NOCASE LIMIT ?");
+    byName.addBindValue(text);
+    byName.addBindValue(prefixEnd(text));
+    byName.addBindValue(limit);
+    students += readAll(byName);
+
+    return students;
+}
+
+// Substring anywhere in roll no, name or email, best bm25 rank first
+QVector<StudentRecord> StudentRepository::searchSubstring(const QString &text, int limit)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT s.roll_no, s.name, s.email, s.branch, s.year, s.gender, s.cgpa "
+        "FROM (SELECT rowid, rank FROM students_fts WHERE students_fts MATCH ? "
+        "      ORDER BY rank LIMIT ?) hit "
+        "JOIN student_ordinals o ON o.ordinal = hit.rowid "
+        "JOIN students s ON s.roll_no = o.roll_no "
+        "ORDER BY hit.rank");
+    q.addBindValue(ftsPhrase(text));
+    q.addBindValue(limit);
+    return readAll(q);
+}
+
+// Names sharing trigrams with text, for misspellings. FTS5 narrows the
+// candidates to names with any trigram in common; they are kept if they
+// contain at least half of the trigrams of text, most similar first.
+QVector<StudentRecord> StudentRepository::searchFuzzy(const QString &text, int limit)
+{
+    QSet<QString> wanted = trigrams(text);
+    if (wanted.isEmpty())
+        return QVector<StudentRecord>();
+
+    QStringList terms;
+    for (const QString &t : wanted)
+        terms << ftsPhrase(t);
+
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT s.roll_no, s.name, s.email, s.branch, s.year, s.gender, s.cgpa "
+        "FROM (SELECT rowid, rank FROM students_fts WHERE students_fts MATCH ? "
+        "      ORDER BY rank LIMIT ?) hit "
+        "JOIN student_ordinals o ON o.ordinal = hit.rowid "
+        "JOIN students s ON s.roll_no = o.roll_no "
+        "ORDER BY hit.rank");
+    q.addBindValue("name : (" + terms.join(" OR ") + ")");
+    q.addBindValue(limit * 4);
+    QVector<StudentRecord> candidates = readAll(q);
+
+    QVector<QPair<double, StudentRecord>> scored;
+    for (const StudentRecord &s : candidates) {
+        int shared = (trigrams(s.name) & wanted).size();
+        double similarity = double(shared) / wanted.size();
+        if (similarity >= 0.5)
+            scored.append(qMakePair(similarity, s));
+    }
+    std::stable_sort(scored.begin(), scored.end(),
+                     [](const QPair<double, StudentRecord> &a, const QPair<double, StudentRecord> &b) {
+                         return a.first > b.first;
+                     });
+
+    QVector<StudentRecord> students;
+    for (int i = 0; i < scored.size() && i < limit; i++)
+        students.append(scored[i].second);
+    return students;
+}
+
+// Without the FTS5 index: leading-wildcard LIKE, a full table scan
+QVector<StudentRecord> StudentRepository::searchScan(const QString &text, int limit)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT roll_no, name, email, branch, year, gender, cgpa FROM students "
+        "WHERE roll_no LIKE ? OR name LIKE ? OR email LIKE ? "
+        "ORDER BY roll_no LIMIT ?");
+    QString pattern = "%" + text + "%";
+    q.addBindValue(pattern);
+    q.addBindValue(pattern);
+    q.addBindValue(pattern);
+    q.addBindValue(limit);
+
+    return readAll(q);
+}
+
+bool StudentRepository::insert(const StudentRecord &student)
+{
+    return write("INSERT INTO students (roll_no, name, email, branch, year, gender) "
+                 "VALUES (?, ?, ?, ?, ?, ?)", student);
+}
+
+bool StudentRepository::upsert(const StudentRecord &student)
+{
+    // A real UPSERT rather than INSERT OR REPLACE: REPLACE deletes the old
+    // row without firing delete triggers (students_fts) and resets cgpa
+    return write("INSERT INTO students "
+                 "(roll_no, name, email, branch, year, gender) "
+                 "VALUES (?, ?, ?, ?, ?, ?) "
+                 "ON CONFLICT(roll_no) DO UPDATE SET "
+                 " name = excluded.name, email = excluded.email,"
+                 " branch = excluded.branch, year = excluded.year,"
+                 " gender = excluded.gender", student);
+}
+
+bool StudentRepository::update(const StudentRecord &student)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "UPDATE students SET name=?, email=?, branch=?, year=?, gender=? "
+        "WHERE roll_no=?");
+    q.addBindValue(student.name.trimmed());
+    q.addBindValue(student.email.trimmed());
+    q.addBindValue(student.branch.trimmed());
+    q.addBindValue(student.year);
+    q.addBindValue(student.gender.trimmed());
+    q.addBindValue(student.rollNo.trimmed());
+
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    MarksSnapshot::studentChanged(db, student.rollNo.trimmed());
+    StudentProfileRepository::invalidate(db, student.rollNo.trimmed());
+    return true;
+}
+
+// Also deletes the user account for that roll_no
+bool StudentRepository::remove(const QString &rollNo)
+{
+    StatementCache &statements = StatementCache::forDatabase(db);
+
+    QSqlQuery &qs = statements.prepared("DELETE FROM students WHERE roll_no=?");
+    qs.addBindValue(rollNo);
+    if (!QueryTrace(qs).exec()) {
+        error = qs.lastError().text();
+        return false;
+    }
+    MarksSnapshot::studentChanged(db, rollNo);
+    CohortRanking::invalidateAll(db);
+    StudentProfileRepository::invalidate(db, rollNo);
+
+    QSqlQuery &qu = statements.prepared("DELETE FROM users WHERE user_id=?");
+    qu.addBindValue(rollNo);
+    if (!QueryTrace(qu).exec()) {
+        error = qu.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool StudentRepository::setCgpa(const QString &rollNo, double cgpa)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "UPDATE students SET cgpa = ? WHERE roll_no = ?");
+    q.addBindValue(cgpa);
+    q.addBindValue(rollNo);
+
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    StudentProfileRepository::invalidate(db, rollNo);
+    return true;
+}
+
+QString StudentRepository::lastError() const
+{
+    return error;
+}
+
+bool StudentRepository::write(const QString &sql, const StudentRecord &student)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(sql);
+    q.addBindValue(student.rollNo.trimmed());
+    q.addBindValue(student.name.trimmed());
+    q.addBindValue(student.email.trimmed());
+    q.addBindValue(student.branch.trimmed());
+    q.addBindValue(student.year);
+    q.addBindValue(student.gender.trimmed());
+
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    MarksSnapshot::studentChanged(db, student.rollNo.trimmed());
+    // Marks left from a deleted student of the same roll_no count again
+    CohortRanking::invalidateAll(db);
+    StudentProfileRepository::invalidate(db, student.rollNo.trimmed());
+    return true;
+}
+
+// Columns: roll_no, name, email, branch, year, gender, cgpa
+QVector<StudentRecord> StudentRepository::readAll(QSqlQuery &q)
+{
+    QVector<StudentRecord> students;
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return students;
+    }
+
+    while (trace.next()) {
+        StudentRecord s;
+        s.rollNo = q.value(0).toString();
+        s.name   = q.value(1).toString();
+        s.email  = q.value(2).toString();
+        s.branch = q.value(3).toString();
+        s.year   = q.value(4).toInt();
+        s.gender = q.value(5).toString();
+        s.cgpa   = q.value(6).toDouble();
+        students.append(s);
+    }
+    return students;
+}
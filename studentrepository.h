@@ -0,0 +1,69 @@
+#ifndef STUDENTREPOSITORY_H
+#define STUDENTREPOSITORY_H
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QVector>
+#include <QMetaType>
+
+#include "querycanceltoken.h"
+
+struct StudentRecord
+{
+    QString rollNo;
+    QString name;
+    QString email;
+    QString branch;
+    int     year = 0;
+    QString gender;
+    double  cgpa = 0.0;
+};
+
+Q_DECLARE_METATYPE(StudentRecord)
+
+class StudentRepository
+{
+public:
+    explicit StudentRepository(const QSqlDatabase &database);
+
+    bool find(const QString &rollNo, StudentRecord &out);
+
+    // Empty branch / year 0 means all branches / years
+    QVector<StudentRecord> byClass(const QString &branch = QString(), int year = 0);
+
+    // Ranked search on roll no, name and email, best first: roll no and
+    // name prefixes, then substrings, then names that are close to text
+    // (shared trigrams). Needs the students_fts index for the last two and
+    // falls back to a plain LIKE scan without it. Stops between tiers once
+    // token is cancelled.
+    QVector<StudentRecord> search(const QString &text, int limit = 500,
+                                  const QueryCancelToken &token = QueryCancelToken());
+
+    // Keyset page in roll_no order: up to limit students after afterRollNo
+    // (empty = from the start)
+    QVector<StudentRecord> page(const QString &afterRollNo, int limit);
+
+    bool insert(const StudentRecord &student);
+    bool upsert(const StudentRecord &student);
+    bool update(const StudentRecord &student);
+    bool remove(const QString &rollNo);
+    bool setCgpa(const QString &rollNo, double cgpa);
+
+    QString lastError() const;
+
+private:
+    QSqlDatabase db;
+    QString error;
+
+    bool write(const QString &sql, const StudentRecord &student);
+    QVector<StudentRecord> readAll(QSqlQuery &q);
+
+    bool hasSearchIndex();
+    QVector<StudentRecord> searchPrefix(const QString &text, int limit);
+    QVector<StudentRecord> searchSubstring(const QString &text, int limit);
+    QVector<StudentRecord> searchFuzzy(const QString &text, int limit);
+    QVector<StudentRecord> searchScan(const QString &text, int limit);
+};
+
+#endif // STUDENTREPOSITORY_H
@@ -0,0 +1,287 @@
+#include "studenttablemodel.h"
+#include "queryexecutor.h"
+
+#include <algorithm>
+
+static const QString PageChannel = "students.page";
+static const QString RowChannelPrefix = "students.row.";
+
+StudentTableModel::StudentTableModel(QueryExecutor *executor, QObject *parent)
+    : QAbstractTableModel(parent),
+      executor(executor),
+      complete(true),
+      fetching(false),
+      exhaustive(false),
+      fetchMs(0),
+      refined(false)
+{
+    connect(executor, &QueryExecutor::finished, this, &StudentTableModel::onQueryFinished);
+    connect(executor, &QueryExecutor::failed, this, &StudentTableModel::onQueryFailed);
+}
+
+int StudentTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int StudentTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant StudentTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size())
+        return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::EditRole)
+        return QVariant();
+
+    const StudentRecord &s = rows[index.row()];
+    switch (index.column()) {
+    case RollNoColumn: return s.rollNo;
+    case NameColumn:   return s.name;
+    case EmailColumn:  return s.email;
+    case BranchColumn: return s.branch;
+    case YearColumn:   return s.year;
+    case GenderColumn: return s.gender;
+    case CgpaColumn:   return s.cgpa;
+    default:           return QVariant();
+    }
+}
+
+QVariant StudentTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case RollNoColumn: return "Roll No";
+    case NameColumn:   return "Name";
+    case EmailColumn:  return "Email";
+    case BranchColumn: return "Branch";
+    case YearColumn:   return "Year";
+    case GenderColumn: return "Gender";
+    case CgpaColumn:   return "CGPA";
+    default:           return QVariant();
+    }
+}
+
+// =========================================
+// Paging
+// =========================================
+
+bool StudentTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !complete && !fetching;
+}
+
+void StudentTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (!canFetchMore(parent))
+        return;
+
+    fetching = true;
+    fetchTimer.start();
+    QString after = rows.isEmpty() ? QString() : rows.last().rollNo;
+    QString text = currentFilter;
+
+    // A search is ranked, not in roll_no order, so it arrives as one page
+    executor->submit(PageChannel, [after, text](QSqlDatabase &db, const QueryCancelToken &token, QString &error) {
+        StudentRepository repository(db);
+        QVector<StudentRecord> students = text.isEmpty()
+                                              ? repository.page(after, PageSize)
+                                              : repository.search(text, SearchLimit, token);
+        error = repository.lastError();
+        return QVariant::fromValue(students);
+    });
+}
+
+void StudentTableModel::setFilter(const QString &filter)
+{
+    if (refine(filter))
+        return;
+
+    beginResetModel();
+    rows.clear();
+    currentFilter = filter;
+    complete = false;
+    fetching = false;
+    exhaustive = false;
+    endResetModel();
+
+    // Supersedes a page of the previous filter still on its way
+    fetchMore(QModelIndex());
+}
+
+QString StudentTableModel::filter() const
+{
+    return currentFilter;
+}
+
+qint64 StudentTableModel::lastFetchMs() const
+{
+    return fetchMs;
+}
+
+bool StudentTableModel::lastFetchRefined() const
+{
+    return refined;
+}
+
+// Typing on extends the previous search. If the loaded rows hold every
+// substring match of the previous text, the matches of the longer text are
+// among them and are filtered here instead of asking SQLite again. Prefix
+// matches move to the front, as StudentRepository::search ranks them.
+// Fuzzy matches are only found by a real query, so an empty refinement
+// falls through to one.
+bool StudentTableModel::refine(const QString &filter)
+{
+    if (!exhaustive || fetching || currentFilter.isEmpty() || filter == currentFilter
+        || !filter.contains(currentFilter, Qt::CaseInsensitive))
+        return false;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<StudentRecord> prefixed;
+    QVector<StudentRecord> others;
+    for (const StudentRecord &s : rows) {
+        if (s.rollNo.startsWith(filter, Qt::CaseInsensitive)
+            || s.name.startsWith(filter, Qt::CaseInsensitive))
+            prefixed.append(s);
+        else if (s.rollNo.contains(filter, Qt::CaseInsensitive)
+                 || s.name.contains(filter, Qt::CaseInsensitive)
+                 || s.email.contains(filter, Qt::CaseInsensitive))
+            others.append(s);
+    }
+    if (prefixed.isEmpty() && others.isEmpty())
+        return false;
+
+    beginResetModel();
+    rows = prefixed + others;
+    currentFilter = filter;
+    endResetModel();
+
+    fetchMs = timer.elapsed();
+    refined = true;
+    emit pageLoaded(rows.size(), complete);
+    return true;
+}
+
+bool StudentTableModel::isComplete() const
+{
+    return complete;
+}
+
+// =========================================
+// Row patches
+// =========================================
+
+void StudentTableModel::refreshStudent(const QString &rollNo)
+{
+    executor->submit(RowChannelPrefix + rollNo, [rollNo](QSqlDatabase &db, const QueryCancelToken &, QString &error) {
+        StudentRepository repository(db);
+        StudentRecord student;
+        bool found = repository.find(rollNo, student);
+        error = repository.lastError();
+
+        QVariantMap row;
+        row["rollNo"] = rollNo;
+        row["found"] = found;
+        row["student"] = QVariant::fromValue(student);
+        return QVariant(row);
+    });
+}
+
+void StudentTableModel::removeStudent(const QString &rollNo)
+{
+    applyRow(rollNo, false, StudentRecord());
+}
+
+void StudentTableModel::applyRow(const QString &rollNo, bool found, const StudentRecord &student)
+{
+    int row = findRow(rollNo);
+
+    if (row >= 0 && found) {
+        rows[row] = student;
+        emit dataChanged(index(row, 0), index(row, ColumnCount - 1));
+    } else if (row >= 0) {
+        beginRemoveRows(QModelIndex(), row, row);
+        rows.remove(row);
+        endRemoveRows();
+    } else if (found && currentFilter.isEmpty()) {
+        // Search results keep their rank order, so new students only show
+        // up in the plain listing, and there only within the loaded range;
+        // past the last loaded row they arrive with a later page
+        int at = lowerBound(rollNo);
+        if (complete || at < rows.size()) {
+            beginInsertRows(QModelIndex(), at, at);
+            rows.insert(at, student);
+            endInsertRows();
+        }
+    }
+}
+
+int StudentTableModel::findRow(const QString &rollNo) const
+{
+    if (!currentFilter.isEmpty()) {
+        for (int i = 0; i < rows.size(); i++) {
+            if (rows[i].rollNo == rollNo)
+                return i;
+        }
+        return -1;
+    }
+
+    int at = lowerBound(rollNo);
+    return (at < rows.size() && rows[at].rollNo == rollNo) ? at : -1;
+}
+
+int StudentTableModel::lowerBound(const QString &rollNo) const
+{
+    auto it = std::lower_bound(rows.cbegin(), rows.cend(), rollNo,
+                               [](const StudentRecord &s, const QString &key) {
+                                   return s.rollNo < key;
+                               });
+    return int(it - rows.cbegin());
+}
+
+// =========================================
+// Worker results
+// =========================================
+
+void StudentTableModel::onQueryFinished(quint64, const QString &channel, const QVariant &result)
+{
+    if (channel == PageChannel) {
+        QVector<StudentRecord> page = result.value<QVector<StudentRecord>>();
+        fetching = false;
+        complete = !currentFilter.isEmpty() || page.size() < PageSize;
+        fetchMs = fetchTimer.elapsed();
+        refined = false;
+
+        // Below the cap, a search of three or more characters returned
+        // every substring match (see refine())
+        exhaustive = currentFilter.size() >= 3 && page.size() < SearchLimit;
+
+        if (!page.isEmpty()) {
+            beginInsertRows(QModelIndex(), rows.size(), rows.size() + page.size() - 1);
+            rows += page;
+            endInsertRows();
+        }
+        emit pageLoaded(rows.size(), complete);
+    } else if (channel.startsWith(RowChannelPrefix)) {
+        QVariantMap row = result.toMap();
+        applyRow(row["rollNo"].toString(), row["found"].toBool(),
+                 row["student"].value<StudentRecord>());
+    }
+}
+
+void StudentTableModel::onQueryFailed(quint64, const QString &channel, const QString &error)
+{
+    if (channel == PageChannel) {
+        fetching = false;
+        complete = true;
+        emit loadFailed(error);
+    } else if (channel.startsWith(RowChannelPrefix)) {
+        emit loadFailed(error);
+    }
+}
@@ -0,0 +1,90 @@
+#ifndef STUDENTTABLEMODEL_H
+#define STUDENTTABLEMODEL_H
+
+#include "studentrepository.h"
+
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QVector>
+
+class QueryExecutor;
+
+// Students for the teacher page. Without a filter they are listed in roll_no
+// order and fetched a page at a time on the query worker as the view
+// scrolls (keyset pagination on roll_no); with one they are the ranked
+// results of StudentRepository::search. Single rows are patched after
+// edits instead of reloading.
+class StudentTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        RollNoColumn,
+        NameColumn,
+        EmailColumn,
+        BranchColumn,
+        YearColumn,
+        GenderColumn,
+        CgpaColumn,
+        ColumnCount
+    };
+
+    static const int PageSize = 200;
+    static const int SearchLimit = 500;
+
+    explicit StudentTableModel(QueryExecutor *executor, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const override;
+
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
+
+    // Drops the loaded rows and starts again from the first page; an empty
+    // filter lists every student, anything else is a search
+    void setFilter(const QString &filter);
+    QString filter() const;
+    bool isComplete() const;
+
+    // How long the last load took, and whether it was refined in memory
+    // from the previous search instead of queried
+    qint64 lastFetchMs() const;
+    bool lastFetchRefined() const;
+
+    // Re-reads one student and updates, inserts or removes its row
+    void refreshStudent(const QString &rollNo);
+    void removeStudent(const QString &rollNo);
+
+    StudentRecord student(int row) const;
+
+signals:
+    void pageLoaded(int loadedRows, bool complete);
+    void loadFailed(const QString &error);
+
+private slots:
+    void onQueryFinished(quint64 ticket, const QString &channel, const QVariant &result);
+    void onQueryFailed(quint64 ticket, const QString &channel, const QString &error);
+
+private:
+    QueryExecutor *executor;
+    QVector<StudentRecord> rows;
+    QString currentFilter;
+    bool complete;
+    bool fetching;
+    bool exhaustive;
+
+    QElapsedTimer fetchTimer;
+    qint64 fetchMs;
+    bool refined;
+
+    bool refine(const QString &filter);
+    int findRow(const QString &rollNo) const;
+    int lowerBound(const QString &rollNo) const;
+    void applyRow(const QString &rollNo, bool found, const StudentRecord &student);
+};
+
+#endif // STUDENTTABLEMODEL_H
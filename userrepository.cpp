@@ -0,0 +1,103 @@
+#include "userrepository.h"
+#include "statementcache.h"
+#include "querystats.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QCryptographicHash>
+#include <QVariant>
+
+UserRepository::UserRepository(const QSqlDatabase &database)
+    : db(database)
+{
+}
+
+QString UserRepository::hashPassword(const QString &password)
+{
+    return QString(
+        QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256).toHex());
+}
+
+bool UserRepository::authenticate(const QString &username, const QString &password,
+                                  UserAccount &out)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "SELECT user_id, role, email FROM users "
+        "WHERE username=? AND password=?");
+    q.addBindValue(username.trimmed());
+    q.addBindValue(hashPassword(password));
+
+    QueryTrace trace(q);
+    if (!trace.exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    if (!trace.next())
+        return false;
+
+    out.userId = q.value(0).toString();
+    out.username = username.trimmed();
+    out.role = q.value(1).toString();
+    out.email = q.value(2).toString();
+    trace.finish();
+    return true;
+}
+
+bool UserRepository::create(const UserAccount &account, const QString &password)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "INSERT INTO users (user_id, username, password, role, email) "
+        "VALUES (?, ?, ?, ?, ?)");
+    q.addBindValue(account.userId);
+    q.addBindValue(account.username.trimmed());
+    q.addBindValue(hashPassword(password));
+    q.addBindValue(account.role);
+    q.addBindValue(account.email.trimmed());
+
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+bool UserRepository::remove(const QString &userId)
+{
+    QSqlQuery &q = StatementCache::forDatabase(db).prepared(
+        "DELETE FROM users WHERE user_id=?");
+    q.addBindValue(userId);
+
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+// Default admin teacher if not exists
+bool UserRepository::ensureDefaultAdmin()
+{
+    QSqlQuery q(db);
+    QueryTrace count(q);
+    if (!count.exec("SELECT COUNT(*) FROM users WHERE username='admin'")) {
+        error = q.lastError().text();
+        return false;
+    }
+    if (count.next() && q.value(0).toInt() > 0)
+        return true;
+    count.finish();
+
+    q.prepare("INSERT INTO users (user_id, username, password, role, email) "
+              "VALUES ('ADMIN', 'admin', ?, 'TEACHER', 'admin@example.com')");
+    q.addBindValue(hashPassword("admin123"));
+    if (!QueryTrace(q).exec()) {
+        error = q.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+QString UserRepository::lastError() const
+{
+    return error;
+}
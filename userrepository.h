@@ -0,0 +1,34 @@
+#ifndef USERREPOSITORY_H
+#define USERREPOSITORY_H
+
+#include <QSqlDatabase>
+#include <QString>
+
+struct UserAccount
+{
+    QString userId;     // roll_no for students
+    QString username;
+    QString role;       // "TEACHER" or "STUDENT"
+    QString email;
+};
+
+class UserRepository
+{
+public:
+    explicit UserRepository(const QSqlDatabase &database);
+
+    bool authenticate(const QString &username, const QString &password, UserAccount &out);
+    bool create(const UserAccount &account, const QString &password);
+    bool remove(const QString &userId);
+    bool ensureDefaultAdmin();
+
+    QString lastError() const;
+
+    static QString hashPassword(const QString &password);
+
+private:
+    QSqlDatabase db;
+    QString error;
+};
+
+#endif // USERREPOSITORY_H